@@ -0,0 +1,513 @@
+/**
+ * @file bench-sim.c
+ * @brief throughput benchmark of the emulator: replays traces through the
+ *        TLB hierarchy only, the lookups of warm TLBs only, the cache
+ *        hierarchy only, and the full system, and compares the results with
+ *        a baseline
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#if defined _WIN32  || defined _WIN64
+#define __USE_MINGW_ANSI_STDIO 1
+#endif
+
+#define _POSIX_C_SOURCE 200809L // for getopt(), clock_gettime()
+
+#include "error.h"
+#include "commands.h"
+#include "addr_mng.h"
+#include "memory.h"
+#include "page_walk.h"
+#include "tlb_hrchy_mng.h"
+#include "cache_mng.h"
+#include "sim_mng.h"
+#include "trace_mng.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>   // for strtoul(), strtod()
+#include <string.h>
+#include <inttypes.h> // for PRIu64
+#include <time.h>     // for clock_gettime()
+#include <unistd.h>   // for getopt(), gethostname()
+#include <assert.h>
+
+#define BENCH_NAME_MAX 63   // of "workload/path"
+#define BENCH_WORKLOAD_MAX (BENCH_NAME_MAX - sizeof("/lookup") + 1) // longest path name
+#define STR_(X) #X
+#define STR(X) STR_(X)
+#define BENCH_MAX_WORKLOADS 16
+#define BENCH_MAX_RESULTS (BENCH_MAX_WORKLOADS * BENCH_PATHS)
+#define BENCH_MAX_REPEATS 64
+#define BENCH_HOST_MAX 63
+#define CALIBRATION_STEPS ((size_t) 1 << 22)   // of calibrate(), between two clock readings
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [options] name=memory_description:trace ...\n", pgm);
+    fprintf(stderr, "options:  -r repeats     runs of each path, the median one is kept (3, at most " STR(BENCH_MAX_REPEATS) ")\n");
+    fprintf(stderr, "          -m seconds     minimum CPU time of a run, replaying the trace as often as needed (0.2)\n");
+    fprintf(stderr, "          -o file        also write the results to that JSON file\n");
+    fprintf(stderr, "          -b file        compare the results with that baseline JSON file\n");
+    fprintf(stderr, "          -t percent     regression threshold on ns/access (25)\n");
+    fprintf(stderr, "the baseline is scaled by the speed of a calibration loop, and is not compared to\n"
+                    "when it was recorded on another host\n");
+    fprintf(stderr, "exit code 1 if any result is slower than its baseline by more than the threshold\n");
+    fprintf(stderr, "example:  %s -b bench-baseline.json seq=seq.desc:seq.trace\n", pgm);
+}
+
+// ======================================================================
+// Returns the CPU time of the calling thread in seconds, so that time spent
+// preempted is not measured
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return (double) t.tv_sec + (double) t.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    const double x = *(const double*) a;
+    const double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// Median of n > 0 values, which are sorted
+static double median(double* values, size_t n)
+{
+    qsort(values, n, sizeof(*values), compare_doubles);
+    return (n % 2 == 1) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+// ======================================================================
+// One run of a fixed chain of dependent arithmetic (xorshift), lasting at
+// least min_time; returns its ns per step. The baseline results are scaled
+// by the ratio of this speed now to its speed when they were recorded.
+// Memory-bound loops are not used: their speed varies much more from one run
+// to the next than the speed of the processor does.
+static double calibrate(double min_time)
+{
+    double elapsed = 0.0;
+    size_t steps = 0;
+    uint64_t x = UINT64_C(88172645463325252);
+    do {
+        const double start = now();
+        for (size_t i = 0; i < CALIBRATION_STEPS; ++i) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+        }
+        elapsed += now() - start;
+        steps += CALIBRATION_STEPS;
+    } while (elapsed < min_time);
+
+    volatile uint64_t sink = x;
+    (void)sink;
+    return elapsed * 1e9 / (double) steps;
+}
+
+typedef struct bench_result {
+    char name[BENCH_NAME_MAX + 1];  // "workload/path"
+    double accesses_per_sec;
+    double ns_per_access;
+} bench_result_t;
+
+enum bench_path { BENCH_TLB, BENCH_LOOKUP, BENCH_CACHE, BENCH_FULL, BENCH_PATHS };
+typedef enum bench_path bench_path_t;
+
+static const char* const PATH_NAMES[BENCH_PATHS] = { "tlb", "lookup", "cache", "full" };
+
+// ======================================================================
+// One run of the TLB hierarchy alone: translation of every command
+static int run_tlb(sim_t* sim, const packed_program_t* program)
+{
+    for_all_packed_lines(line, program) {
+        virt_addr_t vaddr;
+        phy_addr_t paddr;
+        int hit = 0;
+        M_EXIT_IF_ERR(init_virt_addr64(&vaddr, packed_vaddr64(line)), "converting virtual address");
+        M_EXIT_IF_ERR(tlb_search_probed(sim->mem_space, &vaddr, &paddr, packed_type(line),
+                                        sim->l1_itlb, sim->l1_dtlb, sim->l2_tlb, &hit, &sim->tlb_probes),
+                      "calling tlb_search()");
+    }
+    return ERR_NONE;
+}
+
+// One run of the TLB lookups alone, once the TLBs are warm: every command
+// is looked up in its L1 TLB and in the L2 TLB, neither filled nor walked
+static int run_lookup(sim_t* sim, const packed_program_t* program)
+{
+    for_all_packed_lines(line, program) {
+        virt_addr_t vaddr;
+        phy_addr_t paddr;
+        M_EXIT_IF_ERR(init_virt_addr64(&vaddr, packed_vaddr64(line)), "converting virtual address");
+        if (packed_type(line) == INSTRUCTION) {
+            (void)tlb_hit(&vaddr, &paddr, sim->l1_itlb, L1_ITLB);
+        } else {
+            (void)tlb_hit(&vaddr, &paddr, sim->l1_dtlb, L1_DTLB);
+        }
+        (void)tlb_hit(&vaddr, &paddr, sim->l2_tlb, L2_TLB);
+    }
+    return ERR_NONE;
+}
+
+// One run of the cache hierarchy alone, on the physical addresses of the commands
+static int run_cache(sim_t* sim, const packed_program_t* program, phy_addr_t* paddrs)
+{
+    phy_addr_t* paddr = paddrs;
+    for_all_packed_lines(line, program) {
+        const mem_access_t type = packed_type(line);
+        cache_desc_t* l1_cache = (type == INSTRUCTION) ? &sim->l1_icache : &sim->l1_dcache;
+        if (packed_order(line) == READ) {
+            if (packed_data_size(line) == sizeof(word_t)) {
+                word_t word = 0;
+                M_EXIT_IF_ERR(cache_read(sim->mem_space, paddr, type, l1_cache, &sim->l2_cache, &word, LRU),
+                              "calling cache_read()");
+            } else {
+                byte_t byte = 0;
+                M_EXIT_IF_ERR(cache_read_byte(sim->mem_space, paddr, type, l1_cache, &sim->l2_cache, &byte, LRU),
+                              "calling cache_read_byte()");
+            }
+        } else {
+            const word_t word = packed_write_data(line);
+            if (packed_data_size(line) == sizeof(word_t)) {
+                M_EXIT_IF_ERR(cache_write(sim->mem_space, paddr, &sim->l1_dcache, &sim->l2_cache, &word, LRU),
+                              "calling cache_write()");
+            } else {
+                M_EXIT_IF_ERR(cache_write_byte(sim->mem_space, paddr, &sim->l1_dcache, &sim->l2_cache,
+                                               (byte_t) word, LRU),
+                              "calling cache_write_byte()");
+            }
+        }
+        ++paddr;
+    }
+    return ERR_NONE;
+}
+
+// One run of the full system
+static int run_full(sim_t* sim, const packed_program_t* program)
+{
+    for_all_packed_lines(line, program) {
+        M_EXIT_IF_ERR(sim_execute_packed(sim, line), "calling sim_execute_packed()");
+    }
+    return ERR_NONE;
+}
+
+// Translates all the commands (untimed), for the cache path
+static int translate_all(const void* mem_space, const packed_program_t* program, phy_addr_t* paddrs)
+{
+    phy_addr_t* paddr = paddrs;
+    for_all_packed_lines(line, program) {
+        virt_addr_t vaddr;
+        M_EXIT_IF_ERR(init_virt_addr64(&vaddr, packed_vaddr64(line)), "converting virtual address");
+        M_EXIT_IF_ERR(page_walk(mem_space, &vaddr, paddr), "calling page_walk()");
+        ++paddr;
+    }
+    return ERR_NONE;
+}
+
+// ======================================================================
+// A workload, loaded once for all its runs
+typedef struct bench_workload {
+    const char* name;
+    void* mem_space;
+    size_t mem_size;
+    packed_program_t program;
+    phy_addr_t* paddrs;     // physical addresses of the commands, for the cache path
+} bench_workload_t;
+
+// Loads a workload; it is to be freed with workload_free() even on error
+static int workload_load(const char* desc, const char* trace_name, bench_workload_t* workload)
+{
+    workload->mem_space = NULL;
+    workload->paddrs = NULL;
+    memset(&workload->program, 0, sizeof(workload->program));
+
+    trace_t trace;
+    int err = mem_init_from_description(desc, &workload->mem_space, &workload->mem_size);
+    if (err == ERR_NONE) err = packed_program_init(&workload->program);
+    if (err == ERR_NONE) {
+        err = trace_open(trace_name, &trace);
+        if (err == ERR_NONE) {
+            err = trace_next_packed(&trace, &workload->program, SIZE_MAX);
+            trace_close(&trace);
+        }
+    }
+    if (err == ERR_NONE) {
+        workload->paddrs = calloc(workload->program.nb_lines + 1, sizeof(phy_addr_t));
+        err = (workload->paddrs == NULL) ? ERR_MEM
+              : translate_all(workload->mem_space, &workload->program, workload->paddrs);
+    }
+    return err;
+}
+
+static void workload_free(bench_workload_t* workload)
+{
+    free(workload->paddrs);
+    workload->paddrs = NULL;
+    (void)packed_program_free(&workload->program);
+    free(workload->mem_space);
+    workload->mem_space = NULL;
+}
+
+// One timed pass of a path over the whole program, on a fresh simulation
+static int run_path(bench_path_t path, sim_t* sim, const bench_workload_t* workload, double* elapsed)
+{
+    const packed_program_t* program = &workload->program;
+    int err = sim_init(sim, workload->mem_space, workload->mem_size, NULL);
+    if (err == ERR_NONE && path == BENCH_LOOKUP) err = run_tlb(sim, program); // warm-up
+    const double start = now();
+    if (err == ERR_NONE) {
+        err = (path == BENCH_TLB) ? run_tlb(sim, program)
+            : (path == BENCH_LOOKUP) ? run_lookup(sim, program)
+            : (path == BENCH_CACHE) ? run_cache(sim, program, workload->paddrs)
+            : run_full(sim, program);
+    }
+    *elapsed = now() - start;
+    (void)sim_free(sim);
+    return err;
+}
+
+// One run of a path: passes over the program until it lasts at least min_time
+static int run_timed(bench_path_t path, sim_t* sim, const bench_workload_t* workload,
+                     double min_time, double* ns_per_access)
+{
+    double elapsed = 0.0;
+    size_t accesses = 0;
+    int err = ERR_NONE;
+    do {
+        double pass = 0.0;
+        err = run_path(path, sim, workload, &pass);
+        elapsed += pass;
+        accesses += workload->program.nb_lines;
+    } while (err == ERR_NONE && elapsed < min_time && workload->program.nb_lines > 0);
+    *ns_per_access = accesses > 0 ? elapsed * 1e9 / (double) accesses : 0.0;
+    return err;
+}
+
+// Benchmarks the four paths on all the workloads, keeping the median of the
+// repeats. The runs go round-robin over the calibration, workloads and paths,
+// so that a slower phase of the machine weighs on all of them alike instead
+// of on the few that happen to run during it.
+static int bench_all(const bench_workload_t* workloads, size_t nb_workloads, unsigned repeats,
+                     double min_time, bench_result_t* results, double* calibration)
+{
+    sim_t* sim = malloc(sizeof(sim_t));
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(sim, ERR_MEM);
+
+    static double runs[BENCH_MAX_RESULTS][BENCH_MAX_REPEATS];
+    double calibrations[BENCH_MAX_REPEATS];
+    int err = ERR_NONE;
+    for (unsigned run = 0; err == ERR_NONE && run < repeats; ++run) {
+        calibrations[run] = calibrate(min_time);
+        for (size_t w = 0; err == ERR_NONE && w < nb_workloads; ++w) {
+            for (int path = 0; err == ERR_NONE && path < BENCH_PATHS; ++path) {
+                err = run_timed((bench_path_t) path, sim, &workloads[w], min_time,
+                                &runs[w * BENCH_PATHS + (size_t) path][run]);
+            }
+        }
+    }
+    free(sim);
+    if (err != ERR_NONE) return err;
+
+    *calibration = median(calibrations, repeats);
+    for (size_t w = 0; w < nb_workloads; ++w) {
+        for (int path = 0; path < BENCH_PATHS; ++path) {
+            const size_t i = w * BENCH_PATHS + (size_t) path;
+            bench_result_t* result = &results[i];
+            const int len = snprintf(result->name, sizeof(result->name), "%s/%s", workloads[w].name, PATH_NAMES[path]);
+            if (len < 0 || (size_t) len >= sizeof(result->name)) return ERR_BAD_PARAMETER;
+            result->ns_per_access = median(runs[i], repeats);
+            result->accesses_per_sec = result->ns_per_access > 0.0 ? 1e9 / result->ns_per_access : 0.0;
+        }
+    }
+    return ERR_NONE;
+}
+
+// ======================================================================
+// What the results were measured on
+typedef struct bench_host {
+    char name[BENCH_HOST_MAX + 1];  // see gethostname()
+    double calibration;             // ns per step of calibrate()
+} bench_host_t;
+
+// One result per line, so that read_baseline() needs no JSON parser
+static int write_results(const char* filename, const bench_host_t* host,
+                         const bench_result_t* results, size_t nb_results)
+{
+    FILE* output = fopen(filename, "w");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(output, ERR_IO);
+    fputs("{\n", output);
+    fprintf(output, "  \"host\": { \"name\": \"%s\", \"calibration_ns\": %.4f },\n", host->name, host->calibration);
+    for (size_t i = 0; i < nb_results; ++i) {
+        fprintf(output, "  \"%s\": { \"accesses_per_sec\": %.0f, \"ns_per_access\": %.2f }%s\n",
+                results[i].name, results[i].accesses_per_sec, results[i].ns_per_access,
+                i + 1 < nb_results ? "," : "");
+    }
+    fputs("}\n", output);
+    return fclose(output) == 0 ? ERR_NONE : ERR_IO;
+}
+
+// Reads a file written by write_results(); the host is left empty if not found
+static int read_baseline(const char* filename, bench_host_t* host, bench_result_t* results, size_t* nb_results)
+{
+    FILE* input = fopen(filename, "r");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(input, ERR_IO);
+    char line[256];
+    memset(host, 0, sizeof(*host));
+    *nb_results = 0;
+    while (*nb_results < BENCH_MAX_RESULTS && fgets(line, sizeof(line), input) != NULL) {
+        bench_result_t* result = &results[*nb_results];
+        if (sscanf(line, " \"host\": { \"name\": \"%" STR(BENCH_HOST_MAX) "[^\"]\", \"calibration_ns\": %lf",
+                   host->name, &host->calibration) == 2) {
+            continue;
+        }
+        if (sscanf(line, " \"%" STR(BENCH_NAME_MAX) "[^\"]\": { \"accesses_per_sec\": %lf, \"ns_per_access\": %lf",
+                   result->name, &result->accesses_per_sec, &result->ns_per_access) == 3) {
+            ++*nb_results;
+        }
+    }
+    fclose(input);
+    return ERR_NONE;
+}
+
+// ======================================================================
+int main(int argc, char* argv[])
+{
+    const char* pgm = argv[0];
+    unsigned repeats = 3;
+    double min_time = 0.2;
+    const char* output_filename = NULL;
+    const char* baseline_filename = NULL;
+    double threshold = 25.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:m:o:b:t:")) != -1) {
+        if (opt == 'r' && (repeats = (unsigned) strtoul(optarg, NULL, 10)) > 0 && repeats <= BENCH_MAX_REPEATS) {
+            continue;
+        } else if (opt == 'm' && (min_time = strtod(optarg, NULL)) >= 0.0) {
+            continue;
+        } else if (opt == 'o') {
+            output_filename = optarg;
+        } else if (opt == 'b') {
+            baseline_filename = optarg;
+        } else if (opt == 't' && (threshold = strtod(optarg, NULL)) > 0.0) {
+            continue;
+        } else {
+            error(pgm, "invalid option.");
+            return 1;
+        }
+    }
+    if (optind >= argc || (size_t) (argc - optind) * BENCH_PATHS > BENCH_MAX_RESULTS) {
+        error(pgm, "please provide between 1 and " STR(BENCH_MAX_WORKLOADS) " workloads:");
+        return 1;
+    }
+
+    // name=desc:trace
+    const size_t nb_workloads = (size_t) (argc - optind);
+    static char specs[BENCH_MAX_WORKLOADS][FILENAME_MAX];
+    bench_workload_t workloads[BENCH_MAX_WORKLOADS];
+    size_t nb_loaded = 0;
+    int err = ERR_NONE;
+    for (size_t w = 0; err == ERR_NONE && w < nb_workloads; ++w) {
+        char* spec = specs[w];
+        (void)snprintf(spec, FILENAME_MAX, "%s", argv[optind + (int) w]);
+        char* desc = strchr(spec, '=');
+        char* trace = desc == NULL ? NULL : strchr(desc, ':');
+        if (trace == NULL || desc == spec) {
+            error(pgm, "workloads are given as name=memory_description:trace.");
+            err = ERR_BAD_PARAMETER;
+            break;
+        }
+        *desc++ = '\0';
+        *trace++ = '\0';
+        if (strlen(spec) > BENCH_WORKLOAD_MAX) {
+            error(pgm, "workload names are at most " STR(BENCH_NAME_MAX) " characters, path included.");
+            err = ERR_BAD_PARAMETER;
+            break;
+        }
+        workloads[w].name = spec;
+        if (workload_load(desc, trace, &workloads[w]) != ERR_NONE) {
+            fprintf(stderr, "ERROR: cannot load workload \"%s\"\n", spec);
+            err = ERR_IO;
+        }
+        ++nb_loaded;
+    }
+
+    bench_host_t host;
+    memset(&host, 0, sizeof(host));
+    if (gethostname(host.name, sizeof(host.name) - 1) != 0) strcpy(host.name, "unknown");
+    host.name[strcspn(host.name, "\"")] = '\0'; // kept out of the JSON strings
+
+    bench_result_t results[BENCH_MAX_RESULTS];
+    const size_t nb_results = nb_workloads * BENCH_PATHS;
+    if (err == ERR_NONE && bench_all(workloads, nb_workloads, repeats, min_time, results, &host.calibration) != ERR_NONE) {
+        fprintf(stderr, "ERROR: cannot run the workloads\n");
+        err = ERR_IO;
+    }
+    for (size_t w = 0; w < nb_loaded; ++w) workload_free(&workloads[w]);
+    if (err == ERR_BAD_PARAMETER) return 1;
+    if (err != ERR_NONE) return 2;
+
+    if (output_filename != NULL && write_results(output_filename, &host, results, nb_results) != ERR_NONE) {
+        fprintf(stderr, "ERROR: cannot write \"%s\"\n", output_filename);
+        return 2;
+    }
+
+    bench_host_t baseline_host;
+    bench_result_t baseline[BENCH_MAX_RESULTS];
+    size_t nb_baseline = 0;
+    if (baseline_filename != NULL
+        && read_baseline(baseline_filename, &baseline_host, baseline, &nb_baseline) != ERR_NONE) {
+        fprintf(stderr, "ERROR: cannot read \"%s\"\n", baseline_filename);
+        return 2;
+    }
+
+    // the baseline is scaled by how much slower the calibration loop runs now
+    double scale = 1.0;
+    printf("calibration: %.4f ns/step on \"%s\"", host.calibration, host.name);
+    if (nb_baseline > 0 && strcmp(baseline_host.name, host.name)) {
+        printf("\n");
+        fflush(stdout);
+        fprintf(stderr, "NOTE: %s was recorded on host \"%s\", this is \"%s\": comparison skipped "
+                "(\"make bench-baseline\" records a baseline here)\n", baseline_filename,
+                baseline_host.name[0] != '\0' ? baseline_host.name : "?", host.name);
+        nb_baseline = 0;
+    } else if (nb_baseline > 0 && baseline_host.calibration > 0.0) {
+        scale = host.calibration / baseline_host.calibration;
+        printf(", %.4f in the baseline: baseline scaled by %.2f\n", baseline_host.calibration, scale);
+    } else {
+        printf("\n");
+    }
+
+    int regressions = 0;
+    printf("%-20s %14s %12s %12s %9s\n", "benchmark", "accesses/s", "ns/access", "baseline", "change");
+    for (size_t i = 0; i < nb_results; ++i) {
+        printf("%-20s %14.0f %12.2f", results[i].name, results[i].accesses_per_sec, results[i].ns_per_access);
+        const bench_result_t* base = NULL;
+        for (size_t j = 0; j < nb_baseline && base == NULL; ++j) {
+            if (!strcmp(baseline[j].name, results[i].name)) base = &baseline[j];
+        }
+        if (base == NULL || base->ns_per_access <= 0.0) {
+            printf(" %12s\n", "-");
+            continue;
+        }
+        const double expected = base->ns_per_access * scale;
+        const double change = 100.0 * (results[i].ns_per_access / expected - 1.0);
+        const int regression = change > threshold;
+        regressions += regression;
+        printf(" %12.2f %+8.1f%%%s\n", expected, change, regression ? "  REGRESSION" : "");
+    }
+    if (regressions > 0) {
+        fprintf(stderr, "%d benchmark(s) slower than the baseline by more than %.0f%%\n", regressions, threshold);
+        return 1;
+    }
+    return 0;
+}
@@ -10,6 +10,7 @@
 
 #include "addr.h" // for word_t
 #include <stdint.h>
+#include <stddef.h> // for size_t
 
 #define L1_ICACHE_WORDS_PER_LINE 4
 #define L1_ICACHE_LINE   16u // 16 bytes (4 words) per line
@@ -67,50 +68,128 @@
  *
  */
 
+/**
+ * The values above are the default geometry of each level. Any other one may
+ * be chosen at run time (see cache_geometry_init() and cache_alloc()),
+ * within these limits:
+ *  - sets: power of 2, at most CACHE_MAX_SETS (the index of a set is 16 bits wide)
+ *  - ways: at most CACHE_MAX_WAYS
+ *  - line size: power of 2, from one word to CACHE_MAX_LINE bytes, the same
+ *    at every level (lines move between L1 and L2)
+ *  - word size: sizeof(word_t), that of the emulated machine
+ *
+ * Caches are stored as structures of arrays, so that probing a set reads
+ * its tags and valid bits only, from one (up to 8 ways) or two host cache lines:
+ *  - first the metadata of every set, set_size bytes each (CACHE_SET_SIZE()):
+ *    the tags of its ways (uint32_t), then its valid mask (uint16_t, bit w
+ *    for way w), then the ages of its ways (uint8_t), padded to a power of 2;
+ *  - then the lines, data_offset bytes from the start: those of the ways of
+ *    set 0, then of set 1, and so on.
+ * Entries are exchanged one at a time as cache_entry_t (see cache_entry_init()
+ * and cache_insert()).
+ */
+#define CACHE_MAX_SETS 32768u
+#define CACHE_MAX_WAYS 16u
+#define CACHE_MAX_LINE 64u
+#define CACHE_MAX_WORDS_PER_LINE (CACHE_MAX_LINE / sizeof(word_t))
+
+// bytes of metadata of a set of WAYS ways (a constant expression for a constant WAYS)
+#define CACHE_SET_META(WAYS) ((WAYS) * sizeof(uint32_t) + sizeof(uint16_t) + (WAYS) * sizeof(uint8_t))
+#define CACHE_SET_SIZE(WAYS) \
+        (CACHE_SET_META(WAYS) <= 16 ? 16u : CACHE_SET_META(WAYS) <= 32 ? 32u \
+         : CACHE_SET_META(WAYS) <= 64 ? 64u : 128u)
+
+typedef struct cache_geometry {
+        uint32_t sets;
+        uint32_t ways;
+        uint32_t line_size;         // in bytes
+        uint32_t word_size;         // in bytes
+        // derived from the above by cache_geometry_init()
+        uint32_t words_per_line;
+        uint32_t offset_bits;       // log2(line_size): select byte and word
+        uint32_t index_bits;        // log2(sets): select set
+        uint32_t tag_shift;         // offset_bits + index_bits (the *_TAG_REMAINING_BITS)
+        uint32_t set_size;          // in bytes, of the metadata of a set (CACHE_SET_SIZE(ways))
+        size_t data_offset;         // in bytes, from the start of the cache to its lines
+        size_t entry_size;          // in bytes, of a cache_entry_t with its line
+        size_t size;                // in bytes, of the whole cache
+} cache_geometry_t;
+
+typedef struct cache_entry {
+        uint32_t tag;
+        uint8_t v; //validation bit
+        uint8_t age;    // pour least recently used, 0 (most recent) to ways - 1
+        word_t line[];  // words_per_line words
+} cache_entry_t;
+
+// entries of the default geometries, laid out as cache_entry_t
 typedef struct l1_icache_entry {
-        uint8_t v : 1; //validation bit
-        uint8_t age : 2;    // pour least recently used, 4-ways
-        uint32_t tag : L1_ICACHE_TAG_BITS;
+        uint32_t tag;
+        uint8_t v; //validation bit
+        uint8_t age;    // pour least recently used, 4-ways
         word_t line[L1_ICACHE_WORDS_PER_LINE];
 } l1_icache_entry_t;
 
 typedef struct l1_dcache_entry {
-        uint8_t v : 1; //validation bit
-        uint8_t age : 2;    // pour least recently used, 4-ways
-        uint32_t tag : L1_DCACHE_TAG_BITS;
+        uint32_t tag;
+        uint8_t v; //validation bit
+        uint8_t age;    // pour least recently used, 4-ways
         word_t line[L1_DCACHE_WORDS_PER_LINE];
 } l1_dcache_entry_t;
 
 typedef struct l2_cache_entry {
-        uint8_t v : 1; //validation bit
-        uint8_t age : 3;    // pour least recently used, 8-ways
-        uint32_t tag : L2_CACHE_TAG_BITS;
+        uint32_t tag;
+        uint8_t v; //validation bit
+        uint8_t age;    // pour least recently used, 8-ways
         word_t line[L2_CACHE_WORDS_PER_LINE];
 } l2_cache_entry_t;
 
+// an array of LINES * WAYS entries of a default geometry holds that cache
+_Static_assert(sizeof(l1_icache_entry_t) * L1_ICACHE_LINES * L1_ICACHE_WAYS
+               >= L1_ICACHE_LINES * (CACHE_SET_SIZE(L1_ICACHE_WAYS) + L1_ICACHE_WAYS * L1_ICACHE_LINE),
+               "L1 ICACHE storage");
+_Static_assert(sizeof(l2_cache_entry_t) * L2_CACHE_LINES * L2_CACHE_WAYS
+               >= L2_CACHE_LINES * (CACHE_SET_SIZE(L2_CACHE_WAYS) + L2_CACHE_WAYS * L2_CACHE_LINE),
+               "L2 CACHE storage");
+
 enum cache { L1_ICACHE, L1_DCACHE, L2_CACHE};
 typedef enum cache cache_t;
 
+struct cache_kernels; // lookup, fill and LRU code of a geometry (see cache_mng.c)
+struct cache_probes;  // see probes.h
 
-// --------------------------------------------------
-#define cache_cast(TYPE) ((TYPE *)cache)
-
-// --------------------------------------------------
-#define cache_entry(TYPE, WAYS, LINE_INDEX, WAY) \
-        (cache_cast(TYPE) + (LINE_INDEX) * (WAYS) + (WAY))
-
-// --------------------------------------------------
-#define cache_valid(TYPE, WAYS, LINE_INDEX, WAY) \
-        cache_entry(TYPE, WAYS, LINE_INDEX, WAY)->v
-
-// --------------------------------------------------
-#define cache_age(TYPE, WAYS, LINE_INDEX, WAY) \
-        cache_entry(TYPE, WAYS, LINE_INDEX, WAY)->age
-
-// --------------------------------------------------
-#define cache_tag(TYPE, WAYS, LINE_INDEX, WAY) \
-        cache_entry(TYPE, WAYS, LINE_INDEX, WAY)->tag
+/**
+ * A cache: its storage, laid out as above for the geometry it was allocated
+ * with, and the kernels of that geometry. All three are set together by
+ * cache_alloc(): the geometry of a cache never changes under its storage.
+ * The accesses entering the hierarchy through an L1 cache are observed by
+ * the probes of that cache (see cache_probes_attach()).
+ */
+typedef struct cache_desc {
+        cache_geometry_t geometry;
+        const struct cache_kernels* kernels;
+        void* data;                 // geometry.size bytes
+        const struct cache_probes* probes; // never NULL once allocated
+} cache_desc_t;
 
 // --------------------------------------------------
-#define cache_line(TYPE, WAYS, LINE_INDEX, WAY) \
-        cache_entry(TYPE, WAYS, LINE_INDEX, WAY)->line
+// metadata of set SET of a cache whose sets have SET_SIZE bytes of metadata
+// and WAYS ways (constants in specialized kernels, see cache_mng.c)
+#define cache_set_tags(CACHE, SET_SIZE, SET) \
+        ((uint32_t*) ((char*) (CACHE) + (size_t) (SET) * (SET_SIZE)))
+#define cache_set_valid(CACHE, SET_SIZE, WAYS, SET) \
+        (*(uint16_t*) (cache_set_tags(CACHE, SET_SIZE, SET) + (WAYS)))
+#define cache_set_ages(CACHE, SET_SIZE, WAYS, SET) \
+        ((uint8_t*) (cache_set_tags(CACHE, SET_SIZE, SET) + (WAYS)) + sizeof(uint16_t))
+
+// line of way WAY of set SET, of WORDS words
+#define cache_set_line(CACHE, DATA_OFFSET, WAYS, WORDS, SET, WAY) \
+        ((word_t*) ((char*) (CACHE) + (DATA_OFFSET)) + ((size_t) (SET) * (WAYS) + (WAY)) * (WORDS))
+
+// the same, for a cache of geometry GEOMETRY (const cache_geometry_t*)
+#define cache_tags(GEOMETRY, CACHE, SET) cache_set_tags(CACHE, (GEOMETRY)->set_size, SET)
+#define cache_valid_mask(GEOMETRY, CACHE, SET) \
+        cache_set_valid(CACHE, (GEOMETRY)->set_size, (GEOMETRY)->ways, SET)
+#define cache_ages(GEOMETRY, CACHE, SET) cache_set_ages(CACHE, (GEOMETRY)->set_size, (GEOMETRY)->ways, SET)
+#define cache_line_at(GEOMETRY, CACHE, SET, WAY) \
+        cache_set_line(CACHE, (GEOMETRY)->data_offset, (GEOMETRY)->ways, (GEOMETRY)->words_per_line, SET, WAY)
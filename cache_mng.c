@@ -10,71 +10,423 @@
 #include "error.h"
 #include "lru.h"
 #include "util.h"
+#include "stats.h"
+#include "miss_class_mng.h"
+#include "hooks.h"
+#include "probes.h"
+#include "profile.h"
 
 #include <inttypes.h> // for PRIx macros
+#include <stddef.h>   // for offsetof()
+#include <stdlib.h>   // for calloc(), free()
+#include <string.h>   // for memset(), memcpy(), memmove()
+#if !defined(SCALAR_TAG_COMPARE) && (defined(__SSE2__) || defined(__AVX2__))
+#include <immintrin.h>
+#endif
+
+#define WORDS_AND_BYTE_BITS 4 // of the default geometries
+
+// default geometry of a level, as described in cache.h
+#define DEFAULT_GEOMETRY(LEVEL, ENTRY_TYPE)                                                        \
+    {                                                                                              \
+        LEVEL##_LINES, LEVEL##_WAYS, LEVEL##_LINE, sizeof(word_t), LEVEL##_WORDS_PER_LINE,         \
+        WORDS_AND_BYTE_BITS, LEVEL##_TAG_REMAINING_BITS - WORDS_AND_BYTE_BITS,                     \
+        LEVEL##_TAG_REMAINING_BITS, CACHE_SET_SIZE(LEVEL##_WAYS),                                  \
+        LEVEL##_LINES * CACHE_SET_SIZE(LEVEL##_WAYS), sizeof(ENTRY_TYPE),                          \
+        LEVEL##_LINES * (CACHE_SET_SIZE(LEVEL##_WAYS) + LEVEL##_WAYS * LEVEL##_LINE)               \
+    }
+
+// probes of a cache observing nothing (see cache_probes_attach())
+static const cache_probes_t no_probes;
+
+// default geometry of each level, indexed by cache_t (see cache_default_geometry())
+static const cache_geometry_t DEFAULT_GEOMETRIES[CACHE_LEVELS] = {
+    DEFAULT_GEOMETRY(L1_ICACHE, l1_icache_entry_t),
+    DEFAULT_GEOMETRY(L1_DCACHE, l1_dcache_entry_t),
+    DEFAULT_GEOMETRY(L2_CACHE, l2_cache_entry_t)
+};
+
+#define is_power_of_2(X) ((X) != 0 && ((X) & ((X) - 1)) == 0)
+
+// log2 of a power of 2
+static uint32_t log2_of(uint32_t power)
+{
+    uint32_t bits = 0;
+    while ((1u << bits) < power) ++bits;
+    return bits;
+}
 
 //=========================================================================
-#define PRINT_CACHE_LINE(OUTFILE, TYPE, WAYS, LINE_INDEX, WAY, WORDS_PER_LINE)                 \
-    do                                                                                         \
-    {                                                                                          \
-        fprintf(OUTFILE, "V: %1" PRIx8 ", AGE: %1" PRIx8 ", TAG: 0x%03" PRIx16 ", values: ( ", \
-                cache_valid(TYPE, WAYS, LINE_INDEX, WAY),                                      \
-                cache_age(TYPE, WAYS, LINE_INDEX, WAY),                                        \
-                cache_tag(TYPE, WAYS, LINE_INDEX, WAY));                                       \
-        for (int i_ = 0; i_ < WORDS_PER_LINE; i_++)                                            \
-            fprintf(OUTFILE, "0x%08" PRIx32 " ",                                               \
-                    cache_line(TYPE, WAYS, LINE_INDEX, WAY)[i_]);                              \
-        fputs(")\n", OUTFILE);                                                                 \
-    } while (0)
+/**
+ * Tag comparison: bit w of the result is set if tags[w] == tag, for the ways
+ * w < ways; the bits of the other ways are meaningless, callers AND it with
+ * the valid mask of the set.
+ *
+ * All the ways are compared at once, 8 by 8 with AVX2 and 4 by 4 with SSE2
+ * (broadcast the tag, compare, movemask). Vector loads may read past the last
+ * tag, which stays within the metadata of the set: CACHE_SET_SIZE() is a
+ * multiple of 16 bytes, and of 32 bytes beyond 4 ways.
+ * The instructions are chosen at build time: SSE2 is always there on x86-64,
+ * AVX2 needs e.g. "make AVX2=1"; -DSCALAR_TAG_COMPARE (or another target)
+ * gets the portable loop.
+ */
+static inline uint32_t tag_matches(const uint32_t *tags, uint32_t ways, uint32_t tag)
+{
+    uint32_t matches = 0;
+#if !defined(SCALAR_TAG_COMPARE) && defined(__AVX2__)
+    if (ways > 4)
+    {
+        const __m256i wanted = _mm256_set1_epi32((int)tag);
+        for (uint32_t way = 0; way < ways; way += 8)
+        {
+            const __m256i equal = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(tags + way)), wanted);
+            matches |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(equal)) << way;
+        }
+        return matches;
+    }
+#endif
+#if !defined(SCALAR_TAG_COMPARE) && (defined(__SSE2__) || defined(__AVX2__))
+    const __m128i wanted = _mm_set1_epi32((int)tag);
+    for (uint32_t way = 0; way < ways; way += 4)
+    {
+        const __m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(tags + way)), wanted);
+        matches |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(equal)) << way;
+    }
+#else
+    for (uint32_t way = 0; way < ways; ++way)
+    {
+        matches |= (uint32_t)(tags[way] == tag) << way;
+    }
+#endif
+    return matches;
+}
+
+// index of the lowest set bit of a non-zero mask
+static inline uint8_t lowest_way(uint32_t mask)
+{
+#ifdef __GNUC__
+    return (uint8_t)__builtin_ctz(mask);
+#else
+    uint8_t way = 0;
+    while (!(mask & 1u)) { mask >>= 1; ++way; }
+    return way;
+#endif
+}
+
+//=========================================================================
+/**
+ * Kernels: the lookup, fill and LRU code of one level, for its geometry.
+ *
+ * DEFINE_CACHE_KERNELS() writes them once for any geometry: given constants,
+ * as by DEFINE_SPECIALIZED_KERNELS() for the common geometries of
+ * SPECIALIZED_KERNELS below, the compiler gets fixed loop counts, shifts and
+ * masks; given the fields of the geometry, they are the generic fallback.
+ * The kernels of a cache are chosen once, by cache_alloc(), and then called
+ * through its descriptor.
+ * Compiling with -DGENERIC_CACHE_KERNELS uses the generic ones everywhere.
+ */
+typedef struct cache_kernels
+{
+    // looks up paddr in its set: on hit, sets hit_way, hit_index and p_line and updates the ages
+    void (*lookup)(const cache_geometry_t *geometry, void *cache, uint32_t paddr,
+                   const uint32_t **p_line, uint8_t *hit_way, uint16_t *hit_index);
+    // chooses the way to fill in a set, returns whether it is a cold start (invalid way)
+    int (*select_way)(const cache_geometry_t *geometry, const void *cache, uint32_t set, uint8_t *way);
+    // writes a valid entry of age 0 (ages are then updated by age_increase() or age_update())
+    void (*fill)(const cache_geometry_t *geometry, void *cache, uint32_t set, uint8_t way,
+                 uint32_t tag, const word_t *line);
+    // LRU on cold start
+    void (*age_increase)(const cache_geometry_t *geometry, void *cache, uint32_t set, uint8_t way);
+    // LRU on hit or replacement
+    void (*age_update)(const cache_geometry_t *geometry, void *cache, uint32_t set, uint8_t way);
+} cache_kernels_t;
+
+#define DEFINE_CACHE_KERNELS(NAME, WAYS, SETS, OFFSET_BITS, INDEX_BITS, WORDS, SET_SIZE, DATA_OFFSET) \
+    static void NAME##_age_increase(const cache_geometry_t *geometry, void *cache,                 \
+                                    uint32_t set, uint8_t way)                                     \
+    {                                                                                              \
+        (void)geometry;                                                                            \
+        uint8_t *ages = cache_set_ages(cache, SET_SIZE, WAYS, set);                                \
+        LRU_age_increase(ages, WAYS, way);                                                         \
+    }                                                                                              \
+                                                                                                   \
+    static void NAME##_age_update(const cache_geometry_t *geometry, void *cache,                   \
+                                  uint32_t set, uint8_t way)                                       \
+    {                                                                                              \
+        (void)geometry;                                                                            \
+        uint8_t *ages = cache_set_ages(cache, SET_SIZE, WAYS, set);                                \
+        LRU_age_update(ages, WAYS, way);                                                           \
+    }                                                                                              \
+                                                                                                   \
+    static void NAME##_lookup(const cache_geometry_t *geometry, void *cache, uint32_t paddr,      \
+                              const uint32_t **p_line, uint8_t *hit_way, uint16_t *hit_index)      \
+    {                                                                                              \
+        (void)geometry;                                                                            \
+        const uint32_t set = (paddr >> (OFFSET_BITS)) & ((SETS) - 1);                              \
+        const uint32_t tag = paddr >> ((OFFSET_BITS) + (INDEX_BITS));                              \
+        const uint32_t *tags = cache_set_tags(cache, SET_SIZE, set);                               \
+        const uint16_t valid = cache_set_valid(cache, SET_SIZE, WAYS, set);                        \
+        const uint32_t hits = tag_matches(tags, WAYS, tag) & valid;                                \
+        if (hits != 0)                                                                             \
+        {                                                                                          \
+            const uint8_t way = lowest_way(hits);                                                  \
+            *hit_way = way;                                                                        \
+            *hit_index = set;                                                                      \
+            *p_line = cache_set_line(cache, DATA_OFFSET, WAYS, WORDS, set, way);                   \
+            uint8_t *ages = cache_set_ages(cache, SET_SIZE, WAYS, set);                            \
+            LRU_age_update(ages, WAYS, way);                                                       \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static int NAME##_select_way(const cache_geometry_t *geometry, const void *cache,             \
+                                 uint32_t set, uint8_t *way_to_insert)                             \
+    {                                                                                              \
+        (void)geometry;                                                                            \
+        const uint16_t valid = cache_set_valid(cache, SET_SIZE, WAYS, set);                        \
+        const uint32_t invalid = ~(uint32_t)valid & ((1u << (WAYS)) - 1);                          \
+        if (invalid != 0)                                                                          \
+        {                                                                                          \
+            *way_to_insert = lowest_way(invalid);                                                  \
+            return 1;                                                                              \
+        }                                                                                          \
+        const uint8_t *ages = cache_set_ages(cache, SET_SIZE, WAYS, set);                          \
+        uint8_t age_max = 0;                                                                       \
+        *way_to_insert = 0;                                                                        \
+        foreach_way(way, WAYS)                                                                     \
+        {                                                                                          \
+            if (ages[way] >= age_max)                                                              \
+            {                                                                                      \
+                age_max = ages[way];                                                               \
+                *way_to_insert = way;                                                              \
+            }                                                                                      \
+        }                                                                                          \
+        return 0;                                                                                  \
+    }                                                                                              \
+                                                                                                   \
+    static void NAME##_fill(const cache_geometry_t *geometry, void *cache, uint32_t set,          \
+                            uint8_t way, uint32_t tag, const word_t *line)                         \
+    {                                                                                              \
+        (void)geometry;                                                                            \
+        cache_set_tags(cache, SET_SIZE, set)[way] = tag;                                           \
+        cache_set_valid(cache, SET_SIZE, WAYS, set) |= (uint16_t)(1u << way);                      \
+        cache_set_ages(cache, SET_SIZE, WAYS, set)[way] = 0;                                       \
+        word_t *data = cache_set_line(cache, DATA_OFFSET, WAYS, WORDS, set, way);                  \
+        for (uint32_t i = 0; i < (WORDS); ++i)                                                     \
+        {                                                                                          \
+            data[i] = line[i];                                                                     \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static const cache_kernels_t NAME##_kernels = {                                                \
+        NAME##_lookup, NAME##_select_way, NAME##_fill, NAME##_age_increase, NAME##_age_update      \
+    };
+
+// kernels for WAYS ways, 2^INDEX_BITS sets and lines of 2^OFFSET_BITS bytes
+#define DEFINE_SPECIALIZED_KERNELS(WAYS, INDEX_BITS, OFFSET_BITS)                                  \
+    DEFINE_CACHE_KERNELS(ways##WAYS##_sets##INDEX_BITS##_line##OFFSET_BITS, WAYS##u,               \
+                         (1u << INDEX_BITS), OFFSET_BITS, INDEX_BITS,                              \
+                         (1u << OFFSET_BITS) / sizeof(word_t), CACHE_SET_SIZE(WAYS##u),            \
+                         (size_t)CACHE_SET_SIZE(WAYS##u) << INDEX_BITS)
+
+DEFINE_CACHE_KERNELS(generic, geometry->ways, geometry->sets, geometry->offset_bits, geometry->index_bits,
+                     geometry->words_per_line, geometry->set_size, geometry->data_offset)
+
+// (ways, log2(sets), log2(line size)) of the specialized kernels
+#define SPECIALIZED_KERNELS(X) \
+    X(4, 6, 4)    /* default L1: 4 kiB, 16-byte lines */ \
+    X(8, 9, 4)    /* default L2: 64 kiB, 16-byte lines */ \
+    X(2, 7, 4)    /* 4 kiB, 2-way */ \
+    X(8, 6, 6)    /* 32 kiB, 64-byte lines: usual L1 */ \
+    X(16, 8, 6)   /* 256 kiB, 64-byte lines */ \
+    X(8, 10, 6)   /* 512 kiB, 64-byte lines */ \
+    X(16, 10, 6)  /* 1 MiB, 64-byte lines */
+
+#ifndef GENERIC_CACHE_KERNELS
+SPECIALIZED_KERNELS(DEFINE_SPECIALIZED_KERNELS)
+
+typedef struct specialized_kernels
+{
+    uint32_t ways;
+    uint32_t index_bits;
+    uint32_t offset_bits;
+    const cache_kernels_t *kernels;
+} specialized_kernels_t;
+
+#define SPECIALIZED_KERNELS_ENTRY(WAYS, INDEX_BITS, OFFSET_BITS) \
+    {WAYS, INDEX_BITS, OFFSET_BITS, &ways##WAYS##_sets##INDEX_BITS##_line##OFFSET_BITS##_kernels},
+
+static const specialized_kernels_t SPECIALIZED[] = {SPECIALIZED_KERNELS(SPECIALIZED_KERNELS_ENTRY)};
+#endif
+
+// Kernels for a (checked) geometry: specialized if any, generic otherwise
+static const cache_kernels_t *kernels_for(const cache_geometry_t *geometry)
+{
+#ifndef GENERIC_CACHE_KERNELS
+    for (size_t i = 0; i < sizeof(SPECIALIZED) / sizeof(SPECIALIZED[0]); ++i)
+    {
+        if (SPECIALIZED[i].ways == geometry->ways && SPECIALIZED[i].index_bits == geometry->index_bits &&
+            SPECIALIZED[i].offset_bits == geometry->offset_bits)
+            return SPECIALIZED[i].kernels;
+    }
+#else
+    (void)geometry;
+#endif
+    return &generic_kernels;
+}
+
+//=========================================================================
+// see cache_mng.h
+int cache_geometry_init(cache_geometry_t *geometry, uint32_t sets, uint32_t ways,
+                        uint32_t line_size, uint32_t word_size)
+{
+    M_REQUIRE_NON_NULL(geometry);
+    M_REQUIRE(word_size == sizeof(word_t), ERR_BAD_PARAMETER,
+              "words are %u bytes wide, not %" PRIu32, (unsigned)sizeof(word_t), word_size);
+    M_REQUIRE(is_power_of_2(sets) && sets <= CACHE_MAX_SETS, ERR_BAD_PARAMETER,
+              "%" PRIu32 " sets: not a power of 2 up to %u", sets, CACHE_MAX_SETS);
+    M_REQUIRE(ways >= 1 && ways <= CACHE_MAX_WAYS, ERR_BAD_PARAMETER,
+              "%" PRIu32 " ways: not between 1 and %u", ways, CACHE_MAX_WAYS);
+    M_REQUIRE(is_power_of_2(line_size) && line_size >= word_size && line_size <= CACHE_MAX_LINE,
+              ERR_BAD_PARAMETER, "%" PRIu32 " bytes per line: not a power of 2 from %" PRIu32 " to %u",
+              line_size, word_size, CACHE_MAX_LINE);
+
+    zero_init_ptr(geometry);
+    geometry->sets = sets;
+    geometry->ways = ways;
+    geometry->line_size = line_size;
+    geometry->word_size = word_size;
+    geometry->words_per_line = line_size / word_size;
+    geometry->offset_bits = log2_of(line_size);
+    geometry->index_bits = log2_of(sets);
+    geometry->tag_shift = geometry->offset_bits + geometry->index_bits;
+    geometry->set_size = CACHE_SET_SIZE(ways);
+    geometry->data_offset = (size_t)geometry->set_size * sets;
+    geometry->entry_size = offsetof(cache_entry_t, line) + geometry->words_per_line * sizeof(word_t);
+    geometry->size = geometry->data_offset + (size_t)line_size * ways * sets;
+    return ERR_NONE;
+}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hierarchy_check(const cache_geometry_t geometry[CACHE_LEVELS])
+{
+    M_REQUIRE_NON_NULL(geometry);
+
+    for (int level = 0; level < CACHE_LEVELS; ++level) {
+        cache_geometry_t checked;
+        M_EXIT_IF_ERR(cache_geometry_init(&checked, geometry[level].sets, geometry[level].ways,
+                                          geometry[level].line_size, geometry[level].word_size),
+                      "checking a cache geometry");
+        M_REQUIRE(checked.line_size == geometry[L1_ICACHE].line_size, ERR_BAD_PARAMETER,
+                  "lines of %" PRIu32 " and %" PRIu32 " bytes: all levels need the same line size",
+                  geometry[L1_ICACHE].line_size, checked.line_size);
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+// see cache_mng.h
+const cache_geometry_t *cache_default_geometry(cache_t cache_type)
+{
+    return (cache_type >= L1_ICACHE && cache_type <= L2_CACHE) ? &DEFAULT_GEOMETRIES[cache_type] : NULL;
+}
 
-#define PRINT_INVALID_CACHE_LINE(OUTFILE, TYPE, WAYS, LINE_INDEX, WAY, WORDS_PER_LINE)                                    \
-    do                                                                                                                    \
-    {                                                                                                                     \
-        fprintf(OUTFILE, "V: %1" PRIx8 ", AGE: -, TAG: -----, values: ( ---------- ---------- ---------- ---------- )\n", \
-                cache_valid(TYPE, WAYS, LINE_INDEX, WAY));                                                                \
+//=========================================================================
+// see cache_mng.h
+int cache_alloc(cache_desc_t *cache, const cache_geometry_t *geometry)
+{
+    M_REQUIRE_NON_NULL(cache);
+    M_REQUIRE_NON_NULL(geometry);
+
+    // the derived fields are recomputed, whatever the caller left in them
+    cache_geometry_t checked;
+    M_EXIT_IF_ERR(cache_geometry_init(&checked, geometry->sets, geometry->ways,
+                                      geometry->line_size, geometry->word_size),
+                  "checking the cache geometry");
+    void *data = calloc(1, checked.size);
+    M_EXIT_IF_NULL(data, checked.size);
+
+    zero_init_ptr(cache);
+    cache->geometry = checked;
+    cache->kernels = kernels_for(&cache->geometry);
+    cache->data = data;
+    cache->probes = &no_probes;
+    return ERR_NONE;
+}
+
+//=========================================================================
+// see cache_mng.h
+int cache_free(cache_desc_t *cache)
+{
+    M_REQUIRE_NON_NULL(cache);
+
+    free(cache->data);
+    zero_init_ptr(cache);
+    return ERR_NONE;
+}
+
+// a cache allocated by cache_alloc(), and not freed since
+#define M_REQUIRE_CACHE(CACHE) \
+    do { \
+        M_REQUIRE_NON_NULL(CACHE); \
+        M_REQUIRE((CACHE)->data != NULL && (CACHE)->kernels != NULL, ERR_BAD_PARAMETER, \
+                  "%s is not an allocated cache", #CACHE); \
     } while (0)
 
-#define DUMP_CACHE_TYPE(OUTFILE, TYPE, WAYS, LINES, WORDS_PER_LINE)                                  \
-    do                                                                                               \
-    {                                                                                                \
-        for (uint16_t index = 0; index < LINES; index++)                                             \
-        {                                                                                            \
-            foreach_way(way, WAYS)                                                                   \
-            {                                                                                        \
-                fprintf(output, "%02" PRIx8 "/%04" PRIx16 ": ", way, index);                         \
-                if (cache_valid(TYPE, WAYS, index, way))                                             \
-                    PRINT_CACHE_LINE(OUTFILE, const TYPE, WAYS, index, way, WORDS_PER_LINE);         \
-                else                                                                                 \
-                    PRINT_INVALID_CACHE_LINE(OUTFILE, const TYPE, WAYS, index, way, WORDS_PER_LINE); \
-            }                                                                                        \
-        }                                                                                            \
+// two caches that can make a hierarchy: lines move between them (see cache_hierarchy_check())
+#define M_REQUIRE_HIERARCHY(L1_CACHE, L2_CACHE) \
+    do { \
+        M_REQUIRE_CACHE(L1_CACHE); \
+        M_REQUIRE_CACHE(L2_CACHE); \
+        M_REQUIRE((L1_CACHE)->geometry.line_size == (L2_CACHE)->geometry.line_size, ERR_BAD_PARAMETER, \
+                  "lines of %" PRIu32 " and %" PRIu32 " bytes: L1 and L2 need the same line size", \
+                  (L1_CACHE)->geometry.line_size, (L2_CACHE)->geometry.line_size); \
     } while (0)
 
+// set of a cache level where a physical address goes
+#define set_index(GEOMETRY, PADDR) (((PADDR) >> (GEOMETRY)->offset_bits) & ((GEOMETRY)->sets - 1))
+
+// tag of a physical address in a cache level
+#define tag_of(GEOMETRY, PADDR) ((PADDR) >> (GEOMETRY)->tag_shift)
+
+// index of the word of a physical address in its line
+#define word_index(GEOMETRY, PADDR) (((PADDR) / sizeof(word_t)) & ((GEOMETRY)->words_per_line - 1))
+
+//=========================================================================
+// Prints one entry, valid or not
+static void print_cache_line(FILE *output, const cache_geometry_t *geometry, const void *cache,
+                             uint32_t set, uint8_t way)
+{
+    if (cache_valid_mask(geometry, cache, set) & (1u << way)) {
+        fprintf(output, "V: 1, AGE: %1" PRIx8 ", TAG: 0x%03" PRIx32 ", values: ( ",
+                cache_ages(geometry, cache, set)[way], cache_tags(geometry, cache, set)[way]);
+        const word_t *line = cache_line_at(geometry, cache, set, way);
+        for (uint32_t i = 0; i < geometry->words_per_line; i++)
+            fprintf(output, "0x%08" PRIx32 " ", line[i]);
+    } else {
+        fputs("V: 0, AGE: -, TAG: -----, values: ( ", output);
+        for (uint32_t i = 0; i < geometry->words_per_line; i++)
+            fputs("---------- ", output);
+    }
+    fputs(")\n", output);
+}
+
 //=========================================================================
 // see cache_mng.h
-int cache_dump(FILE *output, const void *cache, cache_t cache_type)
+int cache_dump(FILE *output, const cache_desc_t *cache)
 {
     M_REQUIRE_NON_NULL(output);
-    M_REQUIRE_NON_NULL(cache);
+    M_REQUIRE_CACHE(cache);
 
+    const cache_geometry_t *geometry = &cache->geometry;
     fputs("WAY/LINE: V: AGE: TAG: WORDS\n", output);
-    switch (cache_type)
+    for (uint32_t index = 0; index < geometry->sets; index++)
     {
-    case L1_ICACHE:
-        DUMP_CACHE_TYPE(output, l1_icache_entry_t, L1_ICACHE_WAYS,
-                        L1_ICACHE_LINES, L1_ICACHE_WORDS_PER_LINE);
-        break;
-    case L1_DCACHE:
-        DUMP_CACHE_TYPE(output, l1_dcache_entry_t, L1_DCACHE_WAYS,
-                        L1_DCACHE_LINES, L1_DCACHE_WORDS_PER_LINE);
-        break;
-    case L2_CACHE:
-        DUMP_CACHE_TYPE(output, l2_cache_entry_t, L2_CACHE_WAYS,
-                        L2_CACHE_LINES, L2_CACHE_WORDS_PER_LINE);
-        break;
-    default:
-        debug_print("%d: unknown cache type", cache_type);
-        return ERR_BAD_PARAMETER;
+        foreach_way(way, geometry->ways)
+        {
+            fprintf(output, "%02" PRIx8 "/%04" PRIx32 ": ", way, index);
+            print_cache_line(output, geometry, cache->data, index, way);
+        }
     }
     putc('\n', output);
 
@@ -92,300 +444,371 @@ word_t *get_line_from_mem_space(const void *mem_space, uint32_t physical_address
     return (((word_t *)mem_space) + (physical_address - (physical_address % lines)) / sizeof(word_t));
 }
 
-#define check_well_aligned(TYPE, PADDR, CACHE_LINE) \
-    M_REQUIRE(PADDR % CACHE_LINE == 0, ERR_BAD_PARAMETER, "is not well aligned %c", ' ');
-
-#define entry_init(TYPE, REMAINING_BITS, CACHE_LINE, WORDS_PER_LINE)                        \
-    {                                                                                       \
-        check_well_aligned(TYPE, physical_address, CACHE_LINE);                             \
-        TYPE *cache_init = (TYPE *)cache_entry;                                             \
-        cache_init->v = 1;                                                                  \
-        cache_init->age = 0;                                                                \
-        cache_init->tag = physical_address >> REMAINING_BITS;                               \
-        word_t *address = get_line_from_mem_space(mem_space, physical_address, CACHE_LINE); \
-        for (int i = 0; i < L1_ICACHE_WORDS_PER_LINE; i++)                                  \
-        {                                                                                   \
-            cache_init->line[i] = address[i];                                               \
-        }                                                                                   \
-    }
+#define check_well_aligned(PADDR, ALIGNMENT) \
+    M_REQUIRE((PADDR) % (ALIGNMENT) == 0, ERR_BAD_PARAMETER, "0x%08" PRIx32 " is not well aligned", (PADDR))
 
 int cache_entry_init(const void *mem_space,
                      const phy_addr_t *paddr,
                      void *cache_entry,
-                     cache_t cache_type)
+                     const cache_desc_t *cache)
 {
     M_REQUIRE_NON_NULL(mem_space);
     M_REQUIRE_NON_NULL(paddr);
     M_REQUIRE_NON_NULL(cache_entry);
-
-    uint32_t physical_address = paddr_to_uint32_t(paddr);
-
-    switch (cache_type)
+    M_REQUIRE_CACHE(cache);
+
+    const cache_geometry_t *geometry = &cache->geometry;
+    const uint32_t physical_address = paddr_to_uint32_t(paddr);
+    cache_entry_t *cache_init = cache_entry;
+    cache_init->v = 1;
+    cache_init->age = 0;
+    cache_init->tag = tag_of(geometry, physical_address);
+    const word_t *address = get_line_from_mem_space(mem_space, physical_address, geometry->line_size);
+    for (uint32_t i = 0; i < geometry->words_per_line; i++)
     {
-    case L1_ICACHE:
-        entry_init(l1_icache_entry_t, L1_ICACHE_TAG_REMAINING_BITS, L1_ICACHE_LINE, L1_ICACHE_WORDS_PER_LINE);
-        break;
-    case L1_DCACHE:
-        entry_init(l1_dcache_entry_t, L1_DCACHE_TAG_REMAINING_BITS, L1_DCACHE_LINE, L1_DCACHE_WORDS_PER_LINE);
-        break;
-    case L2_CACHE:
-        entry_init(l2_cache_entry_t, L2_CACHE_TAG_REMAINING_BITS, L2_CACHE_LINE, L2_CACHE_WORDS_PER_LINE);
-        break;
-        break;
-    default:
-        return ERR_BAD_PARAMETER;
+        cache_init->line[i] = address[i];
     }
 
     return ERR_NONE;
 }
 //=========================================================================
 
-#define cache_flush_process(TYPE, CACHE_LINES, CACHE_WAYS, CACHE_WORDS_PER_LINE) \
-    {                                                                            \
-        int entries = CACHE_LINES * CACHE_WAYS;                                  \
-        TYPE *cache_flushed = (TYPE *)cache;                                     \
-        for (int i = 0; i < entries; ++i)                                        \
-        {                                                                        \
-            cache_flushed[i].tag = 0;                                            \
-            cache_flushed[i].age = 0;                                            \
-            cache_flushed[i].v = 0;                                              \
-            for (int j = 0; j < CACHE_WORDS_PER_LINE; j++)                       \
-            {                                                                    \
-                cache_flushed[i].line[j] = 0;                                    \
-            }                                                                    \
-        }                                                                        \
-    }
-
-int cache_flush(void *cache, cache_t cache_type)
+int cache_flush(cache_desc_t *cache)
 {
-    M_REQUIRE_NON_NULL(cache);
-    switch (cache_type)
-    {
-    case L1_ICACHE:
-        cache_flush_process(l1_icache_entry_t, L1_ICACHE_LINES, L1_ICACHE_WAYS, L1_ICACHE_WORDS_PER_LINE);
-        break;
-    case L1_DCACHE:
-        cache_flush_process(l1_dcache_entry_t, L1_DCACHE_LINES, L1_DCACHE_WAYS, L1_DCACHE_WORDS_PER_LINE);
-        break;
-    case L2_CACHE:
-        cache_flush_process(l2_cache_entry_t, L2_CACHE_LINES, L2_CACHE_WAYS, L2_CACHE_WORDS_PER_LINE);
-        break;
-    default:
-        return ERR_BAD_PARAMETER;
-    }
+    M_REQUIRE_CACHE(cache);
+
+    memset(cache->data, 0, cache->geometry.size);
     return ERR_NONE;
 }
 
 //=========================================================================
 
-#define cache_insert_process(TYPE, CACHE_WAYS, CACHE_LINES, CACHE_WORDS_PER_LINE)                            \
-    {                                                                                                        \
-        M_REQUIRE(cache_way < CACHE_WAYS && cache_line_index < CACHE_LINES, ERR_BAD_PARAMETER, "%c", ' ');   \
-        cache_tag(TYPE, CACHE_WAYS, cache_line_index, cache_way) = ((TYPE *)cache_line_in)->tag;             \
-        cache_valid(TYPE, CACHE_WAYS, cache_line_index, cache_way) = ((TYPE *)cache_line_in)->v;             \
-        cache_age(TYPE, CACHE_WAYS, cache_line_index, cache_way) = ((TYPE *)cache_line_in)->age;             \
-        for (int i = 0; i < CACHE_WORDS_PER_LINE; i++)                                                       \
-        {                                                                                                    \
-            cache_line(TYPE, CACHE_WAYS, cache_line_index, cache_way)[i] = ((TYPE *)cache_line_in)->line[i]; \
-        }                                                                                                    \
-    }
-
 int cache_insert(uint16_t cache_line_index,
                  uint8_t cache_way,
                  const void *cache_line_in,
-                 void *cache,
-                 cache_t cache_type)
+                 cache_desc_t *cache)
 {
 
     M_REQUIRE_NON_NULL(cache_line_in);
-    M_REQUIRE_NON_NULL(cache);
-
-    switch (cache_type)
-    {
-    case L1_ICACHE:
-        cache_insert_process(l1_icache_entry_t, L1_ICACHE_WAYS, L1_ICACHE_LINES, L1_ICACHE_WORDS_PER_LINE);
-        break;
-    case L1_DCACHE:
-        cache_insert_process(l1_dcache_entry_t, L1_DCACHE_WAYS, L1_DCACHE_LINES, L1_DCACHE_WORDS_PER_LINE);
-        break;
-    case L2_CACHE:
-        cache_insert_process(l2_cache_entry_t, L2_CACHE_WAYS, L2_CACHE_LINES, L2_CACHE_WORDS_PER_LINE);
-        break;
-    default:
-        return ERR_BAD_PARAMETER;
-    }
+    M_REQUIRE_CACHE(cache);
+
+    const cache_geometry_t *geometry = &cache->geometry;
+    M_REQUIRE(cache_way < geometry->ways && cache_line_index < geometry->sets, ERR_BAD_PARAMETER, "%c", ' ');
+    const cache_entry_t *entry = cache_line_in;
+    void *data = cache->data;
+    uint16_t *valid = &cache_valid_mask(geometry, data, cache_line_index);
+    *valid = entry->v ? (uint16_t)(*valid | (1u << cache_way)) : (uint16_t)(*valid & ~(1u << cache_way));
+    cache_tags(geometry, data, cache_line_index)[cache_way] = entry->tag;
+    cache_ages(geometry, data, cache_line_index)[cache_way] = entry->age;
+    memcpy(cache_line_at(geometry, data, cache_line_index, cache_way), entry->line, geometry->line_size);
 
     return ERR_NONE;
 }
 
 //=========================================================================
 
-#define cache_hit_process(TYPE, CACHE_LINE, CACHE_LINES, REMAINING_BITS, CACHE_WAYS) \
-    {                                                                                \
-                                                                                     \
-        uint32_t index_line = (paddr_converted / CACHE_LINE) % CACHE_LINES;          \
-        uint32_t tag = paddr_converted >> REMAINING_BITS;                            \
-                                                                                     \
-        foreach_way(way, CACHE_WAYS)                                                 \
-        {                                                                            \
-            TYPE *entry = cache_entry(TYPE, CACHE_WAYS, index_line, way);            \
-            if (entry->v == 0)                                                       \
-            {                                                                        \
-                return ERR_NONE;                                                     \
-            }                                                                        \
-            else if (entry->tag == tag)                                              \
-            {                                                                        \
-                *hit_way = way;                                                      \
-                *hit_index = index_line;                                             \
-                *p_line = cache_line(TYPE, CACHE_WAYS, index_line, way);             \
-                LRU_age_update(TYPE, CACHE_WAYS, way, index_line);                   \
-                return ERR_NONE;                                                     \
-            }                                                                        \
-        }                                                                            \
-    }
-
-int cache_hit(const void *mem_space,
-              void *cache,
-              phy_addr_t *paddr,
-              const uint32_t **p_line,
-              uint8_t *hit_way,
-              uint16_t *hit_index,
-              cache_t cache_type)
+// the lookup itself, timed by cache_hit()
+static int cache_lookup(const void *mem_space,
+                        cache_desc_t *cache,
+                        phy_addr_t *paddr,
+                        const uint32_t **p_line,
+                        uint8_t *hit_way,
+                        uint16_t *hit_index)
 {
 
     M_REQUIRE_NON_NULL(mem_space);
-    M_REQUIRE_NON_NULL(cache);
+    M_REQUIRE_CACHE(cache);
     M_REQUIRE_NON_NULL(paddr);
     M_REQUIRE_NON_NULL(p_line);
     M_REQUIRE_NON_NULL(hit_way);
     M_REQUIRE_NON_NULL(hit_index);
 
-    uint32_t paddr_converted = paddr_to_uint32_t(paddr);
-
     *hit_way = HIT_WAY_MISS;
     *hit_index = HIT_INDEX_MISS;
-    switch (cache_type)
+    cache->kernels->lookup(&cache->geometry, cache->data, paddr_to_uint32_t(paddr),
+                           p_line, hit_way, hit_index);
+    return ERR_NONE;
+}
+
+int cache_hit(const void *mem_space,
+              cache_desc_t *cache,
+              phy_addr_t *paddr,
+              const uint32_t **p_line,
+              uint8_t *hit_way,
+              uint16_t *hit_index)
+{
+    PROFILE_START(start);
+    const int err = cache_lookup(mem_space, cache, paddr, p_line, hit_way, hit_index);
+    PROFILE_STOP(PROFILE_CACHE_HIT, start);
+    return err;
+}
+
+//=========================================================================
+// see cache_mng.h
+int cache_probes_attach(cache_desc_t *cache, const cache_probes_t *probes)
+{
+    M_REQUIRE_CACHE(cache);
+
+    cache->probes = (probes != NULL) ? probes : &no_probes;
+    return ERR_NONE;
+}
+
+//=========================================================================
+// see cache_mng.h
+int cache_stats_attach(cache_probes_t *probes, cache_stats_t *stats)
+{
+    M_REQUIRE_NON_NULL(probes);
+
+    probes->stats = stats;
+    return ERR_NONE;
+}
+
+//=========================================================================
+// see cache_mng.h
+int cache_heatmap_attach(cache_probes_t *probes, cache_heatmap_t *heatmap,
+                         const cache_geometry_t geometry[CACHE_LEVELS])
+{
+    M_REQUIRE_NON_NULL(probes);
+
+    if (heatmap != NULL)
     {
-    case L1_ICACHE:
-        cache_hit_process(l1_icache_entry_t, L1_ICACHE_LINE, L1_ICACHE_LINES, L1_ICACHE_TAG_REMAINING_BITS, L1_ICACHE_WAYS);
-        break;
-    case L1_DCACHE:
-        cache_hit_process(l1_dcache_entry_t, L1_DCACHE_LINE, L1_DCACHE_LINES, L1_DCACHE_TAG_REMAINING_BITS, L1_DCACHE_WAYS);
-        break;
-    case L2_CACHE:
-        cache_hit_process(l2_cache_entry_t, L2_CACHE_LINE, L2_CACHE_LINES, L2_CACHE_TAG_REMAINING_BITS, L2_CACHE_WAYS);
-        break;
-    default:
-        return ERR_BAD_PARAMETER;
+        M_REQUIRE_NON_NULL(geometry);
+        for (int level = 0; level < CACHE_LEVELS; ++level)
+        {
+            heatmap->nb_sets[level] = geometry[level].sets;
+        }
     }
+    probes->heatmap = heatmap;
     return ERR_NONE;
 }
 
 //=========================================================================
+// see cache_mng.h
+int cache_classifier_attach(cache_probes_t *probes, miss_classifier_t *classifier)
+{
+    M_REQUIRE_NON_NULL(probes);
 
-uint8_t get_index_word(uint32_t paddr, cache_t cache_type)
+    probes->classifier = classifier;
+    return ERR_NONE;
+}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hooks_attach(cache_probes_t *probes, const cache_hooks_t *hooks)
 {
-    switch (cache_type)
+    M_REQUIRE_NON_NULL(probes);
+    M_REQUIRE_NON_NULL(hooks);
+    M_REQUIRE(probes->nb_hooks < HOOKS_MAX, ERR_MEM, "already %d hook tables attached", HOOKS_MAX);
+
+    probes->hooks[probes->nb_hooks++] = hooks;
+    return ERR_NONE;
+}
+
+//=========================================================================
+// see cache_mng.h
+int cache_hooks_detach(cache_probes_t *probes, const cache_hooks_t *hooks)
+{
+    M_REQUIRE_NON_NULL(probes);
+
+    for (unsigned i = 0; i < probes->nb_hooks; ++i)
+    {
+        if (probes->hooks[i] == hooks)
+        {
+            // the others keep their order
+            memmove(&probes->hooks[i], &probes->hooks[i + 1], (probes->nb_hooks - i - 1) * sizeof(probes->hooks[0]));
+            --probes->nb_hooks;
+            return ERR_NONE;
+        }
+    }
+    M_EXIT(ERR_BAD_PARAMETER, "%s", "hook table not attached");
+}
+
+// L1 level serving a type of access
+#define l1_level(ACCESS) ((ACCESS) == INSTRUCTION ? L1_ICACHE : L1_DCACHE)
+
+// counts a lookup as a read or a write
+#define count_lookup(STATS, LEVEL, ACCESS, IS_WRITE)                  \
+    do                                                                \
+    {                                                                 \
+        if (IS_WRITE)                                                 \
+            cache_stats_count(STATS, LEVEL, ACCESS, writes);          \
+        else                                                          \
+            cache_stats_count(STATS, LEVEL, ACCESS, reads);           \
+    } while (0)
+
+// Classifies a lookup, if a classifier is attached, and counts the class of a miss
+static void classify_lookup(const cache_probes_t *probes, cache_t level, mem_access_t access,
+                            uint32_t paddr_converted, int hit)
+{
+    if (probes->classifier == NULL)
+        return;
+    switch (miss_classify(probes->classifier, level, paddr_converted, hit))
     {
-    case L1_ICACHE:
-        return (paddr >> 2) % L1_ICACHE_WORDS_PER_LINE;
-    case L1_DCACHE:
-        return (paddr >> 2) % L1_DCACHE_WORDS_PER_LINE;
-    case L2_CACHE:
-        return (paddr >> 2) % L2_CACHE_WORDS_PER_LINE;
+    case MISS_COMPULSORY:
+        cache_stats_count(probes->stats, level, access, compulsory);
+        break;
+    case MISS_CAPACITY:
+        cache_stats_count(probes->stats, level, access, capacity);
+        break;
+    case MISS_CONFLICT:
+        cache_stats_count(probes->stats, level, access, conflict);
+        break;
     default:
-        return ERR_BAD_PARAMETER;
+        break;
     }
 }
 
-#define L1_INDEX_MASK 63
-#define L2_INDEX_MASK 511
-#define WORDS_AND_BYTE_BITS 4
-
-#define search_empty_space_or_old_entry(TYPE, WAYS, cold_case, line_to_eject, age_max_found, way_to_insert, line_index, paddr_evicted, REMAINING_BITS) \
-    {                                                                                                                                                  \
-        *(cold_case) = 0;                                                                                                                              \
-        *(age_max_found) = -1;                                                                                                                         \
-        *(way_to_insert) = -1;                                                                                                                         \
-        *(paddr_evicted) = -1;                                                                                                                         \
-        foreach_way(index_of_way, WAYS)                                                                                                                \
-        {                                                                                                                                              \
-            if (cache_valid(TYPE, WAYS, line_index, index_of_way) == 0)                                                                                \
-            {                                                                                                                                          \
-                *(cold_case) = 1;                                                                                                                      \
-                *(way_to_insert) = index_of_way;                                                                                                       \
-            }                                                                                                                                          \
-            uint8_t age_of_current_way = cache_age(TYPE, WAYS, line_index, index_of_way);                                                              \
-            if (*(age_max_found) < age_of_current_way)                                                                                                 \
-            {                                                                                                                                          \
-                *(age_max_found) = age_of_current_way;                                                                                                 \
-                *(way_to_insert) = index_of_way;                                                                                                       \
-                *(line_to_eject) = cache_line(TYPE, WAYS, line_index, index_of_way);                                                                   \
-                *(paddr_evicted) = (cache_tag(TYPE, WAYS, line_index, index_of_way) << REMAINING_BITS) | (line_index << WORDS_AND_BYTE_BITS);          \
-            }                                                                                                                                          \
-        }                                                                                                                                              \
+// Inserts a line into one cache level, evicting the LRU way if the set is full.
+// On eviction, *evicted is set and the victim (address and content) is copied out.
+// The fill is counted for the given type of access by the given probes.
+static int insert_line(cache_desc_t *desc, cache_t cache_type, uint32_t paddr_converted,
+                       const word_t *line, int *evicted, uint32_t *evicted_paddr,
+                       word_t *evicted_line, mem_access_t access, const cache_probes_t *probes)
+{
+    const cache_geometry_t *geometry = &desc->geometry;
+    const cache_kernels_t *kernel = desc->kernels;
+    void *cache = desc->data;
+    const uint16_t line_index = set_index(geometry, paddr_converted);
+    uint8_t way = 0;
+    const int cold_case = kernel->select_way(geometry, cache, line_index, &way);
+
+    *evicted = 0;
+    if (cold_case)
+    {
+        cache_stats_count(probes->stats, cache_type, access, cold_fills);
+    }
+    else
+    {
+        cache_stats_count(probes->stats, cache_type, access, evictions);
+        heatmap_count(probes->heatmap, cache_type, line_index, evictions);
+        const word_t *victim = cache_line_at(geometry, cache, line_index, way);
+        *evicted = 1;
+        *evicted_paddr = (cache_tags(geometry, cache, line_index)[way] << geometry->tag_shift) |
+                         ((uint32_t)line_index << geometry->offset_bits);
+        fire_hook(probes, on_evict, cache_type, line_index, way, *evicted_paddr);
+        for (uint32_t i = 0; i < geometry->words_per_line; ++i)
+        {
+            evicted_line[i] = victim[i];
+        }
+        kernel->age_update(geometry, cache, line_index, way);
+    }
+
+    kernel->fill(geometry, cache, line_index, way, tag_of(geometry, paddr_converted), line);
+    fire_hook(probes, on_fill, cache_type, line_index, way, paddr_converted);
+
+    if (cold_case)
+    {
+        kernel->age_increase(geometry, cache, line_index, way);
     }
+    return ERR_NONE;
+}
 
-#define L2_NUMBER_OF_BITS_OF_INDEX_SELECT 9
-
-#define deplacement_from_level2_to_level1(TYPE, REMAINING_BITS, WAYS, LINE, CACHE_TYPE, CACHE_WORDS_PER_LINE, HIT_INDEX) \
-    /**lines infos */                                                                                                    \
-    {                                                                                                                    \
-        /**invalidate in cache 2 */                                                                                      \
-        void *cache = l2_cache;                                                                                          \
-        cache_valid(l2_cache_entry_t, L2_CACHE_WAYS, hit_index, hit_way) = 0;                                            \
-        uint32_t new_paddr = ((cache_tag(l2_cache_entry_t, L2_CACHE_WAYS, hit_index, hit_way)                            \
-                               << L2_NUMBER_OF_BITS_OF_INDEX_SELECT) |                                                   \
-                              HIT_INDEX)                                                                                 \
-                             << WORDS_AND_BYTE_BITS;                                                                     \
-                                                                                                                         \
-        /*search the right place to insert in l1_cache */                                                                \
-        find_place_in_l1(TYPE, REMAINING_BITS, WAYS, LINE, new_paddr, CACHE_TYPE, CACHE_WORDS_PER_LINE);                 \
+// Places a line in L1; the L1 victim, if any, goes to L2 (exclusive policy).
+// Whatever L2 evicts in turn is simply dropped: caches are write-through.
+static int insert_in_l1(cache_desc_t *l1_cache, cache_desc_t *l2_cache, mem_access_t access,
+                        uint32_t paddr_converted, const word_t *line,
+                        const cache_probes_t *probes)
+{
+    const cache_t l1_type = l1_level(access);
+    int evicted = 0;
+    uint32_t evicted_paddr = 0;
+    word_t evicted_line[CACHE_MAX_WORDS_PER_LINE];
+    M_EXIT_IF_ERR(insert_line(l1_cache, l1_type, paddr_converted, line,
+                              &evicted, &evicted_paddr, evicted_line, access, probes),
+                  "inserting in L1");
+    if (evicted)
+    {
+        cache_stats_count(probes->stats, l1_type, access, victim_inserts);
+        if (probes->classifier != NULL)
+            miss_classify_victim(probes->classifier, evicted_paddr);
+        int l2_evicted = 0;
+        uint32_t l2_evicted_paddr = 0;
+        word_t l2_evicted_line[CACHE_MAX_WORDS_PER_LINE];
+        M_EXIT_IF_ERR(insert_line(l2_cache, L2_CACHE, evicted_paddr, evicted_line,
+                                  &l2_evicted, &l2_evicted_paddr, l2_evicted_line, access, probes),
+                      "inserting L1 victim in L2");
     }
+    return ERR_NONE;
+}
 
-#define find_place_in_l1(TYPE, REMAINING_BITS, WAYS, LINE, new_paddr, CACHE_TYPE, CACHE_WORDS_PER_LINE)                                                                                                                     \
-    {                                                                                                                                                                                                                       \
-        cache = l1_cache;                                                                                                                                                                                                   \
-        uint32_t paddr_to_evict = -1;                                                                                                                                                                                       \
-        word_t *line_of_old_entry = NULL;                                                                                                                                                                                   \
-        find_place_in_cache(TYPE, REMAINING_BITS, WAYS, LINE, new_paddr, CACHE_TYPE, CACHE_WORDS_PER_LINE,                                                                                                                  \
-                            L1_INDEX_MASK, &paddr_to_evict, &line_of_old_entry);                                                                                                                                            \
-        cache = l2_cache;                                                                                                                                                                                                   \
-        uint32_t paddr_evicted = -1;                                                                                                                                                                                        \
-        word_t *line_of_old_entry_evicted = NULL;                                                                                                                                                                           \
-        find_place_in_cache(l2_cache_entry_t, L2_CACHE_TAG_REMAINING_BITS, L2_CACHE_WAYS, line_of_old_entry, paddr_to_evict, L2_CACHE, L2_CACHE_WORDS_PER_LINE, L2_INDEX_MASK, &paddr_evicted, &line_of_old_entry_evicted); \
+// Gets the line containing paddr after an L1 miss: it is moved out of L2
+// on L2 hit (exclusive policy), or else fetched from main memory.
+static int fetch_line(const void *mem_space, cache_desc_t *l2_cache, phy_addr_t *paddr, word_t *line,
+                      mem_access_t access, int is_write, const cache_probes_t *probes)
+{
+    const cache_geometry_t *geometry = &l2_cache->geometry;
+    count_lookup(probes->stats, L2_CACHE, access, is_write);
+    const uint32_t set = set_index(geometry, paddr_to_uint32_t(paddr));
+    heatmap_count(probes->heatmap, L2_CACHE, set, accesses);
+    const uint32_t *p_line = NULL;
+    uint8_t hit_way = HIT_WAY_MISS;
+    uint16_t hit_index = HIT_INDEX_MISS;
+    M_EXIT_IF_ERR(cache_hit(mem_space, l2_cache, paddr, &p_line, &hit_way, &hit_index),
+                  "calling cache_hit() on L2");
+    classify_lookup(probes, L2_CACHE, access, paddr_to_uint32_t(paddr), hit_way != HIT_WAY_MISS);
+
+    if (hit_way == HIT_WAY_MISS)
+    {
+        cache_stats_count(probes->stats, L2_CACHE, access, misses);
+        fire_hook(probes, on_miss, L2_CACHE, set, HIT_WAY_MISS, paddr_to_uint32_t(paddr));
+        heatmap_count(probes->heatmap, L2_CACHE, set, misses);
+        p_line = get_line_from_mem_space(mem_space, paddr_to_uint32_t(paddr), geometry->line_size);
+    }
+    for (uint32_t i = 0; i < geometry->words_per_line; ++i)
+    {
+        line[i] = p_line[i];
     }
+    if (hit_way != HIT_WAY_MISS)
+    {
+        cache_stats_count(probes->stats, L2_CACHE, access, hits);
+        cache_stats_count(probes->stats, l1_level(access), access, promotions);
+        fire_hook(probes, on_hit, L2_CACHE, hit_index, hit_way, paddr_to_uint32_t(paddr));
+        fire_hook(probes, on_promote, L2_CACHE, hit_index, hit_way, paddr_to_uint32_t(paddr));
+        cache_valid_mask(geometry, l2_cache->data, hit_index) &= (uint16_t)~(1u << hit_way);
+    }
+    return ERR_NONE;
+}
+
+// Reads a word through the cache hierarchy (see cache_read()). The access is
+// counted as a read, or as a write for the read part of a byte write.
+static int read_word(const void *mem_space, phy_addr_t *paddr, mem_access_t access,
+                     cache_desc_t *l1_cache, cache_desc_t *l2_cache, uint32_t *word,
+                     int is_write, const cache_probes_t *probes)
+{
+    const uint32_t paddr_converted = paddr_to_uint32_t(paddr);
+    check_well_aligned(paddr_converted, sizeof(word_t));
+    const cache_t cache_type = l1_level(access);
+    const cache_geometry_t *geometry = &l1_cache->geometry;
+    count_lookup(probes->stats, cache_type, access, is_write);
+    const uint32_t set = set_index(geometry, paddr_converted);
+    heatmap_count(probes->heatmap, cache_type, set, accesses);
 
-#define find_place_in_cache(TYPE, REMAINING_BITS, WAYS, LINE, PADDR_CONVERTED, CACHE_TYPE, CACHE_WORDS_PER_LINE, INDEX_MASK, paddr_evicted, line_of_old_entry_evicted) \
-    {                                                                                                                                                                  \
-        uint8_t age_max = -1;                                                                                                                                          \
-        uint8_t way_to_insert = -1;                                                                                                                                    \
-        *paddr_evicted = -1;                                                                                                                                           \
-        uint8_t cold_case = 0;                                                                                                                                         \
-        uint16_t line_index = (PADDR_CONVERTED >> WORDS_AND_BYTE_BITS) & INDEX_MASK;                                                                                   \
-        search_empty_space_or_old_entry(TYPE, WAYS, &cold_case,                                                                                                        \
-                                        line_of_old_entry_evicted, &age_max, &way_to_insert, line_index, paddr_evicted, REMAINING_BITS);                               \
-                                                                                                                                                                       \
-        TYPE new_cache_entry;                                                                                                                                          \
-        new_cache_entry.v = 1;                                                                                                                                         \
-        new_cache_entry.tag = PADDR_CONVERTED >> REMAINING_BITS;                                                                                                       \
-        new_cache_entry.age = 0;                                                                                                                                       \
-        for (int i = 0; i < CACHE_WORDS_PER_LINE; ++i)                                                                                                                 \
-        {                                                                                                                                                              \
-            new_cache_entry.line[i] = LINE[i];                                                                                                                         \
-        }                                                                                                                                                              \
-        /*coldcase case*/                                                                                                                                              \
-        if (cold_case == 1)                                                                                                                                            \
-        {                                                                                                                                                              \
-            M_REQUIRE_NO_ERRNO(cache_insert(line_index, way_to_insert, &new_cache_entry, l1_cache, CACHE_TYPE));                                                       \
-            LRU_age_increase(TYPE, WAYS, way_to_insert, line_index);                                                                                                   \
-            return ERR_NONE;                                                                                                                                           \
-        }                                                                                                                                                              \
-                                                                                                                                                                       \
-        /**there was no cold start : eviction*/                                                                                                                        \
-        M_REQUIRE_NO_ERRNO(cache_insert(line_index, way_to_insert, &new_cache_entry, l1_cache, CACHE_TYPE));                                                           \
-        LRU_age_update(TYPE, WAYS, way_to_insert, line_index);                                                                                                         \
+    //SEARCH IN FIRST LEVEL
+    const uint32_t *p_line = NULL;
+    uint8_t hit_way = HIT_WAY_MISS;
+    uint16_t hit_index = HIT_INDEX_MISS;
+    M_EXIT_IF_ERR(cache_hit(mem_space, l1_cache, paddr, &p_line, &hit_way, &hit_index),
+                  "calling cache_hit() on L1");
+    classify_lookup(probes, cache_type, access, paddr_converted, hit_way != HIT_WAY_MISS);
+    if (hit_way != HIT_WAY_MISS)
+    {
+        cache_stats_count(probes->stats, cache_type, access, hits);
+        fire_hook(probes, on_hit, cache_type, hit_index, hit_way, paddr_converted);
+        *word = p_line[word_index(geometry, paddr_converted)];
+        return ERR_NONE;
     }
+    cache_stats_count(probes->stats, cache_type, access, misses);
+    fire_hook(probes, on_miss, cache_type, set, HIT_WAY_MISS, paddr_converted);
+    heatmap_count(probes->heatmap, cache_type, set, misses);
+
+    //SEARCH IN SECOND LEVEL, OR ELSE IN MEMORY
+    word_t line[CACHE_MAX_WORDS_PER_LINE];
+    M_EXIT_IF_ERR(fetch_line(mem_space, l2_cache, paddr, line, access, is_write, probes),
+                  "calling fetch_line()");
+    *word = line[word_index(geometry, paddr_converted)];
+
+    return insert_in_l1(l1_cache, l2_cache, access, paddr_converted, line, probes);
+}
 
 /**
  * @brief Ask cache for a word of data.
@@ -404,8 +827,8 @@ uint8_t get_index_word(uint32_t paddr, cache_t cache_type)
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
  * @param access to distinguish between fetching instructions and reading/writing data
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache the L1 cache
+ * @param l2_cache the L2 cache
  * @param word pointer to the word of data that is returned by cache
  * @param replace replacement policy
  * @return error code
@@ -413,8 +836,8 @@ uint8_t get_index_word(uint32_t paddr, cache_t cache_type)
 int cache_read(const void *mem_space,
                phy_addr_t *paddr,
                mem_access_t access,
-               void *l1_cache,
-               void *l2_cache,
+               cache_desc_t *l1_cache,
+               cache_desc_t *l2_cache,
                uint32_t *word,
                cache_replace_t replace)
 {
@@ -422,90 +845,15 @@ int cache_read(const void *mem_space,
     M_REQUIRE(replace == LRU, ERR_POLICY, "not implemented this policy of remplacement%c", ' ');
     M_REQUIRE_NON_NULL(mem_space);
     M_REQUIRE_NON_NULL(paddr);
-    M_REQUIRE_NON_NULL(l1_cache);
-    M_REQUIRE_NON_NULL(l2_cache);
+    M_REQUIRE_HIERARCHY(l1_cache, l2_cache);
     M_REQUIRE_NON_NULL(word);
 
-    //inclure la vérification de l'adresse fournie est bien alignée sur des adresses de mots : Comment ???
-
-    //SEARCH IN FIRST LEVEL
-    uint32_t paddr_converted = paddr_to_uint32_t(paddr);
-    cache_t cache_type;
-    if (access == INSTRUCTION)
-    {
-        check_well_aligned(l1_icache_entry_t, paddr_converted, L1_ICACHE_LINE);
-        cache_type = L1_ICACHE;
-    }
-    else
-    {
-        check_well_aligned(l1_dcache_entry_t, paddr_converted, L1_DCACHE_LINE);
-        cache_type = L1_DCACHE;
-    }
-    const uint32_t *line = NULL;
-    uint8_t hit_way = HIT_WAY_MISS;
-    uint16_t hit_index = HIT_INDEX_MISS;
-    M_REQUIRE_NO_ERRNO(cache_hit(mem_space, l1_cache, paddr, &line, &hit_way, &hit_index, cache_type));
-
-    //if hit at the first level
-    if (hit_way != HIT_WAY_MISS)
-    {
-        M_REQUIRE_NON_NULL(line);
-        // uint8_t index_word = get_index_word(paddr, cache_type);
-        // *word = *(line + index_word);
-        if (access == INSTRUCTION)
-        {
-            *word = line[get_index_word(paddr_converted, L1_ICACHE)];
-        }
-        else
-        {
-            *word = line[get_index_word(paddr_converted, L1_DCACHE)];
-        }
-        return ERR_NONE;
-    }
-
-    //SEARCH IN SECOND LEVEL
-
-    line = NULL;
-    M_REQUIRE_NO_ERRNO(cache_hit(mem_space, l2_cache, paddr, &line, &hit_way, &hit_index, cache_type));
-    void *cache = l2_cache;
-    if (hit_way == HIT_WAY_MISS)
-    {
-        l2_cache_entry_t the_new_cache_entry;
-        M_REQUIRE_NO_ERRNO(cache_entry_init(mem_space, paddr, &the_new_cache_entry, L2_CACHE));
-        line = the_new_cache_entry.line;
-
-        if (cache_type == L1_ICACHE)
-        {
-            *word = line[get_index_word(paddr_converted, L1_ICACHE)];
-            find_place_in_l1(l1_icache_entry_t, L1_ICACHE_TAG_REMAINING_BITS,
-                             L1_ICACHE_WAYS, line, paddr_converted, cache_type, L1_ICACHE_WORDS_PER_LINE);
-        }
-        else
-        {
-            *word = line[get_index_word(paddr_converted, L1_DCACHE)];
-            find_place_in_l1(l1_dcache_entry_t, L1_DCACHE_TAG_REMAINING_BITS,
-                             L1_DCACHE_WAYS, line, paddr_converted, cache_type, L1_DCACHE_WORDS_PER_LINE);
-        }
-        return ERR_NONE;
-    }
-
-    //hit_way != HIT_WAY_MISS
-    if (cache_type == L1_ICACHE)
-    {
-        *word = line[get_index_word(paddr_converted, L1_ICACHE)];
-        deplacement_from_level2_to_level1(l1_icache_entry_t, L1_ICACHE_TAG_REMAINING_BITS,
-                                          L1_ICACHE_WAYS, line, paddr_converted, cache_type, L1_ICACHE_WORDS_PER_LINE);
-    }
-    else
-    {
-        *word = line[get_index_word(paddr_converted, L1_DCACHE)];
-        deplacement_from_level2_to_level1(l1_dcache_entry_t, L1_DCACHE_TAG_REMAINING_BITS,
-                                          L1_DCACHE_WAYS, line, paddr_converted, cache_type, L1_DCACHE_WORDS_PER_LINE);
-    }
-    return ERR_NONE;
+    PROFILE_START(start);
+    const int err = read_word(mem_space, paddr, access, l1_cache, l2_cache, word, 0, l1_cache->probes);
+    PROFILE_STOP(PROFILE_CACHE_READ, start);
+    return err;
 }
 
-#define SELECT_BITS 2
 #define ALIGNED_OF_WORDS_NUMBER 4
 #define OCTET 8
 #define BYTE_MASK 255
@@ -517,8 +865,8 @@ int cache_read(const void *mem_space,
  * @param mem_space pointer to the memory space
  * @param p_addr pointer to a physical address
  * @param access to distinguish between fetching instructions and reading/writing data
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache the L1 cache
+ * @param l2_cache the L2 cache
  * @param byte pointer to the byte to be returned
  * @param replace replacement policy
  * @return error code
@@ -526,31 +874,26 @@ int cache_read(const void *mem_space,
 int cache_read_byte(const void *mem_space,
                     phy_addr_t *p_paddr,
                     mem_access_t access,
-                    void *l1_cache,
-                    void *l2_cache,
+                    cache_desc_t *l1_cache,
+                    cache_desc_t *l2_cache,
                     uint8_t *p_byte,
                     cache_replace_t replace)
 {
     M_REQUIRE_NON_NULL(mem_space);
     M_REQUIRE_NON_NULL(p_paddr);
-    M_REQUIRE_NON_NULL(l1_cache);
-    M_REQUIRE_NON_NULL(l2_cache);
     M_REQUIRE_NON_NULL(p_byte);
 
-    check_well_aligned(l1_dcache_entry_t, paddr_to_uint32_t(p_paddr), L1_DCACHE_LINE);
     phy_addr_t paddr_aligned;
     uint8_t bit_select = p_paddr->page_offset % ALIGNED_OF_WORDS_NUMBER;
     paddr_aligned.page_offset = p_paddr->page_offset - bit_select;
     paddr_aligned.phy_page_num = p_paddr->phy_page_num;
-    uint32_t word_of_result = -1;
-    M_REQUIRE_NO_ERRNO(cache_read(mem_space, &paddr_aligned, access, l1_cache, l2_cache, &word_of_result, replace));
+    uint32_t word_of_result = 0;
+    M_EXIT_IF_ERR(cache_read(mem_space, &paddr_aligned, access, l1_cache, l2_cache, &word_of_result, replace),
+                  "calling cache_read()");
     *p_byte = (word_of_result >> (bit_select * OCTET)) & BYTE_MASK;
     return ERR_NONE;
 }
 
-#define get_index_line_from_paddr(PADDR, MASK_TYPE) \
-    (((paddr_to_uint32_t(PADDR)) >> (2 + 2)) & MASK_TYPE)
-
 void update_memory(void *mem_space, phy_addr_t *physical_address,
                    size_t lines, size_t words_per_line, const uint32_t *line_to_insert)
 {
@@ -561,34 +904,65 @@ void update_memory(void *mem_space, phy_addr_t *physical_address,
     }
 }
 
-//=========================================================================
-
-#define WORD_INDEX_MASK 3
+// Writes a word through the cache hierarchy (see cache_write()), counting it as a write
+static int write_word(void *mem_space, phy_addr_t *paddr, cache_desc_t *l1_cache, cache_desc_t *l2_cache,
+                      const uint32_t *word, const cache_probes_t *probes)
+{
+    const uint32_t paddr_converted = paddr_to_uint32_t(paddr);
+    check_well_aligned(paddr_converted, sizeof(word_t));
+    const cache_geometry_t *geometry = &l1_cache->geometry;
+    const uint32_t index_of_word = word_index(geometry, paddr_converted);
+    cache_stats_count(probes->stats, L1_DCACHE, DATA, writes);
+    const uint32_t set = set_index(geometry, paddr_converted);
+    heatmap_count(probes->heatmap, L1_DCACHE, set, accesses);
+
+    //search in first level: write-through on hit
+    const uint32_t *p_line = NULL;
+    uint8_t hit_way = HIT_WAY_MISS;
+    uint16_t hit_index = HIT_INDEX_MISS;
+    M_EXIT_IF_ERR(cache_hit(mem_space, l1_cache, paddr, &p_line, &hit_way, &hit_index),
+                  "calling cache_hit() on L1");
+    classify_lookup(probes, L1_DCACHE, DATA, paddr_converted, hit_way != HIT_WAY_MISS);
+    if (hit_way != HIT_WAY_MISS)
+    {
+        cache_stats_count(probes->stats, L1_DCACHE, DATA, hits);
+        fire_hook(probes, on_hit, L1_DCACHE, hit_index, hit_way, paddr_converted);
+        word_t *hit_line = cache_line_at(geometry, l1_cache->data, hit_index, hit_way);
+        hit_line[index_of_word] = *word;
+        update_memory(mem_space, paddr, geometry->line_size, geometry->words_per_line, hit_line);
+        return ERR_NONE;
+    }
+    cache_stats_count(probes->stats, L1_DCACHE, DATA, misses);
+    fire_hook(probes, on_miss, L1_DCACHE, set, HIT_WAY_MISS, paddr_converted);
+    heatmap_count(probes->heatmap, L1_DCACHE, set, misses);
+
+    //search in second level, or else in memory: write-allocate
+    word_t line[CACHE_MAX_WORDS_PER_LINE];
+    M_EXIT_IF_ERR(fetch_line(mem_space, l2_cache, paddr, line, DATA, 1, probes),
+                  "calling fetch_line()");
+    line[index_of_word] = *word;
+    update_memory(mem_space, paddr, geometry->line_size, geometry->words_per_line, line);
+
+    return insert_in_l1(l1_cache, l2_cache, DATA, paddr_converted, line, probes);
+}
 
-#define write_process(TYPE, TYPE_ENUM, INDEX_MASK, WAYS, LINES, WORDS_PER_LINE)                       \
-    uint32_t line_index = get_index_line_from_paddr(paddr, INDEX_MASK);                               \
-    cache_line(TYPE, WAYS, line_index, hit_way)[hit_index] = *word;                                   \
-    M_REQUIRE_NO_ERRNO(cache_insert(line_index, hit_way,                                              \
-                                    cache_entry(TYPE, WAYS, line_index, hit_way), cache, TYPE_ENUM)); \
-    LRU_age_update(TYPE, WAYS, hit_way, line_index); /*check if good one */                           \
-    update_memory(mem_space, paddr, LINES, WORDS_PER_LINE, line);                                     \
-    M_REQUIRE_NO_ERRNO(cache_hit(mem_space, l1_cache, paddr, &line, &hit_way, &hit_index, TYPE_ENUM));
+//=========================================================================
 /**
  * @brief Change a word of data in the cache.
  *  Exclusive policy (see cache_read)
  *
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache the L1 cache (of data: instructions are not written)
+ * @param l2_cache the L2 cache
  * @param word const pointer to the word of data that is to be written to the cache
  * @param replace replacement policy
  * @return error code
  */
 int cache_write(void *mem_space,
                 phy_addr_t *paddr,
-                void *l1_cache, //must be of type l1_dcache_entry_t, we do not write instructions
-                void *l2_cache,
+                cache_desc_t *l1_cache,
+                cache_desc_t *l2_cache,
                 const uint32_t *word,
                 cache_replace_t replace)
 {
@@ -596,47 +970,13 @@ int cache_write(void *mem_space,
     M_REQUIRE(replace == LRU, ERR_POLICY, "not implemented this policy of remplacement%c", ' ');
     M_REQUIRE_NON_NULL(mem_space);
     M_REQUIRE_NON_NULL(paddr);
-    M_REQUIRE_NON_NULL(l1_cache);
-    M_REQUIRE_NON_NULL(l2_cache);
+    M_REQUIRE_HIERARCHY(l1_cache, l2_cache);
     M_REQUIRE_NON_NULL(word);
 
-    //inclure la vérification de l'adresse fournie est bien alignée sur des adresses de mots : Comment ???
-    //search in first level
-
-    const uint32_t *line = NULL;
-    uint8_t hit_way = HIT_WAY_MISS;
-    uint16_t hit_index = HIT_INDEX_MISS;
-    if (hit_way != HIT_WAY_MISS)
-    {
-        void *cache = l1_cache;
-        write_process(l1_dcache_entry_t, L1_DCACHE, L1_INDEX_MASK, L1_DCACHE_WAYS, L1_DCACHE_LINES, L1_DCACHE_WORDS_PER_LINE);
-        return ERR_NONE;
-    }
-
-    //search in second level
-    M_REQUIRE_NO_ERRNO(cache_hit(mem_space, l2_cache, paddr, &line, &hit_way, &hit_index, L2_CACHE));
-    if (hit_way != HIT_WAY_MISS)
-    {
-        void *cache = l2_cache;
-        write_process(l2_cache_entry_t, L2_CACHE, L2_INDEX_MASK, L2_CACHE_WAYS, L2_CACHE_LINES, L2_CACHE_WORDS_PER_LINE);
-        return ERR_NONE;
-    }
-    //nothing was found
-    word_t line_to_store[L1_DCACHE_WORDS_PER_LINE];
-    uint32_t paddr_converted = paddr_to_uint32_t(paddr);
-    word_t *address = get_line_from_mem_space(mem_space, paddr_converted, L1_DCACHE_LINE);
-    for (int i = 0; i < L1_DCACHE_WORDS_PER_LINE; i++)
-    {
-        line_to_store[i] = address[i];
-    }
-    uint8_t word_index = (paddr_converted >> 2) & WORD_INDEX_MASK;
-    line_to_store[word_index] = *word;
-    update_memory(mem_space, paddr, L1_DCACHE_LINES, L1_DCACHE_WORDS_PER_LINE, line_to_store);
-
-    void *cache = l1_cache;
-    find_place_in_l1(l1_dcache_entry_t, L1_DCACHE_TAG_REMAINING_BITS,
-                     L1_DCACHE_WAYS, line_to_store, paddr_converted, L1_DCACHE, L1_DCACHE_WORDS_PER_LINE);
-    return ERR_NONE;
+    PROFILE_START(start);
+    const int err = write_word(mem_space, paddr, l1_cache, l2_cache, word, l1_cache->probes);
+    PROFILE_STOP(PROFILE_CACHE_WRITE, start);
+    return err;
 }
 
 /**
@@ -644,16 +984,16 @@ int cache_write(void *mem_space,
  *
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
- * @param l1_cache pointer to the beginning of L1 ICACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache the L1 cache (of data)
+ * @param l2_cache the L2 cache
  * @param p_byte pointer to the byte to be returned
  * @param replace replacement policy
  * @return error code
  */
 int cache_write_byte(void *mem_space,
                      phy_addr_t *paddr,
-                     void *l1_cache,
-                     void *l2_cache,
+                     cache_desc_t *l1_cache,
+                     cache_desc_t *l2_cache,
                      uint8_t p_byte,
                      cache_replace_t replace)
 {
@@ -661,29 +1001,20 @@ int cache_write_byte(void *mem_space,
     M_REQUIRE(replace == LRU, ERR_POLICY, "not implemented this policy of remplacement%c", ' ');
     M_REQUIRE_NON_NULL(mem_space);
     M_REQUIRE_NON_NULL(paddr);
-    M_REQUIRE_NON_NULL(l1_cache);
-    M_REQUIRE_NON_NULL(l2_cache);
+    M_REQUIRE_HIERARCHY(l1_cache, l2_cache);
 
     phy_addr_t paddr_aligned;
     uint8_t bit_select = paddr->page_offset % ALIGNED_OF_WORDS_NUMBER;
     paddr_aligned.page_offset = paddr->page_offset - bit_select;
     paddr_aligned.phy_page_num = paddr->phy_page_num;
-    uint32_t word = -1;
-    M_REQUIRE_NO_ERRNO(cache_read(mem_space, &paddr_aligned, L1_DCACHE, l1_cache, l2_cache, &word, replace));
-    switch (bit_select)
-    {
-    case 0:
-        word = (word & 0xFFFFFF00) | p_byte;
-        break;
-    case 1:
-        word = (word & 0xFFF00FF) | (p_byte << OCTET);
-        break;
-    case 2:
-        word = (word & 0xFF00FFFF) | (p_byte << OCTET * 2);
-        break;
-    default:
-        word = (word & 0x00FFFFFF) | (p_byte << OCTET * 3);
-        break;
-    }
-    return cache_write(mem_space, &paddr_aligned, l1_cache, l2_cache, &word, replace);
+    PROFILE_START(start);
+    // read-modify-write, counted as a single write: the word write always hits L1
+    uint32_t word = 0;
+    M_EXIT_IF_ERR(read_word(mem_space, &paddr_aligned, DATA, l1_cache, l2_cache, &word, 1, l1_cache->probes),
+                  "reading the word to be modified");
+    const uint32_t shift = bit_select * OCTET;
+    word = (word & ~((uint32_t)BYTE_MASK << shift)) | ((uint32_t)p_byte << shift);
+    const int err = write_word(mem_space, &paddr_aligned, l1_cache, l2_cache, &word, &no_probes);
+    PROFILE_STOP(PROFILE_CACHE_WRITE, start);
+    return err;
 }
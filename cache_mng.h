@@ -11,6 +11,10 @@
 #include "mem_access.h"
 #include "addr.h"
 #include "cache.h"
+#include "stats.h"
+#include "miss_class.h"
+#include "hooks.h"
+#include "probes.h"
 #include <stdio.h> // for FILE
 
 enum cache_replacement_policy { LRU };
@@ -27,16 +31,68 @@ typedef enum cache_replacement_policy cache_replace_t;
 #define foreach_way(var, ways) \
   for (uint8_t var = 0; var < (ways); var++)
 
+//=========================================================================
+/**
+ * @brief Check a cache geometry and derive its other fields (see cache.h).
+ *
+ * @param geometry (modified) the geometry to be initialized
+ * @param sets number of sets
+ * @param ways number of ways
+ * @param line_size number of bytes per line
+ * @param word_size number of bytes per word
+ * @return error code, ERR_BAD_PARAMETER if the geometry is out of the limits of cache.h
+ */
+int cache_geometry_init(cache_geometry_t* geometry, uint32_t sets, uint32_t ways,
+                        uint32_t line_size, uint32_t word_size);
+
+//=========================================================================
+/**
+ * @brief Get the default geometry of a level (see cache.h).
+ * @param cache_type the level
+ * @return the geometry, NULL for an unknown level
+ */
+const cache_geometry_t* cache_default_geometry(cache_t cache_type);
+
+//=========================================================================
+/**
+ * @brief Check that geometries can make a cache hierarchy: each of them is
+ *        within the limits of cache.h, and all have the same line size
+ *        (lines move between L1 and L2).
+ * @param geometry the geometries, indexed by cache_t
+ * @return error code, ERR_BAD_PARAMETER if they cannot
+ */
+int cache_hierarchy_check(const cache_geometry_t geometry[CACHE_LEVELS]);
+
+//=========================================================================
+/**
+ * @brief "Constructor" for cache_desc_t: allocate a flushed cache of a
+ *        geometry, with the kernels of that geometry.
+ *
+ * This is the only way to set the geometry of a cache: another geometry
+ * takes another cache (cache_free() the old one).
+ * @param cache (modified) the cache to be allocated
+ * @param geometry its geometry (see cache_geometry_init())
+ * @return error code
+ */
+int cache_alloc(cache_desc_t* cache, const cache_geometry_t* geometry);
+
+//=========================================================================
+/**
+ * @brief "Destructor" for cache_desc_t: free its storage.
+ * @param cache the cache to be freed
+ * @return error code
+ */
+int cache_free(cache_desc_t* cache);
+
 //=========================================================================
 /**
  * @brief Clean a cache (invalidate, reset...).
  *
  * This function erases all cache data.
- * @param cache pointer to the cache
- * @param cache_type an enum to distinguish between different caches
+ * @param cache the cache
  * @return error code
  */
-int cache_flush(void *cache, cache_t cache_type);
+int cache_flush(cache_desc_t *cache);
 
 //=========================================================================
 /**
@@ -47,22 +103,20 @@ int cache_flush(void *cache, cache_t cache_type);
  * On miss, update hit infos to HIT_WAY_MISS or HIT_INDEX_MISS.
  *
  * @param mem_space starting address of the memory space
- * @param cache pointer to the beginning of the cache
+ * @param cache the cache
  * @param paddr pointer to physical address
  * @param p_line pointer to a cache-line-size chunk of data to return
  * @param hit_way (modified) cache way where hit was detected, HIT_WAY_MISS on miss
  * @param hit_index (modified) cache line index where hit was detected, HIT_INDEX_MISS on miss
- * @param cache_type to distinguish between different caches
  * @return error code
  */
 
 int cache_hit (const void * mem_space,
-               void * cache,
+               cache_desc_t * cache,
                phy_addr_t * paddr,
                const uint32_t ** p_line,
                uint8_t *hit_way,
-               uint16_t *hit_index,
-               cache_t cache_type);
+               uint16_t *hit_index);
 
 //=========================================================================
 /**
@@ -71,15 +125,13 @@ int cache_hit (const void * mem_space,
  * @param cache_line_index the number of the line to overwrite
  * @param cache_way the number of the way where to insert
  * @param cache_line_in pointer to the cache line to insert
- * @param cache pointer to the cache
- * @param cache_type to distinguish between different caches
+ * @param cache the cache
  * @return error code
  */
 int cache_insert(uint16_t cache_line_index,
                  uint8_t cache_way,
                  const void * cache_line_in,
-                 void * cache,
-                 cache_t cache_type);
+                 cache_desc_t * cache);
 
 //=========================================================================
 /**
@@ -88,13 +140,13 @@ int cache_insert(uint16_t cache_line_index,
  * @param mem_space starting address of the memory space
  * @param paddr pointer to physical address, to extract the tag
  * @param cache_entry pointer to the entry to be initialized
- * @param cache_type to distinguish between different caches
+ * @param cache the cache the entry is for (its geometry)
  * @return error code
  */
 int cache_entry_init(const void * mem_space,
                      const phy_addr_t * paddr,
                      void * cache_entry,
-                     cache_t cache_type);
+                     const cache_desc_t * cache);
 
 //=========================================================================
 /**
@@ -114,8 +166,8 @@ int cache_entry_init(const void * mem_space,
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
  * @param access to distinguish between fetching instructions and reading/writing data
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache the L1 cache
+ * @param l2_cache the L2 cache (with lines of the same size, see cache_hierarchy_check())
  * @param word pointer to the word of data that is returned by cache
  * @param replace replacement policy
  * @return error code
@@ -123,8 +175,8 @@ int cache_entry_init(const void * mem_space,
 int cache_read(const void * mem_space,
                phy_addr_t * paddr,
                mem_access_t access,
-               void * l1_cache,
-               void * l2_cache,
+               cache_desc_t * l1_cache,
+               cache_desc_t * l2_cache,
                uint32_t * word,
                cache_replace_t replace);
 
@@ -135,8 +187,8 @@ int cache_read(const void * mem_space,
  * @param mem_space pointer to the memory space
  * @param p_addr pointer to a physical address
  * @param access to distinguish between fetching instructions and reading/writing data
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache the L1 cache
+ * @param l2_cache the L2 cache (with lines of the same size, see cache_hierarchy_check())
  * @param byte pointer to the byte to be returned
  * @param replace replacement policy
  * @return error code
@@ -144,8 +196,8 @@ int cache_read(const void * mem_space,
 int cache_read_byte(const void * mem_space,
                     phy_addr_t * p_paddr,
                     mem_access_t access,
-                    void * l1_cache,
-                    void * l2_cache,
+                    cache_desc_t * l1_cache,
+                    cache_desc_t * l2_cache,
                     uint8_t * p_byte,
                     cache_replace_t replace);
 
@@ -156,16 +208,16 @@ int cache_read_byte(const void * mem_space,
  *
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
- * @param l1_cache pointer to the beginning of L1 CACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache the L1 cache
+ * @param l2_cache the L2 cache (with lines of the same size, see cache_hierarchy_check())
  * @param word const pointer to the word of data that is to be written to the cache
  * @param replace replacement policy
  * @return error code
  */
 int cache_write(void * mem_space,
                 phy_addr_t * paddr,
-                void * l1_cache,
-                void * l2_cache,
+                cache_desc_t * l1_cache,
+                cache_desc_t * l2_cache,
                 const uint32_t * word,
                 cache_replace_t replace);
 
@@ -175,25 +227,95 @@ int cache_write(void * mem_space,
  *
  * @param mem_space pointer to the memory space
  * @param paddr pointer to a physical address
- * @param l1_cache pointer to the beginning of L1 ICACHE
- * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param l1_cache the L1 cache
+ * @param l2_cache the L2 cache (with lines of the same size, see cache_hierarchy_check())
  * @param p_byte pointer to the byte to be returned
  * @param replace replacement policy
  * @return error code
  */
 int cache_write_byte(void * mem_space,
                      phy_addr_t * paddr,
-                     void * l1_cache,
-                     void * l2_cache,
+                     cache_desc_t * l1_cache,
+                     cache_desc_t * l2_cache,
                      uint8_t p_byte,
                      cache_replace_t replace);
 
+//=========================================================================
+/**
+ * @brief Observe the accesses entering a cache hierarchy through the given
+ *        L1 cache (cache_read(), cache_write() and their byte variants) with
+ *        the given probes (see probes.h), which must outlive their use.
+ *        A cache is allocated with probes observing nothing.
+ * @param cache the L1 cache
+ * @param probes what observes the accesses, NULL for nothing
+ * @return error code
+ */
+int cache_probes_attach(cache_desc_t* cache, const cache_probes_t* probes);
+
+//=========================================================================
+/**
+ * @brief Collect the statistics of the accesses observed by the given probes
+ *        into the given counters, which must outlive the collection.
+ *
+ * Counters are only incremented, never reset (see cache_stats_init()).
+ * When no statistics are attached (the default), the only cost is one test per event.
+ * @param probes the probes of a hierarchy
+ * @param stats the counters to be updated, NULL to stop collecting
+ * @return error code
+ */
+int cache_stats_attach(cache_probes_t* probes, cache_stats_t* stats);
+
+//=========================================================================
+/**
+ * @brief Collect per-set counters of the accesses observed by the given probes
+ *        (accesses, misses and evictions of every set of every level) into
+ *        the given heatmap, which must outlive the collection.
+ *        Its number of sets per level is set from the geometries of the caches.
+ * @param probes the probes of a hierarchy
+ * @param heatmap the counters to be updated, NULL to stop collecting
+ * @param geometry the geometries of the caches, indexed by cache_t (unused for a NULL heatmap)
+ * @return error code
+ */
+int cache_heatmap_attach(cache_probes_t* probes, cache_heatmap_t* heatmap,
+                         const cache_geometry_t geometry[CACHE_LEVELS]);
+
+//=========================================================================
+/**
+ * @brief Classify the misses observed by the given probes (see miss_class.h)
+ *        with the given classifier, which must outlive the classification.
+ *        The classes are counted in the statistics of the same probes
+ *        (see cache_stats_attach()), if any.
+ * @param probes the probes of a hierarchy
+ * @param classifier the classifier to be updated, NULL to stop classifying
+ * @return error code
+ */
+int cache_classifier_attach(cache_probes_t* probes, miss_classifier_t* classifier);
+
+//=========================================================================
+/**
+ * @brief Call the given callbacks on the events of the accesses observed by
+ *        the given probes (see hooks.h), after those of the tables already
+ *        attached (up to HOOKS_MAX). The table must outlive its use.
+ * @param probes the probes of a hierarchy
+ * @param hooks the callbacks to be called
+ * @return error code (ERR_MEM when HOOKS_MAX tables are already attached)
+ */
+int cache_hooks_attach(cache_probes_t* probes, const cache_hooks_t* hooks);
+
+//=========================================================================
+/**
+ * @brief Stop calling a table attached by cache_hooks_attach().
+ * @param probes the probes of a hierarchy
+ * @param hooks the table to be detached
+ * @return error code (ERR_BAD_PARAMETER if it was not attached)
+ */
+int cache_hooks_detach(cache_probes_t* probes, const cache_hooks_t* hooks);
+
 //=========================================================================
 /**
  * @brief Print the contents of a cache to a stream.
  * @param output the stream to print to.
- * @param cache pointer to the cache
- * @param cache_type to distinguish between different caches
+ * @param cache the cache
  * @return error code
  */
-int cache_dump(FILE* output, const void* cache, cache_t cache_type);
+int cache_dump(FILE* output, const cache_desc_t* cache);
@@ -1,4 +1,8 @@
 #include "commands.h"
+#include <string.h> // for memmove
+#include <stddef.h> // for ptrdiff_t
+
+_Static_assert(sizeof(packed_command_t) == 16, "packed commands must be 16 bytes");
 
 
 int program_init(program_t* program) {
@@ -13,15 +17,23 @@ int program_init(program_t* program) {
     return ERR_NONE;
 }
 
+int command_check(const command_t* command){
+    M_REQUIRE_NON_NULL(command);
+
+    M_REQUIRE(command->data_size == sizeof(word_t) || command->data_size == 1, ERR_BAD_PARAMETER, "data_size must be 4 (word) or 1 (byte%c", ')');
+    M_REQUIRE(!(command->type == INSTRUCTION && command->data_size != sizeof(word_t)), ERR_BAD_PARAMETER, "instructions must have size of 4 (word%c", ')');
+    M_REQUIRE(!(command->order == WRITE && command->type == INSTRUCTION), ERR_BAD_PARAMETER, "cannot write an instructio%c", 'n');
+    M_REQUIRE(command->data_size == 1 || command->vaddr.page_offset % sizeof(word_t) == 0, ERR_BAD_PARAMETER, "vaddr of a word must be word aligne%c", 'd');
+
+    return ERR_NONE;
+}
+
 int program_add_command(program_t* program, const command_t* command){
     M_EXIT_IF_NULL(program, sizeof(program_t));
     M_EXIT_IF_NULL(program->listing, program->allocated * sizeof(command_t));
     M_EXIT_IF_NULL(command, sizeof(command_t));
 
-    M_REQUIRE(command->data_size == sizeof(word_t) || command->data_size == 1, ERR_BAD_PARAMETER, "data_size must be 4 (word) or 1 (byte%c", ')');
-    M_REQUIRE(!(command->type == INSTRUCTION && command->data_size != sizeof(word_t)), ERR_BAD_PARAMETER, "instructions must have size of 4 (word%c", ')');
-    M_REQUIRE(!(command->order == WRITE && command->type == INSTRUCTION), ERR_BAD_PARAMETER, "cannot write an instructio%c", 'n');
-    M_REQUIRE(command->vaddr.page_offset % 8 == 0 || command->vaddr.page_offset % 8*sizeof(word_t) == 0, ERR_BAD_PARAMETER, "vaddr not correct%c", ' ');
+    M_EXIT_IF_ERR(command_check(command), "checking command");
 
     while (program->nb_lines >= program->allocated) {
         program->allocated *= 2;
@@ -115,178 +127,405 @@ int program_print(FILE* output, const program_t* program){
     return ERR_NONE;
 }
 
-//checks if the command load Word or Byte and updates the command
-int word_or_byte(FILE* entree, command_t* command);
+// the characters isspace() accepts in the "C" locale
+static const uint8_t BLANK[256] = {
+    [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1
+};
+
+// Hex digits are decoded 8 at a time, one per byte of a 64-bit word (SWAR)
+
+// loads 8 characters, the first one in the lowest byte (a single load on little-endian targets)
+static inline uint64_t load_chars8(const unsigned char* p){
+    return (uint64_t) p[0] | (uint64_t) p[1] << 8 | (uint64_t) p[2] << 16 | (uint64_t) p[3] << 24
+         | (uint64_t) p[4] << 32 | (uint64_t) p[5] << 40 | (uint64_t) p[6] << 48 | (uint64_t) p[7] << 56;
+}
+
+#define BYTES(X) ((X) * UINT64_C(0x0101010101010101))
 
-//If the command is a READ
-int read_procedure(FILE* entree, command_t* command);
+// sets the top bit of the bytes that are upper-case hex digits, up to the first one that is not:
+// adding to a byte below 0x80 never carries into the next one
+static inline uint64_t hex_digits_mask(uint64_t chars){
+    const uint64_t digit = (chars + BYTES(0x80 - '0')) & ~(chars + BYTES(0x80 - '9' - 1));
+    const uint64_t letter = (chars + BYTES(0x80 - 'A')) & ~(chars + BYTES(0x80 - 'F' - 1));
+    return (digit | letter) & ~chars & BYTES(0x80);
+}
 
-//If the command is a WRITE
-int write_procedure(FILE* entree, command_t* command);
+// value of 8 hex digits, the first one being the most significant
+static inline uint32_t hex_digits_value(uint64_t chars){
+    // '0'-'9' are 0x30-0x39 and 'A'-'F' are 0x41-0x46: letters need 9 more than their low nibble
+    uint64_t v = (chars & BYTES(0x0F)) + ((chars >> 6) & BYTES(0x01)) * 9;
+    // then merges them pairwise: 2 digits per 16 bits, 4 per 32 bits, all 8
+    v = ((v & UINT64_C(0x000F000F000F000F)) << 4) | ((v >> 8) & UINT64_C(0x000F000F000F000F));
+    v = ((v & UINT64_C(0x000000FF000000FF)) << 8) | ((v >> 16) & UINT64_C(0x000000FF000000FF));
+    return (uint32_t) (((v & 0xFFFF) << 16) | ((v >> 32) & 0xFFFF));
+}
 
-//convert a char written in hex to an int
-int hex_char_to_int(char c);
+// decodes exactly 8 hex digits; returns 0 if one of them is not a hex digit
+static inline int hex_digits8(const unsigned char* p, uint32_t* value){
+    const uint64_t chars = load_chars8(p);
+    if(hex_digits_mask(chars) != BYTES(0x80)) return 0;
+    *value = hex_digits_value(chars);
+    return 1;
+}
 
-//skip the blank caracters, return the file with the head at the correct emplacement
-//must skip at least one caracter
-int next_char(FILE* entree);
+#define ADDRESS_DIGITS 16
+#define WRITE_DATA_MAX_DIGITS (2 * sizeof(word_t))
 
-//handles the address part
-int address_procedure(FILE* entree, command_t* command);
+// skips the blanks before the next field: there must be at least one,
+// and the field must start before the end of the buffer
+static inline int skip_blanks(const unsigned char** p, const unsigned char* end, int missing){
+    const unsigned char* from = *p;
+    while(*p < end && BLANK[**p]) ++(*p);
 
-int program_read(const char* filename, program_t* program){
-    FILE* entree = fopen(filename, "r");
+    if(*p >= end) return missing;
+    if(*p == from) return ERR_BAD_PARAMETER;    //need a blank in the instruction
+    return ERR_NONE;
+}
 
-    M_REQUIRE_NON_NULL(entree);
-    size_t error_code = ERR_NONE;
-    error_code = program_init(program);
-    if(error_code != ERR_NONE){
-        fclose(entree);
-        return error_code;
+int command_parse(const char** cursor, const char* end, int at_eof, command_t* command){
+    M_REQUIRE_NON_NULL(cursor);
+    M_REQUIRE_NON_NULL(*cursor);
+    M_REQUIRE_NON_NULL(command);
+
+    const unsigned char* p = (const unsigned char*) *cursor;
+    const unsigned char* const stop = (const unsigned char*) end;
+    if(p >= stop) return ERR_EOF;
+
+    // running out of buffer is an error only at the end of the file
+    const int missing = at_eof ? ERR_BAD_PARAMETER : ERR_EOF;
+    int error_code = ERR_NONE;
+    command_t parsed;
+
+    switch(*p++) {
+        case 'R' : parsed.order = READ; break;
+        case 'W' : parsed.order = WRITE; break;
+        default : return ERR_BAD_PARAMETER;
     }
 
-    size_t nb_command = 0;
-    while(!feof(entree) && nb_command < 100){
-        char r_w = fgetc(entree);
+    if((error_code = skip_blanks(&p, stop, missing)) != ERR_NONE) return error_code;
+
+    if(*p == 'I' && parsed.order == READ) {
+        parsed.type = INSTRUCTION;
+        parsed.data_size = sizeof(word_t);
+        ++p;
+    } else if(*p == 'D') {
+        parsed.type = DATA;
+        if(++p >= stop) return missing;
+        switch(*p++) {
+            case 'W' : parsed.data_size = sizeof(word_t); break;
+            case 'B' : parsed.data_size = 1; break;
+            default : return ERR_BAD_PARAMETER;
+        }
+    } else {
+        return ERR_BAD_PARAMETER;   //not a valid type
+    }
 
-        if (!feof(entree)) {
-            if(r_w == 'R'){
-                error_code = read_procedure(entree, &(program->listing[nb_command]));
-            }
-            else if(r_w == 'W'){
-                error_code = write_procedure(entree, &(program->listing[nb_command]));
-            } else {
-                fclose(entree);
-                return ERR_BAD_PARAMETER;
-            }
-            if(error_code != ERR_NONE){
-                fclose(entree);
-                return error_code;
-            }
-            nb_command++;
+    parsed.write_data = 0;
+    if(parsed.order == WRITE) {
+        if((error_code = skip_blanks(&p, stop, missing)) != ERR_NONE) return error_code;
+        if(stop - p < 2) return missing;
+        if(p[0] != '0' || p[1] != 'x') return ERR_BAD_PARAMETER;
+        p += 2;
+
+        // a command goes on after its data for much more than 8 characters
+        if(stop - p < (ptrdiff_t) WRITE_DATA_MAX_DIGITS + 1) return missing;
+        const uint64_t chars = load_chars8(p);
+        const uint64_t not_digits = ~hex_digits_mask(chars) & BYTES(0x80);
+        const size_t digits = not_digits == 0 ? WRITE_DATA_MAX_DIGITS : (size_t) __builtin_ctzll(not_digits) / 8;
+        if(!BLANK[p[digits]]) return ERR_BAD_PARAMETER;     //not a hex digit, or too many of them
+        if(digits > 0) {
+            // right-aligns the digits behind leading '0's
+            const unsigned shift = 8 * (unsigned) (WRITE_DATA_MAX_DIGITS - digits);
+            parsed.write_data = hex_digits_value(chars << shift | (BYTES('0') & ((UINT64_C(1) << shift) - 1)));
         }
+        p += digits;
     }
-    program->nb_lines = nb_command;
+
+    if((error_code = skip_blanks(&p, stop, missing)) != ERR_NONE) return error_code;
+    if(stop - p < 3 + ADDRESS_DIGITS + 1) return missing;
+    if(p[0] != '@' || p[1] != '0' || p[2] != 'x') return ERR_BAD_PARAMETER;   //not a valid address
+    p += 3;
+
+    uint32_t high = 0, low = 0;
+    if(!hex_digits8(p, &high) || !hex_digits8(p + ADDRESS_DIGITS / 2, &low)) return ERR_BAD_PARAMETER;
+    p += ADDRESS_DIGITS;
+    const uint64_t addr = (uint64_t) high << 32 | low;
+    if(*p++ != '\n') return ERR_BAD_PARAMETER;     //must have a \n at the end of the line
+
+    // init_virt_addr64() without its range checks: every field is masked to its width
+    parsed.vaddr.reserved = 0;
+    parsed.vaddr.pgd_entry = (uint16_t) (addr >> (PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY));
+    parsed.vaddr.pud_entry = (uint16_t) (addr >> (PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY));
+    parsed.vaddr.pmd_entry = (uint16_t) (addr >> (PAGE_OFFSET + PTE_ENTRY));
+    parsed.vaddr.pte_entry = (uint16_t) (addr >> PAGE_OFFSET);
+    parsed.vaddr.page_offset = (uint16_t) addr;
+
+    *command = parsed;
+    *cursor = (const char*) p;
     return ERR_NONE;
 }
 
-int word_or_byte(FILE* entree, command_t* command) {
-    char w_b = fgetc(entree);
-    if(!(w_b == 'W' || w_b == 'B')) return ERR_BAD_PARAMETER;
-
-    if(w_b == 'B'){
-        command->data_size = 1;
-    } else {
-        command->data_size = sizeof(word_t);
+// Moves the unparsed tail of the buffer to its front and reads the next block behind it.
+// The buffer grows only when a single command does not fit in it.
+static int program_stream_fill(program_stream_t* stream){
+    const size_t remaining = (size_t) (stream->end - stream->cursor);
+    if(remaining > 0 && stream->cursor != stream->buffer) {
+        memmove(stream->buffer, stream->cursor, remaining);
     }
+    if(remaining == stream->allocated) {
+        char* const bigger = realloc(stream->buffer, 2 * stream->allocated);
+        M_EXIT_IF_NULL(bigger, 2 * stream->allocated);
+        stream->buffer = bigger;
+        stream->allocated *= 2;
+    }
+
+    const size_t wanted = stream->allocated - remaining;
+    const size_t got = fread(stream->buffer + remaining, 1, wanted, stream->file);
+    M_REQUIRE(!ferror(stream->file), ERR_IO, "reading command file%c", ' ');
+    if(got < wanted) stream->eof = 1;
+
+    stream->cursor = stream->buffer;
+    stream->end = stream->buffer + remaining + got;
+
     return ERR_NONE;
+}
+
+int program_stream_open(const char* filename, program_stream_t* stream){
+    M_REQUIRE_NON_NULL(filename);
+    M_REQUIRE_NON_NULL(stream);
+
+    FILE* file = fopen(filename, "r");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(file, ERR_IO);
+    setvbuf(file, NULL, _IONBF, 0);     // reads go straight into our own buffer
+
+    return program_stream_attach(file, stream);
+}
+
+int program_stream_attach(FILE* file, program_stream_t* stream){
+    M_REQUIRE_NON_NULL(file);
+    M_REQUIRE_NON_NULL(stream);
+
+    stream->file = file;
+    stream->buffer = malloc(PROGRAM_STREAM_BUFFER);
+    if(stream->buffer == NULL) {
+        fclose(stream->file);
+        stream->file = NULL;
     }
+    M_EXIT_IF_NULL(stream->buffer, PROGRAM_STREAM_BUFFER);
+    stream->allocated = PROGRAM_STREAM_BUFFER;
+    stream->cursor = stream->buffer;
+    stream->end = stream->buffer;
+    stream->eof = 0;
+    stream->line = 0;
 
-int read_procedure(FILE* entree, command_t* command){
-    command->order = READ;
-    size_t error_code = ERR_NONE;
-    error_code = next_char(entree);
-    if(error_code != ERR_NONE) return error_code;
-
-    char i_d = fgetc(entree);
-    if(!(i_d == 'I' || i_d == 'D')) return ERR_BAD_PARAMETER; //not a valid type
-    if(i_d == 'D'){
-        command->type = DATA;
-        error_code = word_or_byte(entree, command);
+    return ERR_NONE;
+}
+
+// Parses the next command of the stream, refilling its buffer when needed.
+// Returns ERR_EOF at the end of the file.
+static int program_stream_command(program_stream_t* stream, command_t* command){
+    for(;;){
+        int error_code = command_parse(&stream->cursor, stream->end, stream->eof, command);
+        if(error_code != ERR_EOF) {
+            ++(stream->line);
+            return error_code;
+        }
+        if(stream->eof) return ERR_EOF;
+        error_code = program_stream_fill(stream);
         if(error_code != ERR_NONE) return error_code;
     }
-    else {
-        command->type = INSTRUCTION;
-        command->data_size = sizeof(word_t);
+}
+
+int program_stream_next(program_stream_t* stream, program_t* batch, size_t max_lines){
+    M_REQUIRE_NON_NULL(stream);
+    M_REQUIRE_NON_NULL(stream->file);
+    M_REQUIRE_NON_NULL(batch);
+
+    batch->nb_lines = 0;
+    command_t command;
+    while(batch->nb_lines < max_lines){
+        int error_code = program_stream_command(stream, &command);
+        if(error_code == ERR_EOF) return ERR_NONE;
+
+        if(error_code == ERR_NONE){
+            error_code = program_add_command(batch, &command);
+        }
+        M_EXIT_IF(error_code != ERR_NONE, error_code, "line %zu", stream->line);
     }
+    return ERR_NONE;
+}
+
+int program_stream_next_packed(program_stream_t* stream, packed_program_t* batch, size_t max_lines){
+    M_REQUIRE_NON_NULL(stream);
+    M_REQUIRE_NON_NULL(stream->file);
+    M_REQUIRE_NON_NULL(batch);
 
-    error_code = next_char(entree);
-    if(error_code != ERR_NONE) return error_code;
-    command->write_data = 0;
+    batch->nb_lines = 0;
+    command_t command;
+    packed_command_t packed;
+    while(batch->nb_lines < max_lines){
+        int error_code = program_stream_command(stream, &command);
+        if(error_code == ERR_EOF) return ERR_NONE;
 
-    return address_procedure(entree, command);
+        if(error_code == ERR_NONE){
+            error_code = command_pack(&command, &packed);
+        }
+        if(error_code == ERR_NONE){
+            error_code = packed_program_add_command(batch, &packed);
+        }
+        M_EXIT_IF(error_code != ERR_NONE, error_code, "line %zu", stream->line);
+    }
+    return ERR_NONE;
 }
 
-int write_procedure(FILE* entree, command_t* command){
-    command->order = WRITE;
-    size_t error_code = ERR_NONE;
-    error_code = next_char(entree);
-    if(error_code != ERR_NONE) return error_code;
-
-    if(fgetc(entree) != 'D') return ERR_BAD_PARAMETER;  //not a valid type
-    command->type = DATA;
-
-    error_code = word_or_byte(entree, command);
-    if(error_code != ERR_NONE) return error_code;
-
-    error_code = next_char(entree);
-    if(error_code != ERR_NONE) return error_code;
-    if(fgetc(entree) != '0' || fgetc(entree) != 'x') return ERR_BAD_PARAMETER;      //not a valid address
-
-    word_t wdata = 0;
-    int max = 0;
-    char num = '0';
-    if(feof(entree))return ERR_BAD_PARAMETER;   //the doc finishes to soon
-    num = fgetc(entree);
-
-    while(!isspace(num) && !feof(entree)){
-        if(feof(entree)) return ERR_BAD_PARAMETER;   //the doc finishes to soon
-        wdata = (wdata << 4) | hex_char_to_int(num);
-        max += 4;
-        num = fgetc(entree);
+int program_stream_close(program_stream_t* stream){
+    M_REQUIRE_NON_NULL(stream);
+
+    if(stream->file != NULL) fclose(stream->file);
+    stream->file = NULL;
+    free(stream->buffer);
+    stream->buffer = NULL;
+    stream->cursor = NULL;
+    stream->end = NULL;
+
+    return ERR_NONE;
+}
+
+int program_read(const char* filename, program_t* program){
+    M_EXIT_IF_ERR(program_init(program), "initializing program");
+
+    program_stream_t stream;
+    int error_code = program_stream_open(filename, &stream);
+    if(error_code == ERR_NONE){
+        error_code = program_stream_next(&stream, program, SIZE_MAX);
+        program_stream_close(&stream);
+    }
+    if(error_code == ERR_NONE){
+        error_code = program_shrink(program);
     }
-    if(!(max <= 32)) return ERR_BAD_PARAMETER;  //the write_data is too long
-    ungetc(num, entree);
+    if(error_code != ERR_NONE){
+        program_free(program);
+    }
+
+    return error_code;
+}
+
+int program_free(program_t* program) {
+    M_REQUIRE_NON_NULL(program);
+    free(program->listing);
+    program->listing = NULL;
+    program->nb_lines = 0;
+    program->allocated = 0;
+
+    return ERR_NONE;
+}
+
+int command_pack(const command_t* command, packed_command_t* packed){
+    M_REQUIRE_NON_NULL(command);
+    M_REQUIRE_NON_NULL(packed);
+
+    packed->vaddr = virt_addr_t_to_uint64_t(&command->vaddr);
+    packed->write_data = (command->order == WRITE) ? command->write_data : 0;
+    packed->order = (uint8_t) command->order;
+    packed->type = (uint8_t) command->type;
+    packed->data_size = (uint8_t) command->data_size;
+    packed->reserved = 0;
+
+    return ERR_NONE;
+}
+
+int command_unpack(const packed_command_t* packed, command_t* command){
+    M_REQUIRE_NON_NULL(packed);
+    M_REQUIRE_NON_NULL(command);
+    M_REQUIRE(packed->order == READ || packed->order == WRITE, ERR_BAD_PARAMETER, "invalid order %u", packed->order);
+    M_REQUIRE(packed->type == INSTRUCTION || packed->type == DATA, ERR_BAD_PARAMETER, "invalid access type %u", packed->type);
+
+    command->order = packed_order(packed);
+    command->type = packed_type(packed);
+    command->data_size = packed_data_size(packed);
+    command->write_data = packed_write_data(packed);
+    M_EXIT_IF_ERR(init_virt_addr64(&command->vaddr, packed_vaddr64(packed)), "converting virtual address");
 
-    command->write_data = wdata;
+    return command_check(command);
+}
+
+int packed_command_check(const packed_command_t* packed){
+    M_REQUIRE_NON_NULL(packed);
 
-    error_code = next_char(entree);
-    if(error_code != ERR_NONE) return error_code;
-    error_code = address_procedure(entree, command);
-    if(error_code != ERR_NONE) return error_code;
+    M_REQUIRE(packed->order == READ || packed->order == WRITE, ERR_BAD_PARAMETER, "invalid order %u", packed->order);
+    M_REQUIRE(packed->type == INSTRUCTION || packed->type == DATA, ERR_BAD_PARAMETER, "invalid access type %u", packed->type);
+    M_REQUIRE(packed->data_size == sizeof(word_t) || packed->data_size == 1, ERR_BAD_PARAMETER, "data_size must be 4 (word) or 1 (byte%c", ')');
+    M_REQUIRE(!(packed->type == INSTRUCTION && packed->data_size != sizeof(word_t)), ERR_BAD_PARAMETER, "instructions must have size of 4 (word%c", ')');
+    M_REQUIRE(!(packed->order == WRITE && packed->type == INSTRUCTION), ERR_BAD_PARAMETER, "cannot write an instructio%c", 'n');
+    M_REQUIRE(packed->data_size == 1 || packed->vaddr % sizeof(word_t) == 0, ERR_BAD_PARAMETER, "vaddr of a word must be word aligne%c", 'd');
 
     return ERR_NONE;
 }
 
-int hex_char_to_int(char c){
-    if ('0' <= c && c <= '9')
-        return c - '0';
-    if ('A' <= c && c <= 'F')
-        return c - 'A' + 10;
+int packed_program_init(packed_program_t* program){
+    M_EXIT_IF_NULL(program, sizeof(packed_program_t));
 
-    M_EXIT(ERR_BAD_PARAMETER, "not a hexa value%c", ' ');
+    program->nb_lines = 0;
+    program->allocated = INIT_ALLOCATED;
+
+    program->listing = calloc(INIT_ALLOCATED, sizeof(packed_command_t));
+    M_EXIT_IF_NULL(program->listing, INIT_ALLOCATED * sizeof(packed_command_t));
 
     return ERR_NONE;
 }
 
-int next_char(FILE* entree){
-    int skipped = -1;
-    char c = 'z';
-    do {
-        if(feof(entree)) return ERR_BAD_PARAMETER;  //the doc finishes to soon
-        c = fgetc(entree);
-        skipped ++;
-    } while(isspace(c));
-
-    ungetc(c, entree);
-    if(skipped == 0) return ERR_BAD_PARAMETER;  //need a blank in the instruction
+int packed_program_add_command(packed_program_t* program, const packed_command_t* packed){
+    M_EXIT_IF_NULL(program, sizeof(packed_program_t));
+    M_EXIT_IF_NULL(program->listing, program->allocated * sizeof(packed_command_t));
+    M_EXIT_IF_NULL(packed, sizeof(packed_command_t));
+
+    M_EXIT_IF_ERR(packed_command_check(packed), "checking command");
+
+    while (program->nb_lines >= program->allocated) {
+        program->allocated *= 2;
+        M_EXIT_IF_NULL(program->listing = realloc(program->listing, program->allocated * sizeof(packed_command_t)),
+                       program->allocated * sizeof(packed_command_t));
+    }
+
+    program->listing[program->nb_lines] = *packed;
+    ++(program->nb_lines);
+
     return ERR_NONE;
 }
 
-int address_procedure(FILE* entree, command_t* command){
-    if(fgetc(entree) != '@' || fgetc(entree) != '0' || fgetc(entree) != 'x') return ERR_BAD_PARAMETER; //not a valid address
+int packed_program_shrink(packed_program_t* program){
+    M_EXIT_IF_NULL(program, sizeof(packed_program_t));
+    M_EXIT_IF_NULL(program->listing, program->allocated * sizeof(packed_command_t));
 
-    uint64_t addr = 0;
-    char c = 'z';
-    for(int i = 0; i < 16; ++i) {
-        c = fgetc(entree);
-        addr = (addr << 4) | hex_char_to_int(c);
+    if (program->nb_lines > INIT_ALLOCATED) {
+        program->allocated = program->nb_lines;
+        M_EXIT_IF_NULL(program->listing = realloc(program->listing, program->allocated * sizeof(packed_command_t)),
+                       program->allocated * sizeof(packed_command_t));
     }
-    if(fgetc(entree) != '\n') return ERR_BAD_PARAMETER;         //must have a \n at the end of the line
-    return init_virt_addr64(&(command->vaddr), addr);
+
+    return ERR_NONE;
 }
 
-int program_free(program_t* program) {
+int packed_program_read(const char* filename, packed_program_t* program){
+    M_EXIT_IF_ERR(packed_program_init(program), "initializing program");
+
+    program_stream_t stream;
+    int error_code = program_stream_open(filename, &stream);
+    if(error_code == ERR_NONE){
+        error_code = program_stream_next_packed(&stream, program, SIZE_MAX);
+        program_stream_close(&stream);
+    }
+    if(error_code == ERR_NONE){
+        error_code = packed_program_shrink(program);
+    }
+    if(error_code != ERR_NONE){
+        packed_program_free(program);
+    }
+
+    return error_code;
+}
+
+int packed_program_free(packed_program_t* program) {
     M_REQUIRE_NON_NULL(program);
     free(program->listing);
     program->listing = NULL;
@@ -64,6 +64,14 @@ typedef struct program program_t;
  */
 int program_init(program_t* program);
 
+/**
+ * @brief check that a command is valid: size of 1 or 4, word-aligned words,
+ *        no byte-sized nor written instruction.
+ * @param command the command to be checked.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int command_check(const command_t* command);
+
 /**
  * @brief add a command (line) to a program. Reallocate memory if necessary.
  * @param program (modified) the program where to add to.
@@ -95,6 +103,182 @@ int program_print(FILE* output, const program_t* program);
  */
 int program_read(const char* filename, program_t* program);
 
+/**
+ * @brief Packed command: 16 bytes instead of the 32 of command_t, for programs
+ *        of hundreds of millions of commands. This is also the layout of the
+ *        records of binary traces (see trace.h).
+ */
+struct packed_command {
+    uint64_t vaddr;         // 64-bit pattern of the virtual address
+    uint32_t write_data;    // 0 for reads
+    uint8_t order;          // command_word_t: READ or WRITE
+    uint8_t type;           // mem_access_t: INSTRUCTION or DATA
+    uint8_t data_size;      // 1 (byte) or 4 (word)
+    uint8_t reserved;       // 0
+};
+typedef struct packed_command packed_command_t;
+
+/**
+ * @brief Accessors to the fields of a packed command X (of type `const packed_command_t*`).
+ */
+#define packed_order(X)       ((command_word_t) (X)->order)
+#define packed_type(X)        ((mem_access_t) (X)->type)
+#define packed_data_size(X)   ((size_t) (X)->data_size)
+#define packed_write_data(X)  ((word_t) (X)->write_data)
+#define packed_vaddr64(X)     ((X)->vaddr)
+
+/**
+ * @brief Program of packed commands: same as program_t, for packed_command_t.
+ */
+struct packed_program {
+    packed_command_t* listing;
+    size_t nb_lines;
+    size_t allocated;
+};
+typedef struct packed_program packed_program_t;
+
+/**
+ * @brief Loop over all lines of a packed program, as for_all_lines().
+ * X will be of type `const packed_command_t*` and P has to be of type `packed_program_t*`.
+ */
+#define for_all_packed_lines(X, P) const packed_command_t* end_packed_pgm_ = (P)->listing + (P)->nb_lines; \
+    for(const packed_command_t* X = (P)->listing; X < end_packed_pgm_; ++X)
+
+/**
+ * @brief Pack a command.
+ * @param command the command to be packed.
+ * @param packed (modified) the corresponding packed command.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int command_pack(const command_t* command, packed_command_t* packed);
+
+/**
+ * @brief Unpack a command, checked with command_check().
+ * @param packed the packed command.
+ * @param command (modified) the corresponding command.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int command_unpack(const packed_command_t* packed, command_t* command);
+
+/**
+ * @brief Same checks as command_check(), on a packed command (e.g. read from a file).
+ * @param packed the packed command to be checked.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_command_check(const packed_command_t* packed);
+
+/**
+ * @brief "Constructor" for packed_program_t, as program_init().
+ * @param program (modified) the program to be initialized.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_init(packed_program_t* program);
+
+/**
+ * @brief Add a (checked) packed command to a packed program, as program_add_command().
+ * @param program (modified) the program where to add to.
+ * @param packed the packed command to be added.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_add_command(packed_program_t* program, const packed_command_t* packed);
+
+/**
+ * @brief Down-reallocate a packed program to its minimal size, as program_shrink().
+ * @param program (modified) the program to be rescaled.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_shrink(packed_program_t* program);
+
+/**
+ * @brief Read a text command file into a packed program, as program_read().
+ * @param filename the name of the file to read from.
+ * @param program the program to be filled from file.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_read(const char* filename, packed_program_t* program);
+
+/**
+ * @brief "Destructor" for packed_program_t.
+ * @param program the program to be freed.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_free(packed_program_t* program);
+
+/**
+ * @brief Parse one command (line) of the text format from a memory buffer.
+ *        On success, *cursor is moved just after the terminating '\n'.
+ * @param cursor (modified) where to start parsing.
+ * @param end the end of the buffer.
+ * @param at_eof whether end is also the end of the input: if not, a command
+ *        cut by the end of the buffer is reported as ERR_EOF, not as an error.
+ * @param command (modified) the parsed command.
+ * @return ERR_NONE if ok, ERR_EOF if there is no (complete) command before end,
+ *         appropriate error code otherwise.
+ */
+int command_parse(const char** cursor, const char* end, int at_eof, command_t* command);
+
+#define PROGRAM_STREAM_BUFFER ((size_t) 1 << 20)
+
+/**
+ * @brief Streaming reader over a command file, to process programs batch
+ *        by batch in constant memory instead of loading them as a whole.
+ *        The file is read by blocks of PROGRAM_STREAM_BUFFER bytes.
+ */
+struct program_stream {
+    FILE* file;
+    char* buffer;
+    size_t allocated;           // taille du buffer
+    const char* cursor;         // prochaine commande a lire dans le buffer
+    const char* end;            // fin des donnees lues dans le buffer
+    int eof;                    // la fin du fichier est dans le buffer
+    size_t line;                // lignes lues jusqu'ici (ligne fautive en cas d'erreur)
+};
+typedef struct program_stream program_stream_t;
+/**
+ * @brief Open a command file for streaming.
+ * @param filename the name of the file to read from.
+ * @param stream (modified) the stream to be opened.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_stream_open(const char* filename, program_stream_t* stream);
+
+/**
+ * @brief Stream over an already opened file (e.g. a decompressed one).
+ *        The stream takes ownership of the file: it is closed by program_stream_close(),
+ *        or right away on error.
+ * @param file the file to read from.
+ * @param stream (modified) the stream to be opened.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_stream_attach(FILE* file, program_stream_t* stream);
+
+/**
+ * @brief Read the next batch of commands from a stream.
+ *        The previous content of the batch is discarded; at end of file, the batch is left empty.
+ *        On error, stream->line is the number of the faulty line.
+ * @param stream the stream to read from.
+ * @param batch (modified) an initialized program, filled with at most max_lines commands.
+ * @param max_lines the maximum number of commands to read.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_stream_next(program_stream_t* stream, program_t* batch, size_t max_lines);
+
+/**
+ * @brief Same as program_stream_next(), into a packed program.
+ * @param stream the stream to read from.
+ * @param batch (modified) an initialized packed program, filled with at most max_lines commands.
+ * @param max_lines the maximum number of commands to read.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_stream_next_packed(program_stream_t* stream, packed_program_t* batch, size_t max_lines);
+
+/**
+ * @brief Close a stream.
+ * @param stream the stream to be closed.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_stream_close(program_stream_t* stream);
+
 /**
  * @brief "Destructor" for program_t: free its content.
  * @param program the program to be filled from file.
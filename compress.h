@@ -0,0 +1,47 @@
+#pragma once
+
+/**
+ * @file compress.h
+ * @brief Type definitions for compressed input: a file decompressed on a
+ *        background thread into a bounded buffer, read through a FILE*.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include <stdio.h>   // for FILE
+#include <stddef.h>  // for size_t
+#include <pthread.h>
+
+#define GZIP_MAGIC          "\x1f\x8b"
+#define GZIP_MAGIC_SIZE     2
+#define ZSTD_MAGIC          "\x28\xb5\x2f\xfd"
+#define ZSTD_MAGIC_SIZE     4
+#define COMPRESS_MAGIC_MAX  4       // bytes needed to recognize any format
+
+#define DECOMPRESS_BUFFER   ((size_t) 4 << 20)  // decompressed bytes not read yet, at most
+#define DECOMPRESS_CHUNK    ((size_t) 1 << 16)  // compressed bytes read at once
+
+enum compression { COMPRESSION_NONE, COMPRESSION_GZIP, COMPRESSION_ZSTD };
+typedef enum compression compression_t;
+
+/**
+ * @brief Decompression of a file on a background thread (the producer).
+ *        The decompressed bytes go through a ring buffer of DECOMPRESS_BUFFER
+ *        bytes: the producer waits when it is full, the reader when it is empty.
+ */
+struct decompressor {
+    compression_t compression;
+    FILE* input;                // compressed file
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    char* ring;                 // DECOMPRESS_BUFFER bytes
+    size_t head;                // next byte to read (modulo DECOMPRESS_BUFFER)
+    size_t size;                // bytes available from head
+    int done;                   // the producer has finished (see error_code)
+    int error_code;             // error of the producer, ERR_NONE otherwise
+    int closing;                // the reader asks the producer to stop
+};
+typedef struct decompressor decompressor_t;
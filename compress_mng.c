@@ -0,0 +1,346 @@
+/**
+ * @file compress_mng.c
+ * @brief Transparent reading of gzip (and, if built with HAVE_ZSTD, zstd) files.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#define _GNU_SOURCE // for fopencookie()
+
+#include "compress_mng.h"
+#include "error.h"
+#include "util.h"
+
+#include <string.h> // for memcmp(), memcpy()
+#include <stdlib.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+//=========================================================================
+compression_t compression_detect(const void* magic, size_t size)
+{
+    if (magic == NULL) return COMPRESSION_NONE;
+    if (size >= GZIP_MAGIC_SIZE && memcmp(magic, GZIP_MAGIC, GZIP_MAGIC_SIZE) == 0) return COMPRESSION_GZIP;
+    if (size >= ZSTD_MAGIC_SIZE && memcmp(magic, ZSTD_MAGIC, ZSTD_MAGIC_SIZE) == 0) return COMPRESSION_ZSTD;
+    return COMPRESSION_NONE;
+}
+
+//=========================================================================
+compression_t compression_of_file(const char* filename)
+{
+    if (filename == NULL) return COMPRESSION_NONE;
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) return COMPRESSION_NONE;
+    unsigned char magic[COMPRESS_MAGIC_MAX];
+    const size_t got = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return compression_detect(magic, got);
+}
+
+//=========================================================================
+int compression_supported(compression_t compression)
+{
+#ifdef HAVE_ZSTD
+    return compression == COMPRESSION_NONE || compression == COMPRESSION_GZIP || compression == COMPRESSION_ZSTD;
+#else
+    return compression == COMPRESSION_NONE || compression == COMPRESSION_GZIP;
+#endif
+}
+
+//=========================================================================
+// Producer side: appends decompressed bytes to the ring, waiting for room.
+// Returns 0 if the reader asked to stop.
+static int ring_push(decompressor_t* decomp, const char* data, size_t size)
+{
+    while (size > 0) {
+        pthread_mutex_lock(&decomp->lock);
+        while (decomp->size == DECOMPRESS_BUFFER && !decomp->closing) {
+            pthread_cond_wait(&decomp->not_full, &decomp->lock);
+        }
+        if (decomp->closing) {
+            pthread_mutex_unlock(&decomp->lock);
+            return 0;
+        }
+        const size_t tail = (decomp->head + decomp->size) % DECOMPRESS_BUFFER;
+        size_t n = DECOMPRESS_BUFFER - decomp->size;
+        if (n > DECOMPRESS_BUFFER - tail) n = DECOMPRESS_BUFFER - tail;
+        if (n > size) n = size;
+        pthread_mutex_unlock(&decomp->lock);
+
+        // only the producer writes behind the tail: no need to hold the lock to copy
+        memcpy(decomp->ring + tail, data, n);
+
+        pthread_mutex_lock(&decomp->lock);
+        decomp->size += n;
+        pthread_cond_signal(&decomp->not_empty);
+        pthread_mutex_unlock(&decomp->lock);
+        data += n;
+        size -= n;
+    }
+    return 1;
+}
+
+//=========================================================================
+// Decompresses a gzip file (possibly made of several members) into the ring
+static int gzip_produce(decompressor_t* decomp, unsigned char* in, unsigned char* out)
+{
+    z_stream z;
+    zero_init_var(z);
+    M_REQUIRE(inflateInit2(&z, 15 + 32) == Z_OK, ERR_MEM, "%s", "cannot initialize zlib");
+
+    int error_code = ERR_NONE;
+    int ret = Z_OK;
+    int pushed = 1;
+    size_t got = 0;
+    while (error_code == ERR_NONE && pushed && (got = fread(in, 1, DECOMPRESS_CHUNK, decomp->input)) > 0) {
+        z.next_in = in;
+        z.avail_in = (uInt) got;
+        do {
+            // another gzip member follows
+            if (ret == Z_STREAM_END && inflateReset(&z) != Z_OK) error_code = ERR_IO;
+            z.next_out = out;
+            z.avail_out = DECOMPRESS_CHUNK;
+            if (error_code == ERR_NONE) ret = inflate(&z, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) error_code = ERR_IO;
+            if (error_code == ERR_NONE) pushed = ring_push(decomp, (const char*) out, DECOMPRESS_CHUNK - z.avail_out);
+        } while (error_code == ERR_NONE && pushed
+                 && (z.avail_in > 0 || (z.avail_out == 0 && ret != Z_STREAM_END)));
+    }
+    if (ferror(decomp->input)) error_code = ERR_IO;
+    // the input ended in the middle of a member
+    if (error_code == ERR_NONE && pushed && ret != Z_STREAM_END) error_code = ERR_IO;
+
+    inflateEnd(&z);
+    return error_code;
+}
+
+#ifdef HAVE_ZSTD
+//=========================================================================
+// Decompresses a zstd file into the ring
+static int zstd_produce(decompressor_t* decomp, unsigned char* in, unsigned char* out)
+{
+    ZSTD_DStream* z = ZSTD_createDStream();
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(z, ERR_MEM);
+    ZSTD_initDStream(z);
+
+    int error_code = ERR_NONE;
+    size_t ret = 0;
+    int pushed = 1;
+    size_t got = 0;
+    while (error_code == ERR_NONE && pushed && (got = fread(in, 1, DECOMPRESS_CHUNK, decomp->input)) > 0) {
+        ZSTD_inBuffer input = { in, got, 0 };
+        ZSTD_outBuffer output = { out, DECOMPRESS_CHUNK, 0 };
+        do {
+            output.pos = 0;
+            ret = ZSTD_decompressStream(z, &output, &input);
+            if (ZSTD_isError(ret)) error_code = ERR_IO;
+            if (error_code == ERR_NONE) pushed = ring_push(decomp, (const char*) out, output.pos);
+        } while (error_code == ERR_NONE && pushed
+                 && (input.pos < input.size || output.pos == output.size));
+    }
+    if (ferror(decomp->input)) error_code = ERR_IO;
+    // the input ended in the middle of a frame
+    if (error_code == ERR_NONE && pushed && ret != 0) error_code = ERR_IO;
+
+    ZSTD_freeDStream(z);
+    return error_code;
+}
+#endif
+
+//=========================================================================
+// Producer thread body
+static void* decompress_thread(void* arg)
+{
+    decompressor_t* decomp = arg;
+    int error_code = ERR_NONE;
+
+    unsigned char* in = malloc(DECOMPRESS_CHUNK);
+    unsigned char* out = malloc(DECOMPRESS_CHUNK);
+    if (in == NULL || out == NULL) {
+        error_code = ERR_MEM;
+    } else if (decomp->compression == COMPRESSION_GZIP) {
+        error_code = gzip_produce(decomp, in, out);
+    } else {
+#ifdef HAVE_ZSTD
+        error_code = zstd_produce(decomp, in, out);
+#else
+        error_code = ERR_BAD_PARAMETER; // refused by decompressor_open() anyway
+#endif
+    }
+    free(in);
+    free(out);
+
+    pthread_mutex_lock(&decomp->lock);
+    decomp->error_code = error_code;
+    decomp->done = 1;
+    pthread_cond_broadcast(&decomp->not_empty);
+    pthread_mutex_unlock(&decomp->lock);
+    return NULL;
+}
+
+//=========================================================================
+int decompressor_open(const char* filename, compression_t compression, decompressor_t* decomp)
+{
+    M_REQUIRE_NON_NULL(filename);
+    M_REQUIRE_NON_NULL(decomp);
+    M_REQUIRE(compression != COMPRESSION_NONE && compression_supported(compression), ERR_BAD_PARAMETER,
+              "unsupported compression %d (zstd requires HAVE_ZSTD)", compression);
+
+    zero_init_ptr(decomp);
+    decomp->compression = compression;
+    decomp->error_code = ERR_NONE;
+
+    decomp->input = fopen(filename, "rb");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(decomp->input, ERR_IO);
+    decomp->ring = malloc(DECOMPRESS_BUFFER);
+    if (decomp->ring == NULL) {
+        fclose(decomp->input);
+        M_EXIT_ERR(ERR_MEM, "cannot allocate %zu bytes", DECOMPRESS_BUFFER);
+    }
+
+    pthread_mutex_init(&decomp->lock, NULL);
+    pthread_cond_init(&decomp->not_empty, NULL);
+    pthread_cond_init(&decomp->not_full, NULL);
+    if (pthread_create(&decomp->thread, NULL, decompress_thread, decomp) != 0) {
+        pthread_cond_destroy(&decomp->not_full);
+        pthread_cond_destroy(&decomp->not_empty);
+        pthread_mutex_destroy(&decomp->lock);
+        free(decomp->ring);
+        fclose(decomp->input);
+        M_EXIT_ERR(ERR_MEM, "%s", "cannot start decompression thread");
+    }
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Reader side: waits until size bytes are available (or the producer is done);
+// returns the number of available bytes, at most size, with the lock held.
+static size_t ring_wait(decompressor_t* decomp, size_t size)
+{
+    pthread_mutex_lock(&decomp->lock);
+    while (decomp->size < size && !decomp->done) {
+        pthread_cond_wait(&decomp->not_empty, &decomp->lock);
+    }
+    return decomp->size < size ? decomp->size : size;
+}
+
+//=========================================================================
+// Copies n bytes from the head of the ring (lock held)
+static void ring_copy(const decompressor_t* decomp, char* buffer, size_t n)
+{
+    const size_t first = DECOMPRESS_BUFFER - decomp->head < n ? DECOMPRESS_BUFFER - decomp->head : n;
+    memcpy(buffer, decomp->ring + decomp->head, first);
+    memcpy(buffer + first, decomp->ring, n - first);
+}
+
+//=========================================================================
+int decompressor_peek(decompressor_t* decomp, void* buffer, size_t size, size_t* got)
+{
+    M_REQUIRE_NON_NULL(decomp);
+    M_REQUIRE_NON_NULL(buffer);
+    M_REQUIRE_NON_NULL(got);
+    M_REQUIRE(size <= DECOMPRESS_BUFFER, ERR_SIZE, "cannot peek %zu bytes", size);
+
+    *got = ring_wait(decomp, size);
+    ring_copy(decomp, buffer, *got);
+    const int error_code = (*got < size) ? decomp->error_code : ERR_NONE;
+    pthread_mutex_unlock(&decomp->lock);
+
+    return error_code;
+}
+
+//=========================================================================
+// fopencookie() read function: at least one byte, unless at end of data
+static ssize_t decompressor_read(void* cookie, char* buffer, size_t size)
+{
+    decompressor_t* decomp = cookie;
+    const size_t n = ring_wait(decomp, 1) < 1 ? 0 : (decomp->size < size ? decomp->size : size);
+    ring_copy(decomp, buffer, n);
+    decomp->head = (decomp->head + n) % DECOMPRESS_BUFFER;
+    decomp->size -= n;
+    const int error_code = (n == 0) ? decomp->error_code : ERR_NONE;
+    pthread_cond_signal(&decomp->not_full);
+    pthread_mutex_unlock(&decomp->lock);
+
+    return error_code != ERR_NONE ? -1 : (ssize_t) n;
+}
+
+//=========================================================================
+int decompressor_close(decompressor_t* decomp)
+{
+    M_REQUIRE_NON_NULL(decomp);
+
+    pthread_mutex_lock(&decomp->lock);
+    decomp->closing = 1;
+    pthread_cond_broadcast(&decomp->not_full);
+    pthread_mutex_unlock(&decomp->lock);
+    pthread_join(decomp->thread, NULL);
+
+    pthread_cond_destroy(&decomp->not_full);
+    pthread_cond_destroy(&decomp->not_empty);
+    pthread_mutex_destroy(&decomp->lock);
+    free(decomp->ring);
+    decomp->ring = NULL;
+    const int error_code = fclose(decomp->input) == 0 ? ERR_NONE : ERR_IO;
+    decomp->input = NULL;
+
+    return error_code;
+}
+
+//=========================================================================
+// fopencookie() close function
+static int decompressor_fclose(void* cookie)
+{
+    const int error_code = decompressor_close(cookie);
+    free(cookie);
+    return error_code == ERR_NONE ? 0 : EOF;
+}
+
+//=========================================================================
+FILE* decompressor_fopen(decompressor_t* decomp)
+{
+    if (decomp == NULL) return NULL;
+
+    const cookie_io_functions_t functions = {
+        .read = decompressor_read,
+        .write = NULL,
+        .seek = NULL,
+        .close = decompressor_fclose
+    };
+    return fopencookie(decomp, "r", functions);
+}
+
+//=========================================================================
+FILE* compress_fopen(const char* filename, compression_t* compression)
+{
+    if (filename == NULL) return NULL;
+
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) return NULL;
+    unsigned char magic[COMPRESS_MAGIC_MAX];
+    const compression_t detected = compression_detect(magic, fread(magic, 1, COMPRESS_MAGIC_MAX, file));
+    if (compression != NULL) *compression = detected;
+
+    if (detected == COMPRESSION_NONE) {
+        rewind(file);
+        return file;
+    }
+    fclose(file);
+
+    decompressor_t* decomp = malloc(sizeof(decompressor_t));
+    if (decomp == NULL) return NULL;
+    if (decompressor_open(filename, detected, decomp) != ERR_NONE) {
+        free(decomp);
+        return NULL;
+    }
+    file = decompressor_fopen(decomp);
+    if (file == NULL) {
+        decompressor_close(decomp);
+        free(decomp);
+    }
+    return file;
+}
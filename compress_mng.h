@@ -0,0 +1,89 @@
+#pragma once
+
+/**
+ * @file compress_mng.h
+ * @brief Transparent reading of gzip (and, if built with HAVE_ZSTD, zstd) files.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "compress.h"
+
+//=========================================================================
+/**
+ * @brief Recognize a compression format from the first bytes of a file.
+ * @param magic the first bytes of the file
+ * @param size the number of bytes in magic (at most COMPRESS_MAGIC_MAX are used)
+ * @return the compression format, COMPRESSION_NONE if none is recognized
+ */
+compression_t compression_detect(const void* magic, size_t size);
+
+//=========================================================================
+/**
+ * @brief Recognize the compression format of a file from its first bytes.
+ * @param filename the file
+ * @return the compression format, COMPRESSION_NONE if none is recognized
+ *         or if the file cannot be read
+ */
+compression_t compression_of_file(const char* filename);
+
+//=========================================================================
+/**
+ * @brief Tell whether this build can decompress a format
+ *        (zstd requires HAVE_ZSTD, see "make ZSTD=1").
+ * @param compression the format
+ * @return 1 if supported (always for COMPRESSION_NONE), 0 otherwise
+ */
+int compression_supported(compression_t compression);
+
+//=========================================================================
+/**
+ * @brief Start decompressing a file on a background thread.
+ * @param filename the compressed file
+ * @param compression its format (not COMPRESSION_NONE)
+ * @param decomp (modified) the decompressor to be started
+ * @return error code
+ */
+int decompressor_open(const char* filename, compression_t compression, decompressor_t* decomp);
+
+//=========================================================================
+/**
+ * @brief Copy the first decompressed bytes without consuming them,
+ *        waiting for them if needed.
+ * @param decomp the decompressor to peek into
+ * @param buffer (modified) where to copy the bytes
+ * @param size the number of bytes wanted (at most DECOMPRESS_BUFFER)
+ * @param got (modified) the number of bytes copied: less than size only at end of data
+ * @return error code
+ */
+int decompressor_peek(decompressor_t* decomp, void* buffer, size_t size, size_t* got);
+
+//=========================================================================
+/**
+ * @brief Wrap a decompressor into a read-only FILE*.
+ *        Closing the FILE* stops the producer and frees the decompressor
+ *        (which must then have been allocated with malloc()).
+ *        A decompression error shows as a read error (ferror()).
+ * @param decomp the started decompressor, taken over by the FILE*
+ * @return the FILE*, NULL on error (decomp is then left untouched)
+ */
+FILE* decompressor_fopen(decompressor_t* decomp);
+
+//=========================================================================
+/**
+ * @brief Stop the producer and free the resources of a decompressor
+ *        which has not been wrapped into a FILE*.
+ * @param decomp the decompressor to be closed
+ * @return error code
+ */
+int decompressor_close(decompressor_t* decomp);
+
+//=========================================================================
+/**
+ * @brief Open a file for reading, decompressing it on the fly if it is compressed.
+ * @param filename the file to be opened
+ * @param compression (modified) the detected format; may be NULL
+ * @return the FILE*, NULL on error
+ */
+FILE* compress_fopen(const char* filename, compression_t* compression);
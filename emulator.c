@@ -0,0 +1,417 @@
+/**
+ * @file emulator.c
+ * @brief full-system emulation: runs a program through the TLB hierarchy
+ *        and the cache hierarchy and prints end-to-end statistics
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#if defined _WIN32  || defined _WIN64
+#define __USE_MINGW_ANSI_STDIO 1
+#endif
+
+#define _POSIX_C_SOURCE 200809L // for getopt()
+
+#include "error.h"
+#include "commands.h"
+#include "memory.h"
+#include "sim_mng.h"
+#include "cache_mng.h"
+#include "tlb_hrchy_mng.h"
+#include "stats_mng.h"
+#include "interval_mng.h"
+#include "miss_class_mng.h"
+#include "event_trace_mng.h"
+#include "live_mng.h"
+#include "profile_mng.h"
+#include "compress_mng.h" // for compression_supported()
+#include "util.h" // for SIZE_T_FMT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h> // for PRIx32
+#include <unistd.h> // for getopt()
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [options] (dump|desc) mem_filename command_filename\n", pgm);
+    fprintf(stderr, "options:  -s (csv|json)  also print per-level cache and TLB statistics in that format\n");
+    fprintf(stderr, "          -c             also classify the cache misses of these statistics in\n");
+    fprintf(stderr, "                         compulsory, capacity and conflict misses\n");
+    fprintf(stderr, "          -o prefix      print them to prefix-cache.(csv|json) and prefix-tlb.(csv|json)\n");
+    fprintf(stderr, "                         instead of the standard output\n");
+    fprintf(stderr, "          -i period      also print statistics of every window of that many accesses\n");
+    fprintf(stderr, "          -I file        print them to that file (required by -i); binary if it ends\n");
+    fprintf(stderr, "                         with \".bin\", CSV otherwise\n");
+    fprintf(stderr, "          -H file        also print per-set (per-line) counters of caches (TLBs) to that\n");
+    fprintf(stderr, "                         CSV file\n");
+    fprintf(stderr, "          -E file        also log every cache and TLB event (hit, miss, fill, evict,\n");
+    fprintf(stderr, "                         promote, walk) to that CSV file\n");
+    fprintf(stderr, "          -r rate        also record one access out of that many (where it was found,\n");
+    fprintf(stderr, "                         which L1 line it evicted) to a binary event trace\n");
+    fprintf(stderr, "          -R file        write that trace to that file (required by -r)\n");
+    fprintf(stderr, "          -L name        also publish running counters in shared memory, for live-monitor\n");
+    fprintf(stderr, "                         (in any case, SIGUSR1 prints all the counters to stderr)\n");
+    fprintf(stderr, "          -G level=sets,ways,line\n");
+    fprintf(stderr, "                         geometry of a cache level (l1i, l1d or l2) instead of the\n");
+    fprintf(stderr, "                         default one; line sizes (in bytes) must be the same\n");
+    fprintf(stderr, "          -j threads     parse an uncompressed text command file with that many threads\n");
+    fprintf(stderr, "                         (0 = one per CPU), while it is executed\n");
+    fprintf(stderr, "examples: %s dump memory_dump.bin commands01.txt\n", pgm);
+    fprintf(stderr, "          %s -s json -o stats desc memory_description.txt commands01.txt\n", pgm);
+    fprintf(stderr, "          %s -i 100000 -I phases.csv desc memory_description.txt trace.bin\n", pgm);
+    fprintf(stderr, "          %s -G l2=1024,8,16 -s csv desc memory_description.txt trace.bin\n", pgm);
+}
+
+// ======================================================================
+// Parses a number of threads (-j), 0 or more
+static int parse_nb_threads(const char* spec, long* nb_threads)
+{
+    char* end = NULL;
+    *nb_threads = strtol(spec, &end, 10);
+    return (*spec == '\0' || *end != '\0' || *nb_threads < 0) ? ERR_BAD_PARAMETER : ERR_NONE;
+}
+
+// ======================================================================
+// Parses "level=sets,ways,line" (-G) into the geometry of that level
+static int parse_geometry(const char* spec, cache_geometry_t geometry[CACHE_LEVELS])
+{
+    char level_name[4] = "";
+    unsigned sets = 0, ways = 0, line_size = 0;
+    char end = '\0';
+    if (sscanf(spec, "%3[^=]=%u,%u,%u%c", level_name, &sets, &ways, &line_size, &end) != 4) {
+        return ERR_BAD_PARAMETER;
+    }
+    static const char* const LEVEL_NAMES[CACHE_LEVELS] = { "l1i", "l1d", "l2" };
+    for (int level = 0; level < CACHE_LEVELS; ++level) {
+        if (!strcmp(level_name, LEVEL_NAMES[level])) {
+            return cache_geometry_init(&geometry[level], sets, ways, line_size, sizeof(word_t));
+        }
+    }
+    return ERR_BAD_PARAMETER;
+}
+
+// ======================================================================
+// Prints the statistics of one part of the hierarchy to prefix-name.format,
+// or to the standard output if prefix is NULL
+#define EXPORT_STATS(PRINT, STATS, NAME) \
+    do { \
+        FILE* output = stdout; \
+        if (prefix != NULL) { \
+            char filename[FILENAME_MAX]; \
+            (void)snprintf(filename, sizeof(filename), "%s-%s.%s", prefix, NAME, \
+                           format == STATS_CSV ? "csv" : "json"); \
+            output = fopen(filename, "w"); \
+            if (output == NULL) return ERR_IO; \
+        } \
+        int err = PRINT(output, STATS, format); \
+        if (output != stdout && fclose(output) != 0 && err == ERR_NONE) err = ERR_IO; \
+        if (err != ERR_NONE) return err; \
+    } while (0)
+
+// ======================================================================
+// Event log (-E): one CSV line per event, through the cache and TLB hooks
+static const char* const CACHE_NAMES[] = { "l1i", "l1d", "l2" };
+static const char* const TLB_NAMES[] = { "l1_itlb", "l1_dtlb", "l2_tlb" };
+
+static void log_event(FILE* output, const char* event, const char* structure,
+                      uint16_t set, uint8_t way, uint32_t paddr)
+{
+    fprintf(output, "\"%s\",\"%s\",%" PRIu16 ",", event, structure, set);
+    if (way != HIT_WAY_MISS) fprintf(output, "%" PRIu8, way);
+    fprintf(output, ",0x%08" PRIx32 "\n", paddr);
+}
+
+#define EVENT_LOGGER(FUNCTION, LEVEL_TYPE, NAMES, EVENT) \
+    static void FUNCTION(void* data, LEVEL_TYPE level, uint16_t set, uint8_t way, uint32_t paddr) \
+    { \
+        log_event(data, EVENT, NAMES[level], set, way, paddr); \
+    }
+
+EVENT_LOGGER(log_cache_hit, cache_t, CACHE_NAMES, "hit")
+EVENT_LOGGER(log_cache_miss, cache_t, CACHE_NAMES, "miss")
+EVENT_LOGGER(log_cache_fill, cache_t, CACHE_NAMES, "fill")
+EVENT_LOGGER(log_cache_evict, cache_t, CACHE_NAMES, "evict")
+EVENT_LOGGER(log_cache_promote, cache_t, CACHE_NAMES, "promote")
+EVENT_LOGGER(log_tlb_hit, tlb_t, TLB_NAMES, "hit")
+EVENT_LOGGER(log_tlb_miss, tlb_t, TLB_NAMES, "miss")
+EVENT_LOGGER(log_tlb_fill, tlb_t, TLB_NAMES, "fill")
+EVENT_LOGGER(log_tlb_evict, tlb_t, TLB_NAMES, "evict")
+EVENT_LOGGER(log_tlb_walk, tlb_t, TLB_NAMES, "walk")
+
+static int export_stats(const sim_t* sim, stats_format_t format, const char* prefix)
+{
+    EXPORT_STATS(cache_stats_print, &sim->cache_stats, "cache");
+    if (prefix == NULL) putchar('\n');
+    EXPORT_STATS(tlb_stats_print, &sim->tlb_stats, "tlb");
+    return ERR_NONE;
+}
+
+// ======================================================================
+// Closes what was opened around the run, whatever it was (the simulation, its
+// outputs and the miss classifier), then frees the simulation and its memory
+// space: both the early exits and the end of the run go through here.
+// Returns the first error writing an output.
+static int close_run(sim_t* sim, FILE* events, const cache_hooks_t* cache_hooks,
+                     const tlb_hooks_t* tlb_hooks, miss_classifier_t* classifier)
+{
+    int err = ERR_NONE;
+    if (events != NULL) {
+        (void)cache_hooks_detach(&sim->cache_probes, cache_hooks);
+        (void)tlb_hooks_detach(&sim->tlb_probes, tlb_hooks);
+        if (fclose(events) != 0) {
+            fprintf(stderr, "ERROR: cannot write the event log\n");
+            err = ERR_IO;
+        }
+    }
+
+    uint64_t dropped = 0;
+    if (sim->events != NULL && event_trace_close(sim->events, &dropped) != ERR_NONE) {
+        fprintf(stderr, "ERROR: cannot write the event trace\n");
+        if (err == ERR_NONE) err = ERR_IO;
+    }
+    if (dropped > 0) {
+        fprintf(stderr, "WARNING: %" PRIu64 " records dropped from the event trace (writer too slow)\n", dropped);
+    }
+
+    if (sim->interval != NULL
+        && interval_close(sim->interval, sim->stats.accesses, &sim->cache_stats, &sim->tlb_stats) != ERR_NONE) {
+        fprintf(stderr, "ERROR: cannot write interval statistics\n");
+        if (err == ERR_NONE) err = ERR_IO;
+    }
+
+    if (classifier != NULL) {
+        (void)cache_classifier_attach(&sim->cache_probes, NULL);
+        (void)miss_classifier_free(classifier);
+        free(classifier);
+    }
+    void* mem_space = sim->mem_space;
+    (void)sim_free(sim);
+    free(sim);
+    free(mem_space);
+    return err;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    const char* pgm = argv[0];
+    int with_stats = 0;
+    stats_format_t stats_format = STATS_CSV;
+    const char* stats_prefix = NULL;
+    uint64_t period = 0;
+    const char* interval_filename = NULL;
+    const char* heatmap_filename = NULL;
+    int classify = 0;
+    const char* events_filename = NULL;
+    uint32_t sample_rate = 0;
+    const char* trace_filename = NULL;
+    const char* live_name = NULL;
+    long nb_threads = -1; // -1: command file streamed by the simulating thread
+    cache_geometry_t geometry[CACHE_LEVELS];
+    for (int level = 0; level < CACHE_LEVELS; ++level) {
+        geometry[level] = *cache_default_geometry(level);
+    }
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:co:i:I:H:E:r:R:L:G:j:")) != -1) {
+        if (opt == 's' && stats_format_parse(optarg, &stats_format) == ERR_NONE) {
+            with_stats = 1;
+        } else if (opt == 'c') {
+            classify = 1;
+        } else if (opt == 'o') {
+            stats_prefix = optarg;
+        } else if (opt == 'i' && (period = strtoull(optarg, NULL, 10)) > 0) {
+            continue;
+        } else if (opt == 'I') {
+            interval_filename = optarg;
+        } else if (opt == 'H') {
+            heatmap_filename = optarg;
+        } else if (opt == 'E') {
+            events_filename = optarg;
+        } else if (opt == 'r' && (sample_rate = (uint32_t) strtoul(optarg, NULL, 10)) > 0) {
+            continue;
+        } else if (opt == 'R') {
+            trace_filename = optarg;
+        } else if (opt == 'L') {
+            live_name = optarg;
+        } else if (opt == 'G' && parse_geometry(optarg, geometry) == ERR_NONE) {
+            continue;
+        } else if (opt == 'j' && parse_nb_threads(optarg, &nb_threads) == ERR_NONE) {
+            continue;
+        } else {
+            error(pgm, "invalid option.");
+            return 1;
+        }
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
+
+    if ((period > 0) != (interval_filename != NULL)) {
+        error(pgm, "-i and -I go together.");
+        return 1;
+    }
+    if ((sample_rate > 0) != (trace_filename != NULL)) {
+        error(pgm, "-r and -R go together.");
+        return 1;
+    }
+    if (classify && !with_stats) {
+        error(pgm, "-c requires -s.");
+        return 1;
+    }
+    if (cache_hierarchy_check(geometry) != ERR_NONE) {
+        error(pgm, "all cache levels need the same line size.");
+        return 1;
+    }
+
+    if (argc < 4) {
+        error(pgm, "please provide memory format, memory filename and command filename:");
+        return 1;
+    }
+    int dump = 1;
+    if (strcmp(argv[1], "dump")) {
+        if (strcmp(argv[1], "desc")) {
+            error(pgm, "unknown command.");
+            return 1;
+        }
+        dump = 0;
+    }
+
+    void* mem_space = NULL;
+    size_t mem_size = 0;
+    int err = ERR_NONE;
+    if (dump)
+        err = mem_init_from_dumpfile(argv[2], &mem_space, &mem_size);
+    else
+        err = mem_init_from_description(argv[2], &mem_space, &mem_size);
+    if (err != ERR_NONE) {
+        error(pgm, "problem initializing memory from provided file.");
+        return 3;
+    }
+
+    sim_t* sim = malloc(sizeof(sim_t));
+    if (sim == NULL || sim_init(sim, mem_space, mem_size, geometry) != ERR_NONE) {
+        free(sim);
+        free(mem_space);
+        error(pgm, "cannot initialize the simulation.");
+        return 4;
+    }
+
+    // from now on, every exit goes through close_run()
+    FILE* events = NULL;
+    cache_hooks_t cache_hooks = { log_cache_hit, log_cache_miss, log_cache_fill,
+                                  log_cache_evict, log_cache_promote, NULL };
+    tlb_hooks_t tlb_hooks = { log_tlb_hit, log_tlb_miss, log_tlb_fill,
+                              log_tlb_evict, log_tlb_walk, NULL };
+    miss_classifier_t* classifier = NULL;
+
+    interval_t interval;
+    if (interval_filename != NULL) {
+        const size_t length = strlen(interval_filename);
+        const interval_format_t format =
+            (length >= 4 && !strcmp(interval_filename + length - 4, ".bin")) ? INTERVAL_BINARY : INTERVAL_CSV;
+        if (interval_open(interval_filename, period, format, &interval) != ERR_NONE) {
+            (void)close_run(sim, events, &cache_hooks, &tlb_hooks, classifier);
+            error(pgm, "cannot create the interval statistics file.");
+            return 4;
+        }
+        sim->interval = &interval;
+    }
+
+    event_trace_t trace;
+    if (trace_filename != NULL) {
+        if (event_trace_open(trace_filename, sample_rate, &trace) != ERR_NONE) {
+            (void)close_run(sim, events, &cache_hooks, &tlb_hooks, classifier);
+            error(pgm, "cannot create the event trace file.");
+            return 4;
+        }
+        sim->events = &trace;
+    }
+
+    // per-set counters are only collected on demand
+    static cache_heatmap_t cache_heatmap;
+    static tlb_heatmap_t tlb_heatmap;
+    if (heatmap_filename != NULL) {
+        (void)cache_heatmap_attach(&sim->cache_probes, &cache_heatmap, geometry);
+        (void)tlb_heatmap_attach(&sim->tlb_probes, &tlb_heatmap);
+    }
+
+    if (events_filename != NULL) {
+        events = fopen(events_filename, "w");
+        if (events == NULL) {
+            (void)close_run(sim, events, &cache_hooks, &tlb_hooks, classifier);
+            error(pgm, "cannot create the event log.");
+            return 4;
+        }
+        fputs("\"event\",\"structure\",\"set\",\"way\",\"paddr\"\n", events);
+        cache_hooks.data = tlb_hooks.data = events;
+        (void)cache_hooks_attach(&sim->cache_probes, &cache_hooks);
+        (void)tlb_hooks_attach(&sim->tlb_probes, &tlb_hooks);
+    }
+
+    if (classify) {
+        classifier = malloc(sizeof(miss_classifier_t));
+        if (classifier == NULL || miss_classifier_init(classifier, mem_size, geometry) != ERR_NONE) {
+            free(classifier);
+            classifier = NULL;
+            (void)close_run(sim, events, &cache_hooks, &tlb_hooks, classifier);
+            error(pgm, "cannot initialize the miss classifier.");
+            return 4;
+        }
+        (void)cache_classifier_attach(&sim->cache_probes, classifier);
+    }
+
+    // running counters: SIGUSR1 snapshots, and the shared-memory page on demand
+    live_t live;
+    if (live_open(live_name, &live) == ERR_NONE) {
+        sim->live = &live;
+    } else {
+        fprintf(stderr, "WARNING: no live statistics\n");
+    }
+
+    size_t done = 0;
+    size_t read = 0;
+    if (nb_threads >= 0) {
+        err = sim_run_file_parallel(sim, argv[3], (size_t) nb_threads, &done, &read);
+    } else {
+        err = sim_run_file(sim, argv[3], &done, &read);
+    }
+    if (sim->live != NULL) (void)live_close(sim->live, sim);
+    const int read_failed = (err != ERR_NONE && done == read);
+    if (read_failed && !compression_supported(compression_of_file(argv[3]))) {
+        fprintf(stderr, "ERROR: %s is zstd-compressed, but the emulator was built without zstd (make ZSTD=1)\n",
+                argv[3]);
+    } else if (read_failed) {
+        fprintf(stderr, "ERROR: cannot read command " SIZE_T_FMT " of %s: %s\n", read + 1, argv[3],
+                ERR_MESSAGES[err - ERR_NONE]);
+    } else if (err != ERR_NONE) {
+        fprintf(stderr, "ERROR: command " SIZE_T_FMT ": %s\n", done + 1, ERR_MESSAGES[err - ERR_NONE]);
+    }
+    (void)sim_print_stats(stdout, sim);
+    (void)profile_print(stderr); // only when compiled with -DPROFILE
+
+    if (with_stats && export_stats(sim, stats_format, stats_prefix) != ERR_NONE) {
+        fprintf(stderr, "ERROR: cannot print statistics\n");
+        if (err == ERR_NONE) err = ERR_IO;
+    }
+
+    if (heatmap_filename != NULL) {
+        FILE* output = fopen(heatmap_filename, "w");
+        if (output == NULL || heatmap_print(output, &cache_heatmap, &tlb_heatmap) != ERR_NONE) {
+            fprintf(stderr, "ERROR: cannot print per-set counters\n");
+            if (err == ERR_NONE) err = ERR_IO;
+        }
+        if (output != NULL) (void)fclose(output);
+    }
+
+    const int close_err = close_run(sim, events, &cache_hooks, &tlb_hooks, classifier);
+    if (err == ERR_NONE) err = close_err;
+    return err == ERR_NONE ? 0 : read_failed ? 3 : 5;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+/**
+ * @file event_trace.h
+ * @brief definitions associated to sampled event traces: one compact binary
+ *        record per sampled access, buffered in a lock-free ring and written
+ *        to a file by a background thread
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "hooks.h"
+
+#include <stdio.h>  // for FILE
+#include <stdint.h>
+#include <stddef.h> // for size_t
+#include <stdatomic.h>
+#include <pthread.h>
+
+/**
+ * One access out of `sample_rate` is recorded (the first one, then every
+ * `sample_rate` accesses), with where the translation and the data were found
+ * and the L1 line the access evicted, if any.
+ *
+ * The record is filled through the hooks of the trace (see hooks.h), attached
+ * to the probes of its simulation (see probes.h) during the recorded accesses
+ * only: the other accesses only cost one comparison, and hooks attached by
+ * others keep being called alongside.
+ *
+ * A trace belongs to one simulation (see sim_t), whose thread fills its ring
+ * (single producer); the writer thread of the ring is its single consumer.
+ * Neither ever waits for the other: when the ring is full, the record is
+ * dropped and counted. Simulations running side by side, each with its own
+ * probes, each write their own trace.
+ *
+ * File format (version 1), all fields in host (little-endian) byte order:
+ *  - one header (event_trace_header_t, 24 bytes), whose `dropped` field is
+ *    only known (rewritten) once the trace is closed,
+ *  - followed by fixed-width records (event_record_t, 24 bytes each), in the
+ *    order of the accesses, until the end of the file.
+ */
+
+#define EVENT_TRACE_MAGIC      "i7ET" // 4 bytes, no terminating '\0' in file
+#define EVENT_TRACE_MAGIC_SIZE 4
+#define EVENT_TRACE_VERSION    1
+
+#define EVENT_RING_RECORDS  (1u << 16) // must be a power of 2
+#define EVENT_NO_VICTIM     UINT32_MAX
+
+typedef struct event_trace_header {
+    char magic[EVENT_TRACE_MAGIC_SIZE]; // EVENT_TRACE_MAGIC
+    uint16_t version;                   // EVENT_TRACE_VERSION
+    uint16_t record_size;               // sizeof(event_record_t)
+    uint32_t sample_rate;               // one access recorded out of sample_rate
+    uint32_t reserved;                  // 0
+    uint64_t dropped;                   // records lost because the ring was full
+} event_trace_header_t;
+
+// where a translation or a word was found
+enum event_level { EVENT_L1, EVENT_L2, EVENT_MEMORY };
+typedef enum event_level event_level_t;
+
+typedef struct event_record {
+    uint64_t access;        // index of the access from the start of the run (0 for the first one)
+    uint32_t paddr;         // physical address accessed
+    uint32_t victim;        // address of the L1 line evicted by the access, EVENT_NO_VICTIM if none
+    uint8_t order;          // command_word_t
+    uint8_t type;           // mem_access_t
+    uint8_t tlb_level;      // event_level_t; EVENT_MEMORY for a page walk
+    uint8_t cache_level;    // event_level_t
+    uint8_t reserved[4];    // 0
+} event_record_t;
+
+typedef struct event_ring {
+    event_record_t* records;        // EVENT_RING_RECORDS records
+    _Atomic size_t head;            // records ever pushed (by the simulating thread only)
+    _Atomic size_t tail;            // records ever popped (by the writer thread only)
+    _Atomic uint64_t dropped;       // records not pushed because the ring was full
+} event_ring_t;
+
+/**
+ * @brief Sampled event trace of one simulation.
+ */
+typedef struct event_trace {
+    FILE* file;
+    uint32_t sample_rate;
+    uint64_t next;                  // index of the next access to be recorded
+    event_record_t current;         // record of the access being executed
+    event_ring_t ring;
+    pthread_t writer;               // drains the ring to the file
+    atomic_int stop;                // asks the writer to drain the ring and exit
+    int writer_error;               // error code of the writer, once joined
+    cache_hooks_t cache_hooks;      // fill current, attached during recorded accesses only
+    tlb_hooks_t tlb_hooks;
+} event_trace_t;
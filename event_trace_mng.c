@@ -0,0 +1,177 @@
+/**
+ * @file event_trace_mng.c
+ * @brief sampled event traces: one binary record every N accesses, written
+ *        to a file by a background thread
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for nanosleep()
+
+#include "event_trace_mng.h"
+#include "error.h"
+#include "util.h"
+
+#include <stdlib.h> // for calloc(), free()
+#include <string.h> // for memcpy()
+#include <time.h>   // for nanosleep()
+
+_Static_assert(sizeof(event_trace_header_t) == 24, "event trace header must be 24 bytes");
+_Static_assert(sizeof(event_record_t) == 24, "event record must be 24 bytes");
+_Static_assert((EVENT_RING_RECORDS & (EVENT_RING_RECORDS - 1)) == 0, "ring size must be a power of 2");
+
+#define RING_MASK (EVENT_RING_RECORDS - 1)
+#define WRITER_PAUSE_NS 100000 // when the ring is empty
+
+//=========================================================================
+// Hooks filling the current record (data is the trace)
+static void on_cache_hit(void* data, cache_t level, uint16_t set _unused, uint8_t way _unused,
+                         uint32_t paddr _unused)
+{
+    ((event_trace_t*) data)->current.cache_level = (level == L2_CACHE) ? EVENT_L2 : EVENT_L1;
+}
+
+static void on_cache_evict(void* data, cache_t level, uint16_t set _unused, uint8_t way _unused,
+                           uint32_t paddr)
+{
+    if (level != L2_CACHE) ((event_trace_t*) data)->current.victim = paddr;
+}
+
+static void on_tlb_hit(void* data, tlb_t level, uint16_t set _unused, uint8_t way _unused,
+                       uint32_t paddr _unused)
+{
+    ((event_trace_t*) data)->current.tlb_level = (level == L2_TLB) ? EVENT_L2 : EVENT_L1;
+}
+
+//=========================================================================
+// Writes all the records of the ring to the file, until asked to stop
+static void* writer_main(void* arg)
+{
+    event_trace_t* trace = arg;
+    event_ring_t* ring = &trace->ring;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    for (;;) {
+        // stop is read before head: once stopping, the last records pushed are seen
+        const int stopping = atomic_load_explicit(&trace->stop, memory_order_acquire);
+        const size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == tail) {
+            if (stopping) break;
+            const struct timespec pause = { 0, WRITER_PAUSE_NS };
+            (void)nanosleep(&pause, NULL);
+            continue;
+        }
+        while (tail != head) {
+            size_t count = EVENT_RING_RECORDS - (tail & RING_MASK);
+            if (count > head - tail) count = head - tail;
+            if (trace->writer_error == ERR_NONE
+                && fwrite(&ring->records[tail & RING_MASK], sizeof(event_record_t), count, trace->file) != count) {
+                trace->writer_error = ERR_IO; // keep draining, so that the producer never blocks
+            }
+            tail += count;
+            atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        }
+    }
+    return NULL;
+}
+
+// Writes the header at the current position of the file
+static int write_header(const event_trace_t* trace)
+{
+    event_trace_header_t header;
+    zero_init_var(header);
+    memcpy(header.magic, EVENT_TRACE_MAGIC, EVENT_TRACE_MAGIC_SIZE);
+    header.version = EVENT_TRACE_VERSION;
+    header.record_size = sizeof(event_record_t);
+    header.sample_rate = trace->sample_rate;
+    header.dropped = atomic_load(&trace->ring.dropped);
+    return fwrite(&header, sizeof(header), 1, trace->file) == 1 ? ERR_NONE : ERR_IO;
+}
+
+//=========================================================================
+int event_trace_open(const char* filename, uint32_t sample_rate, event_trace_t* trace)
+{
+    M_REQUIRE_NON_NULL(filename);
+    M_REQUIRE_NON_NULL(trace);
+    M_REQUIRE(sample_rate > 0, ERR_BAD_PARAMETER, "%s", "sample rate must be positive");
+
+    zero_init_ptr(trace);
+    trace->sample_rate = sample_rate;
+    atomic_init(&trace->ring.head, 0);
+    atomic_init(&trace->ring.tail, 0);
+    atomic_init(&trace->ring.dropped, 0);
+    atomic_init(&trace->stop, 0);
+    trace->cache_hooks.on_hit = on_cache_hit;
+    trace->cache_hooks.on_evict = on_cache_evict;
+    trace->cache_hooks.data = trace;
+    trace->tlb_hooks.on_hit = on_tlb_hit;
+    trace->tlb_hooks.data = trace;
+
+    trace->ring.records = calloc(EVENT_RING_RECORDS, sizeof(event_record_t));
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(trace->ring.records, ERR_MEM);
+
+    trace->file = fopen(filename, "wb");
+    int err = (trace->file == NULL) ? ERR_IO : write_header(trace);
+    if (err == ERR_NONE && pthread_create(&trace->writer, NULL, writer_main, trace) != 0) {
+        err = ERR_MEM;
+    }
+    if (err != ERR_NONE) {
+        if (trace->file != NULL) (void)fclose(trace->file);
+        free(trace->ring.records);
+        zero_init_ptr(trace);
+        M_EXIT(err, "cannot start the event trace \"%s\"", filename);
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+void event_trace_begin(event_trace_t* trace, uint64_t access, command_word_t order, mem_access_t type)
+{
+    trace->next = access + trace->sample_rate;
+
+    event_record_t* record = &trace->current;
+    zero_init_ptr(record);
+    record->access = access;
+    record->victim = EVENT_NO_VICTIM;
+    record->order = (uint8_t) order;
+    record->type = (uint8_t) type;
+    record->tlb_level = EVENT_MEMORY;
+    record->cache_level = EVENT_MEMORY;
+}
+
+//=========================================================================
+void event_trace_end(event_trace_t* trace, uint32_t paddr)
+{
+    trace->current.paddr = paddr;
+
+    event_ring_t* ring = &trace->ring;
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == EVENT_RING_RECORDS) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    ring->records[head & RING_MASK] = trace->current;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+//=========================================================================
+int event_trace_close(event_trace_t* trace, uint64_t* dropped)
+{
+    M_REQUIRE_NON_NULL(trace);
+    M_REQUIRE_NON_NULL(trace->file);
+
+    atomic_store_explicit(&trace->stop, 1, memory_order_release);
+    int err = (pthread_join(trace->writer, NULL) == 0) ? trace->writer_error : ERR_IO;
+
+    if (err == ERR_NONE && (fseek(trace->file, 0, SEEK_SET) != 0 || write_header(trace) != ERR_NONE)) {
+        err = ERR_IO;
+    }
+    if (fclose(trace->file) != 0 && err == ERR_NONE) err = ERR_IO;
+    if (dropped != NULL) *dropped = atomic_load(&trace->ring.dropped);
+    free(trace->ring.records);
+    trace->ring.records = NULL;
+    trace->file = NULL;
+    return err;
+}
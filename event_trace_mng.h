@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+ * @file event_trace_mng.h
+ * @brief sampled event traces: one binary record every N accesses, written
+ *        to a file by a background thread
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "event_trace.h"
+#include "mem_access.h"
+#include "commands.h" // for command_word_t
+
+//=========================================================================
+/**
+ * @brief Create an event trace file and start its writer thread.
+ * @param filename the name of the file to be written
+ * @param sample_rate one access recorded out of sample_rate (> 0)
+ * @param trace (modified) the trace to be initialized
+ * @return error code
+ */
+int event_trace_open(const char* filename, uint32_t sample_rate, event_trace_t* trace);
+
+//=========================================================================
+/**
+ * @brief Whether the access of the given index (0 for the first one) is to be recorded.
+ *        Meant to be tested before every access: it costs a single comparison.
+ */
+#define event_trace_due(TRACE, ACCESS) ((ACCESS) >= (TRACE)->next)
+
+//=========================================================================
+/**
+ * @brief Start recording an access: its events are collected until
+ *        event_trace_end(), through the hook tables of the trace, which the
+ *        caller attaches to the probes of its simulation meanwhile (see sim_execute()).
+ * @param trace the trace
+ * @param access the index of the access from the start of the run
+ * @param order read or write
+ * @param type instruction or data
+ */
+void event_trace_begin(event_trace_t* trace, uint64_t access, command_word_t order, mem_access_t type);
+
+//=========================================================================
+/**
+ * @brief End recording the current access and push its record to the ring
+ *        (or drop it, if the ring is full). Never waits for the writer thread.
+ * @param trace the trace
+ * @param paddr the physical address accessed
+ */
+void event_trace_end(event_trace_t* trace, uint32_t paddr);
+
+//=========================================================================
+/**
+ * @brief Stop the writer thread once the ring is drained, write the number
+ *        of dropped records in the header and close the file.
+ * @param trace the trace
+ * @param dropped (modified) the number of records dropped, if not NULL
+ * @return error code
+ */
+int event_trace_close(event_trace_t* trace, uint64_t* dropped);
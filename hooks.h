@@ -0,0 +1,72 @@
+#pragma once
+
+/**
+ * @file hooks.h
+ * @brief definitions associated to event hooks: user callbacks called by
+ *        the cache and TLB engines on each hit, miss, fill, eviction,
+ *        promotion (L2 to L1) and page walk
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "cache.h"
+#include "tlb_hrchy.h"
+
+#include <stdint.h>
+
+/**
+ * Every callback gets the data pointer of its table, then the level (cache_t
+ * or tlb_t) and the set (line, for the direct-mapped TLBs) concerned, the
+ * way (HIT_WAY_MISS for a cache miss, always 0 in TLBs) and the physical
+ * address concerned:
+ *  - caches: the address looked up (hit, miss), of the line inserted (fill),
+ *    of the line replaced (evict), of the line moved from L2 to L1 (promote,
+ *    at level L2_CACHE and reported after its hit);
+ *  - TLBs: the physical page address translating the page looked up (hit,
+ *    miss: reported once the translation is found, i.e. after the L2 hit or
+ *    the page walk), inserted (fill), or replaced or invalidated (evict); the
+ *    page walk is reported at level L2_TLB, before the L2 fill.
+ *
+ * Any callback may be NULL. Tables are attached to the probes of a hierarchy
+ * (see probes.h), several at once. When none is attached (the default), each
+ * event costs one well-predicted test; compiling with -DWITHOUT_HOOKS removes
+ * even that.
+ */
+
+typedef void (*cache_hook_t)(void* data, cache_t level, uint16_t set, uint8_t way, uint32_t paddr);
+
+typedef struct cache_hooks {
+    cache_hook_t on_hit;
+    cache_hook_t on_miss;
+    cache_hook_t on_fill;
+    cache_hook_t on_evict;
+    cache_hook_t on_promote;
+    void* data;             // passed back to every callback
+} cache_hooks_t;
+
+typedef void (*tlb_hook_t)(void* data, tlb_t level, uint16_t set, uint8_t way, uint32_t paddr);
+
+typedef struct tlb_hooks {
+    tlb_hook_t on_hit;
+    tlb_hook_t on_miss;
+    tlb_hook_t on_fill;
+    tlb_hook_t on_evict;
+    tlb_hook_t on_page_walk;
+    void* data;             // passed back to every callback
+} tlb_hooks_t;
+
+// --------------------------------------------------
+// calls a callback of every table attached to PROBES (cache_probes_t* or
+// tlb_probes_t*, see probes.h), if any
+#ifndef WITHOUT_HOOKS
+#define fire_hook(PROBES, EVENT, LEVEL, SET, WAY, PADDR) \
+    do { \
+        for (unsigned hook_ = 0; hook_ < (PROBES)->nb_hooks; ++hook_) { \
+            if ((PROBES)->hooks[hook_]->EVENT != NULL) \
+                (PROBES)->hooks[hook_]->EVENT((PROBES)->hooks[hook_]->data, LEVEL, SET, WAY, PADDR); \
+        } \
+    } while (0)
+#else
+#define fire_hook(PROBES, EVENT, LEVEL, SET, WAY, PADDR) do { } while (0)
+#endif
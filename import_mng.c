@@ -0,0 +1,174 @@
+/**
+ * @file import_mng.c
+ * @brief Import of memory traces from other tools: Valgrind lackey
+ *        (valgrind --tool=lackey --trace-mem=yes) and DynamoRIO memtrace
+ *        (text output of the memtrace_simple client).
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "import_mng.h"
+#include "addr_mng.h"
+#include "error.h"
+#include "util.h"
+
+#include <string.h> // for strncmp()
+
+#define MEMTRACE_HEADER "Format:"
+
+//=========================================================================
+// Appends one word or byte command
+static int import_command(uint64_t vaddr, size_t data_size, command_word_t order, mem_access_t type,
+                          program_t* program)
+{
+    command_t command;
+    zero_init_var(command);
+    command.order = order;
+    command.type = type;
+    command.data_size = data_size;
+    command.write_data = 0;
+    M_EXIT_IF_ERR(init_virt_addr64(&command.vaddr, vaddr), "converting virtual address");
+
+    return program_add_command(program, &command);
+}
+
+//=========================================================================
+int import_access(uint64_t vaddr, size_t size, command_word_t order, mem_access_t type,
+                  program_t* program)
+{
+    M_REQUIRE_NON_NULL(program);
+    M_REQUIRE(!(order == WRITE && type == INSTRUCTION), ERR_BAD_PARAMETER, "cannot write an instructio%c", 'n');
+
+    const uint64_t end = vaddr + size;
+    if (type == INSTRUCTION) {
+        for (uint64_t word = vaddr & ~(uint64_t) (sizeof(word_t) - 1); word < end; word += sizeof(word_t)) {
+            M_EXIT_IF_ERR(import_command(word, sizeof(word_t), order, type, program), "adding instruction fetch");
+        }
+        return ERR_NONE;
+    }
+
+    for (uint64_t addr = vaddr; addr < end; ) {
+        const size_t data_size = (addr % sizeof(word_t) == 0 && end - addr >= sizeof(word_t)) ? sizeof(word_t) : 1;
+        M_EXIT_IF_ERR(import_command(addr, data_size, order, type, program), "adding data access");
+        addr += data_size;
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Parsing helpers: each returns the position after what it read, NULL if there was nothing to read
+
+static const char* skip_blanks(const char* p)
+{
+    while (*p == ' ' || *p == '\t') ++p;
+    return p;
+}
+
+// hexadecimal number, either case, without "0x"
+static const char* read_hex(const char* p, uint64_t* value)
+{
+    const char* const start = p;
+    *value = 0;
+    for (;; ++p) {
+        uint64_t digit;
+        if ('0' <= *p && *p <= '9') digit = (uint64_t) (*p - '0');
+        else if ('a' <= *p && *p <= 'f') digit = (uint64_t) (*p - 'a' + 10);
+        else if ('A' <= *p && *p <= 'F') digit = (uint64_t) (*p - 'A' + 10);
+        else break;
+        *value = (*value << 4) | digit;
+    }
+    return p == start ? NULL : p;
+}
+
+// decimal number
+static const char* read_dec(const char* p, size_t* value)
+{
+    const char* const start = p;
+    for (*value = 0; '0' <= *p && *p <= '9'; ++p) {
+        *value = *value * 10 + (size_t) (*p - '0');
+    }
+    return p == start ? NULL : p;
+}
+
+// nothing but blanks up to the end of the line
+static int at_end_of_line(const char* p)
+{
+    p = skip_blanks(p);
+    if (*p == '\r') ++p;
+    return *p == '\n' || *p == '\0';
+}
+
+//=========================================================================
+int import_lackey_line(const char* line, program_t* program)
+{
+    M_REQUIRE_NON_NULL(line);
+    M_REQUIRE_NON_NULL(program);
+
+    if (line[0] == '=' && line[1] == '=') return ERR_NONE;     // valgrind message
+    const char* p = skip_blanks(line);
+    if (at_end_of_line(p)) return ERR_NONE;
+
+    const char kind = *p++;
+    M_REQUIRE(*p == ' ' || *p == '\t', ERR_BAD_PARAMETER, "unexpected lackey line: %s", line);
+
+    uint64_t vaddr = 0;
+    size_t size = 0;
+    p = read_hex(skip_blanks(p), &vaddr);
+    if (p != NULL && *p == ',') p = read_dec(p + 1, &size);
+    M_REQUIRE(p != NULL && at_end_of_line(p), ERR_BAD_PARAMETER, "unexpected lackey line: %s", line);
+
+    switch (kind) {
+    case 'I':
+        return import_access(vaddr, size, READ, INSTRUCTION, program);
+    case 'L':
+        return import_access(vaddr, size, READ, DATA, program);
+    case 'S':
+        return import_access(vaddr, size, WRITE, DATA, program);
+    case 'M':
+        M_EXIT_IF_ERR(import_access(vaddr, size, READ, DATA, program), "importing load of modify");
+        return import_access(vaddr, size, WRITE, DATA, program);
+    default:
+        M_EXIT_ERR(ERR_BAD_PARAMETER, "unknown lackey access kind '%c'", kind);
+    }
+}
+
+//=========================================================================
+int import_memtrace_line(const char* line, program_t* program)
+{
+    M_REQUIRE_NON_NULL(line);
+    M_REQUIRE_NON_NULL(program);
+
+    const char* p = skip_blanks(line);
+    if (at_end_of_line(p) || strncmp(p, MEMTRACE_HEADER, strlen(MEMTRACE_HEADER)) == 0) return ERR_NONE;
+
+    uint64_t vaddr = 0;
+    size_t size = 0;
+    p = (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) ? read_hex(p + 2, &vaddr) : NULL;
+    if (p != NULL && *p == ':') p = read_dec(skip_blanks(p + 1), &size);
+    if (p != NULL && *p == ',') p = skip_blanks(p + 1);
+    else p = NULL;
+    M_REQUIRE(p != NULL && !at_end_of_line(p), ERR_BAD_PARAMETER, "unexpected memtrace line: %s", line);
+
+    // "r", "w", or the name of the opcode of an instruction
+    const char* const op = p;
+    while (!at_end_of_line(p) && *p != ' ' && *p != '\t') ++p;
+    M_REQUIRE(at_end_of_line(p), ERR_BAD_PARAMETER, "unexpected memtrace line: %s", line);
+
+    if (p - op == 1 && *op == 'r') return import_access(vaddr, size, READ, DATA, program);
+    if (p - op == 1 && *op == 'w') return import_access(vaddr, size, WRITE, DATA, program);
+    return import_access(vaddr, size, READ, INSTRUCTION, program);
+}
+
+//=========================================================================
+int import_line(import_format_t format, const char* line, program_t* program)
+{
+    switch (format) {
+    case IMPORT_LACKEY:
+        return import_lackey_line(line, program);
+    case IMPORT_MEMTRACE:
+        return import_memtrace_line(line, program);
+    default:
+        M_EXIT_ERR(ERR_BAD_PARAMETER, "unknown import format %d", format);
+    }
+}
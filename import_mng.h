@@ -0,0 +1,68 @@
+#pragma once
+
+/**
+ * @file import_mng.h
+ * @brief Import of memory traces from other tools: Valgrind lackey
+ *        (valgrind --tool=lackey --trace-mem=yes) and DynamoRIO memtrace
+ *        (text output of the memtrace_simple client).
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "commands.h"
+
+enum import_format { IMPORT_LACKEY, IMPORT_MEMTRACE };
+typedef enum import_format import_format_t;
+
+//=========================================================================
+/**
+ * @brief Split an access of any size into commands: data accesses into bytes
+ *        up to the first word boundary, aligned words, then the remaining bytes;
+ *        instruction fetches into all the (aligned) words they overlap.
+ *        No command crosses a word, hence no command crosses a cache line.
+ *        Written data is unknown in the imported formats: 0 is written.
+ * @param vaddr the first address accessed
+ * @param size the number of bytes accessed
+ * @param order READ or WRITE
+ * @param type INSTRUCTION or DATA (an instruction cannot be written)
+ * @param program (modified) the program the commands are appended to
+ * @return error code
+ */
+int import_access(uint64_t vaddr, size_t size, command_word_t order, mem_access_t type,
+                  program_t* program);
+
+//=========================================================================
+/**
+ * @brief Import one line of a lackey trace:
+ *        "I  addr,size" (instruction fetch), " L addr,size" (load),
+ *        " S addr,size" (store) or " M addr,size" (modify: load then store),
+ *        addresses in hexadecimal. Valgrind messages ("==pid== ...") and
+ *        empty lines produce no command.
+ * @param line the line (with or without its '\n')
+ * @param program (modified) the program the commands are appended to
+ * @return error code
+ */
+int import_lackey_line(const char* line, program_t* program);
+
+//=========================================================================
+/**
+ * @brief Import one line of a DynamoRIO memtrace text dump:
+ *        "0xaddr: size, r" (read), "0xaddr: size, w" (write), or
+ *        "0xaddr: size, opcode" (instruction fetch). The "Format:" header
+ *        and empty lines produce no command.
+ * @param line the line (with or without its '\n')
+ * @param program (modified) the program the commands are appended to
+ * @return error code
+ */
+int import_memtrace_line(const char* line, program_t* program);
+
+//=========================================================================
+/**
+ * @brief Import one line of a trace of the given format.
+ * @param format the format of the line
+ * @param line the line (with or without its '\n')
+ * @param program (modified) the program the commands are appended to
+ * @return error code
+ */
+int import_line(import_format_t format, const char* line, program_t* program);
@@ -0,0 +1,66 @@
+#pragma once
+
+/**
+ * @file interval.h
+ * @brief definitions associated to interval (time-series) statistics:
+ *        one record per window of a fixed number of accesses
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "stats.h"
+
+#include <stdio.h>  // for FILE
+#include <stdint.h>
+
+/**
+ * Every window covers `period` accesses (the last one may be shorter) and gives,
+ * over that window only:
+ *  - the hit ratio of each cache level (hits / lookups, instruction and data together),
+ *  - the misses per 1000 accesses (MPKI) of each cache level,
+ *  - the TLB miss ratio (page walks / accesses), and the L1 TLB miss ratio.
+ *
+ * CSV format: a header line, then one line per window.
+ *
+ * Binary format (version 1), all fields in host (little-endian) byte order:
+ *  - one header (interval_header_t, 16 bytes),
+ *  - followed by fixed-width records (interval_record_t, 40 bytes each),
+ *    one per window, until the end of the file.
+ */
+
+#define INTERVAL_MAGIC      "i7IS" // 4 bytes, no terminating '\0' in file
+#define INTERVAL_MAGIC_SIZE 4
+#define INTERVAL_VERSION    1
+
+typedef struct interval_header {
+    char magic[INTERVAL_MAGIC_SIZE];    // INTERVAL_MAGIC
+    uint16_t version;                   // INTERVAL_VERSION
+    uint16_t record_size;               // sizeof(interval_record_t)
+    uint64_t period;                    // accesses per window
+} interval_header_t;
+
+typedef struct interval_record {
+    uint64_t accesses;                  // accesses from the start of the run to the end of the window
+    float hit_ratio[CACHE_LEVELS];      // indexed by cache_t
+    float mpki[CACHE_LEVELS];           // indexed by cache_t
+    float tlb_miss_ratio;
+    float l1_tlb_miss_ratio;
+} interval_record_t;
+
+enum interval_format { INTERVAL_CSV, INTERVAL_BINARY };
+typedef enum interval_format interval_format_t;
+
+/**
+ * @brief Writer of interval statistics: keeps the counters at the start of
+ *        the current window, to output the differences at its end.
+ */
+typedef struct interval {
+    FILE* file;
+    interval_format_t format;
+    uint64_t period;
+    uint64_t next;                      // number of accesses ending the current window
+    uint64_t start;                     // number of accesses starting the current window
+    cache_stats_t cache_start;          // counters at the start of the current window
+    tlb_stats_t tlb_start;
+} interval_t;
@@ -0,0 +1,149 @@
+/**
+ * @file interval_mng.c
+ * @brief interval (time-series) statistics: one record every N accesses
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "interval_mng.h"
+#include "stats_mng.h" // for stats_ratio()
+#include "tlb_hrchy.h" // for tlb_t
+#include "error.h"
+#include "util.h"
+
+#include <string.h>   // for memcpy(), strlen()
+#include <inttypes.h> // for PRIu64
+
+_Static_assert(sizeof(interval_header_t) == 16, "interval header must be 16 bytes");
+_Static_assert(sizeof(interval_record_t) == 40, "interval record must be 40 bytes");
+
+#define INTERVAL_CSV_HEADER \
+    "\"accesses\",\"l1i_hit_ratio\",\"l1d_hit_ratio\",\"l2_hit_ratio\"," \
+    "\"l1i_mpki\",\"l1d_mpki\",\"l2_mpki\",\"tlb_miss_ratio\",\"l1_tlb_miss_ratio\"\n"
+
+//=========================================================================
+int interval_open(const char* filename, uint64_t period, interval_format_t format,
+                  interval_t* interval)
+{
+    M_REQUIRE_NON_NULL(filename);
+    M_REQUIRE_NON_NULL(interval);
+    M_REQUIRE(period > 0, ERR_BAD_PARAMETER, "%s", "period must be positive");
+    M_REQUIRE(format == INTERVAL_CSV || format == INTERVAL_BINARY, ERR_BAD_PARAMETER,
+              "unknown interval format %d", format);
+
+    zero_init_ptr(interval);
+    interval->format = format;
+    interval->period = period;
+    interval->next = period;
+
+    interval->file = fopen(filename, format == INTERVAL_CSV ? "w" : "wb");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(interval->file, ERR_IO);
+
+    int ok = 1;
+    if (format == INTERVAL_CSV) {
+        ok = fputs(INTERVAL_CSV_HEADER, interval->file) != EOF;
+    } else {
+        interval_header_t header;
+        zero_init_var(header);
+        memcpy(header.magic, INTERVAL_MAGIC, INTERVAL_MAGIC_SIZE);
+        header.version = INTERVAL_VERSION;
+        header.record_size = sizeof(interval_record_t);
+        header.period = period;
+        ok = fwrite(&header, sizeof(header), 1, interval->file) == 1;
+    }
+    if (!ok) {
+        fclose(interval->file);
+        interval->file = NULL;
+        M_EXIT(ERR_IO, "cannot write header of \"%s\"", filename);
+    }
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Fills the record of the window from the start counters to the given ones
+static void record_fill(const interval_t* interval, uint64_t accesses,
+                        const cache_stats_t* cache, const tlb_stats_t* tlb,
+                        interval_record_t* record)
+{
+    const uint64_t window = accesses - interval->start;
+    record->accesses = accesses;
+
+    for (int level = 0; level < CACHE_LEVELS; ++level) {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        for (int access = 0; access < MEM_ACCESS_TYPES; ++access) {
+            hits += cache->counters[level][access].hits
+                    - interval->cache_start.counters[level][access].hits;
+            misses += cache->counters[level][access].misses
+                      - interval->cache_start.counters[level][access].misses;
+        }
+        record->hit_ratio[level] = stats_ratio(hits, hits + misses);
+        record->mpki[level] = stats_ratio(1000 * misses, window);
+    }
+
+    const uint64_t walks = tlb->page_walks.walks - interval->tlb_start.page_walks.walks;
+    const uint64_t l1_misses = tlb->counters[L1_ITLB].misses + tlb->counters[L1_DTLB].misses
+                               - interval->tlb_start.counters[L1_ITLB].misses
+                               - interval->tlb_start.counters[L1_DTLB].misses;
+    record->tlb_miss_ratio = stats_ratio(walks, window);
+    record->l1_tlb_miss_ratio = stats_ratio(l1_misses, window);
+}
+
+// Writes one record and starts the next window
+static int interval_write(interval_t* interval, uint64_t accesses,
+                          const cache_stats_t* cache, const tlb_stats_t* tlb)
+{
+    interval_record_t record;
+    zero_init_var(record);
+    record_fill(interval, accesses, cache, tlb, &record);
+
+    int ok = 1;
+    if (interval->format == INTERVAL_CSV) {
+        ok = fprintf(interval->file, "%" PRIu64 ",%.4f,%.4f,%.4f,%.2f,%.2f,%.2f,%.4f,%.4f\n",
+                     record.accesses,
+                     record.hit_ratio[L1_ICACHE], record.hit_ratio[L1_DCACHE], record.hit_ratio[L2_CACHE],
+                     record.mpki[L1_ICACHE], record.mpki[L1_DCACHE], record.mpki[L2_CACHE],
+                     record.tlb_miss_ratio, record.l1_tlb_miss_ratio) > 0;
+    } else {
+        ok = fwrite(&record, sizeof(record), 1, interval->file) == 1;
+    }
+    M_REQUIRE(ok, ERR_IO, "cannot write interval ending at access %" PRIu64, accesses);
+
+    interval->start = accesses;
+    interval->next = accesses + interval->period;
+    interval->cache_start = *cache;
+    interval->tlb_start = *tlb;
+    return ERR_NONE;
+}
+
+//=========================================================================
+int interval_sample(interval_t* interval, uint64_t accesses,
+                    const cache_stats_t* cache, const tlb_stats_t* tlb)
+{
+    M_REQUIRE_NON_NULL(interval);
+    M_REQUIRE_NON_NULL(interval->file);
+    M_REQUIRE_NON_NULL(cache);
+    M_REQUIRE_NON_NULL(tlb);
+
+    return interval_write(interval, accesses, cache, tlb);
+}
+
+//=========================================================================
+int interval_close(interval_t* interval, uint64_t accesses,
+                   const cache_stats_t* cache, const tlb_stats_t* tlb)
+{
+    M_REQUIRE_NON_NULL(interval);
+    M_REQUIRE_NON_NULL(cache);
+    M_REQUIRE_NON_NULL(tlb);
+    if (interval->file == NULL) return ERR_NONE;
+
+    int err = ERR_NONE;
+    if (accesses > interval->start) {
+        err = interval_write(interval, accesses, cache, tlb);
+    }
+    if (fclose(interval->file) != 0 && err == ERR_NONE) err = ERR_IO;
+    interval->file = NULL;
+    return err;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+/**
+ * @file interval_mng.h
+ * @brief interval (time-series) statistics: one record every N accesses
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "interval.h"
+
+//=========================================================================
+/**
+ * @brief Create an interval statistics file; the first window starts now,
+ *        with all counters to zero.
+ * @param filename the name of the file to be written
+ * @param period the number of accesses per window (> 0)
+ * @param format CSV or binary
+ * @param interval (modified) the writer to be initialized
+ * @return error code
+ */
+int interval_open(const char* filename, uint64_t period, interval_format_t format,
+                  interval_t* interval);
+
+//=========================================================================
+/**
+ * @brief Whether the current window is complete after the given number of accesses.
+ *        Meant to be tested after every access: it costs a single comparison.
+ */
+#define interval_due(INTERVAL, ACCESSES) ((ACCESSES) >= (INTERVAL)->next)
+
+//=========================================================================
+/**
+ * @brief Output the record of the window ending now, and start the next one.
+ * @param interval the writer
+ * @param accesses the number of accesses from the start of the run
+ * @param cache the current counters of the cache hierarchy
+ * @param tlb the current counters of the TLB hierarchy
+ * @return error code
+ */
+int interval_sample(interval_t* interval, uint64_t accesses,
+                    const cache_stats_t* cache, const tlb_stats_t* tlb);
+
+//=========================================================================
+/**
+ * @brief Output the last, incomplete, window (if not empty) and close the file.
+ * @param interval the writer
+ * @param accesses the number of accesses from the start of the run
+ * @param cache the current counters of the cache hierarchy
+ * @param tlb the current counters of the TLB hierarchy
+ * @return error code
+ */
+int interval_close(interval_t* interval, uint64_t accesses,
+                   const cache_stats_t* cache, const tlb_stats_t* tlb);
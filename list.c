@@ -128,6 +128,22 @@ void move_back(list_t* this, node_t* node) {
     }
 }
 
+void move_front(list_t* this, node_t* node) {
+    if (this != NULL && node != NULL && node->previous != NULL) {
+        node->previous->next = node->next;
+        if (node->next != NULL) {
+            node->next->previous = node->previous;
+        } else {
+            this->back = node->previous;
+        }
+
+        node->previous = NULL;
+        node->next = this->front;
+        this->front->previous = node;
+        this->front = node;
+    }
+}
+
 int print_list(FILE* stream, const list_t* this) {
     int i = 0;
 
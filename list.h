@@ -98,6 +98,13 @@ void pop_front(list_t* this);
  */
 void move_back(list_t* this, node_t* node);
 
+/**
+ * @brief move a node a the begining of the list
+ * @param this list to modify
+ * @param node pointer to the node to be moved
+ */
+void move_front(list_t* this, node_t* node);
+
 /**
  * @brief print a list (on one single line, no newline)
  * @param stream where to print to
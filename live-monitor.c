@@ -0,0 +1,80 @@
+/**
+ * @file live-monitor.c
+ * @brief prints the live statistics published by a running emulator (-L name)
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#if defined _WIN32  || defined _WIN64
+#define __USE_MINGW_ANSI_STDIO 1
+#endif
+
+#define _POSIX_C_SOURCE 200809L // for getopt(), nanosleep()
+
+#include "error.h"
+#include "live_mng.h"
+
+#include <stdio.h>
+#include <stdlib.h>   // for strtod()
+#include <inttypes.h> // for PRIu64
+#include <unistd.h>   // for getopt()
+#include <time.h>     // for nanosleep()
+#include <assert.h>
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [-w seconds] name\n", pgm);
+    fprintf(stderr, "options:  -w seconds     print again every that many seconds, until the run is over\n");
+    fprintf(stderr, "example:  %s -w 10 sweep42\n", pgm);
+}
+
+// ======================================================================
+static void print_snapshot(const live_page_t* page)
+{
+    printf("pid %" PRId32 ": %" PRIu64 " accesses in %.1f s (%.0f accesses/s), "
+           "hit ratios: l1i %.4f, l1d %.4f, l2 %.4f, tlb %.4f%s\n",
+           page->pid, page->accesses, page->elapsed, page->accesses_per_sec,
+           page->hit_ratio[L1_ICACHE], page->hit_ratio[L1_DCACHE], page->hit_ratio[L2_CACHE],
+           page->tlb_hit_ratio, page->done ? " (done)" : "");
+    fflush(stdout);
+}
+
+// ======================================================================
+int main(int argc, char* argv[])
+{
+    const char* pgm = argv[0];
+    double wait = 0.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:")) != -1) {
+        if (opt != 'w' || (wait = strtod(optarg, NULL)) <= 0.0) {
+            error(pgm, "invalid option.");
+            return 1;
+        }
+    }
+    if (optind + 1 != argc) {
+        error(pgm, "please provide the name given to the emulator (-L name):");
+        return 1;
+    }
+    const char* name = argv[optind];
+
+    live_page_t page;
+    if (live_read(name, &page) != ERR_NONE) {
+        fprintf(stderr, "ERROR: no live statistics named \"%s\"\n", name);
+        return 2;
+    }
+    print_snapshot(&page);
+
+    const struct timespec pause = { (time_t) wait, (long) ((wait - (double) (time_t) wait) * 1e9) };
+    while (wait > 0.0 && !page.done) {
+        (void)nanosleep(&pause, NULL);
+        if (live_read(name, &page) != ERR_NONE) break; // the run is over
+        print_snapshot(&page);
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+/**
+ * @file live.h
+ * @brief definitions associated to live statistics: running counters
+ *        published during a simulation, in a shared-memory page and on
+ *        demand (SIGUSR1) to the standard error
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "stats.h"
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/**
+ * Every LIVE_PERIOD accesses, the simulator refreshes the page (if any) and,
+ * if SIGUSR1 was received since the last refresh, prints a full snapshot of
+ * its counters to the standard error. Between refreshes, an access only costs
+ * one comparison.
+ *
+ * The page is a POSIX shared-memory object ("/name", see shm_open(3)), removed
+ * at the end of the run. It is protected by a sequence lock: the simulator
+ * makes `seq` odd while writing, then even again; a monitor copies the page
+ * and retries as long as `seq` was odd or changed meanwhile (see live_read()).
+ * It never blocks the simulator.
+ */
+
+#define LIVE_MAGIC      "i7LV" // 4 bytes, no terminating '\0'
+#define LIVE_MAGIC_SIZE 4
+#define LIVE_VERSION    1
+#define LIVE_PERIOD     (1u << 16) // accesses between two refreshes
+
+typedef struct live_page {
+    char magic[LIVE_MAGIC_SIZE];        // LIVE_MAGIC
+    uint16_t version;                   // LIVE_VERSION
+    uint16_t size;                      // sizeof(live_page_t)
+    _Atomic uint32_t seq;               // odd while the page is being written
+    int32_t pid;                        // of the simulator
+    uint32_t done;                      // 1 once the run is over
+    uint64_t accesses;                  // accesses done
+    double elapsed;                     // seconds since the start of the run
+    double accesses_per_sec;            // over the last refresh period
+    float hit_ratio[CACHE_LEVELS];      // from the start of the run, indexed by cache_t
+    float tlb_hit_ratio;                // L1 or L2 TLB hits per translation
+} live_page_t;
+
+struct sigaction; // see sigaction(2)
+
+/**
+ * @brief Publisher of the live statistics of one simulation.
+ */
+typedef struct live {
+    char name[64];                      // of the shared-memory object, "" if none
+    live_page_t* page;                  // mapped page, NULL if none
+    uint64_t next;                      // number of accesses of the next refresh
+    double start;                       // time of live_open()
+    double last_time;                   // time of the last refresh
+    uint64_t last_accesses;             // accesses at the last refresh
+    struct sigaction* previous;         // handling of SIGUSR1 before live_open(), restored by live_close()
+} live_t;
@@ -0,0 +1,227 @@
+/**
+ * @file live_mng.c
+ * @brief live statistics: shared-memory page and signal-triggered snapshots
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for sigaction(), shm_open(), clock_gettime()
+
+#include "live_mng.h"
+#include "stats_mng.h"
+#include "error.h"
+#include "util.h"
+
+#include <stdlib.h>   // for malloc(), free()
+#include <string.h>   // for memcpy(), strlen()
+#include <inttypes.h> // for PRIu64
+#include <signal.h>
+#include <time.h>     // for clock_gettime()
+#include <fcntl.h>    // for O_* constants
+#include <unistd.h>   // for ftruncate(), close(), getpid()
+#include <sys/mman.h> // for shm_open(), mmap()
+#include <sched.h>    // for sched_yield()
+
+// set by the SIGUSR1 handler, cleared once the snapshot is printed
+static volatile sig_atomic_t snapshot_requested = 0;
+
+static void request_snapshot(int signum _unused)
+{
+    snapshot_requested = 1;
+}
+
+//=========================================================================
+// Returns the current time in seconds, from an arbitrary (but fixed) origin
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec + (double) t.tv_nsec * 1e-9;
+}
+
+// Writes the name of the shared-memory object, with its leading '/'
+static int shm_name(const char* name, char* full_name, size_t size)
+{
+    const int length = snprintf(full_name, size, "%s%s", name[0] == '/' ? "" : "/", name);
+    M_REQUIRE(length > 1 && (size_t) length < size, ERR_BAD_PARAMETER,
+              "invalid shared-memory name \"%s\"", name);
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Creates and maps the shared-memory page
+static int open_page(const char* name, live_t* live)
+{
+    M_EXIT_IF_ERR(shm_name(name, live->name, sizeof(live->name)), "naming the page");
+    const int fd = shm_open(live->name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    M_REQUIRE(fd >= 0, ERR_IO, "cannot create shared-memory object \"%s\"", live->name);
+    void* page = MAP_FAILED;
+    if (ftruncate(fd, sizeof(live_page_t)) == 0) {
+        page = mmap(NULL, sizeof(live_page_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    (void)close(fd);
+    if (page == MAP_FAILED) {
+        (void)shm_unlink(live->name);
+        M_EXIT(ERR_IO, "cannot map shared-memory object \"%s\"", live->name);
+    }
+    live->page = page;
+    memcpy(live->page->magic, LIVE_MAGIC, LIVE_MAGIC_SIZE);
+    live->page->version = LIVE_VERSION;
+    live->page->size = sizeof(live_page_t);
+    live->page->pid = (int32_t) getpid();
+    atomic_store_explicit(&live->page->seq, 0, memory_order_release);
+    return ERR_NONE;
+}
+
+//=========================================================================
+int live_open(const char* name, live_t* live)
+{
+    M_REQUIRE_NON_NULL(live);
+
+    zero_init_ptr(live);
+    live->next = LIVE_PERIOD;
+    live->start = live->last_time = now();
+
+    live->previous = malloc(sizeof(struct sigaction));
+    M_EXIT_IF_NULL(live->previous, sizeof(struct sigaction));
+    struct sigaction action;
+    zero_init_var(action);
+    action.sa_handler = request_snapshot;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(SIGUSR1, &action, live->previous) != 0) {
+        free(live->previous);
+        live->previous = NULL;
+        M_EXIT(ERR_IO, "%s", "cannot catch SIGUSR1");
+    }
+
+    if (name != NULL) {
+        const int err = open_page(name, live);
+        if (err != ERR_NONE) {
+            (void)sigaction(SIGUSR1, live->previous, NULL);
+            free(live->previous);
+            live->previous = NULL;
+            return err;
+        }
+    }
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Updates the page under the sequence lock
+static void write_page(live_t* live, const sim_t* sim, double elapsed, double rate, uint32_t done)
+{
+    live_page_t* page = live->page;
+    const uint32_t seq = atomic_load_explicit(&page->seq, memory_order_relaxed);
+    atomic_store_explicit(&page->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    page->done = done;
+    page->accesses = sim->stats.accesses;
+    page->elapsed = elapsed;
+    page->accesses_per_sec = rate;
+    for (int level = 0; level < CACHE_LEVELS; ++level) {
+        uint64_t hits = 0;
+        uint64_t lookups = 0;
+        for (int access = 0; access < MEM_ACCESS_TYPES; ++access) {
+            const cache_counters_t* c = &sim->cache_stats.counters[level][access];
+            hits += c->hits;
+            lookups += c->hits + c->misses;
+        }
+        page->hit_ratio[level] = stats_ratio(hits, lookups);
+    }
+    page->tlb_hit_ratio = stats_ratio(sim->stats.tlb_hits, sim->stats.tlb_hits + sim->stats.tlb_misses);
+
+    atomic_store_explicit(&page->seq, seq + 2, memory_order_release);
+}
+
+// Prints all the counters to stderr
+static void print_snapshot(const sim_t* sim, double elapsed, double rate)
+{
+    fprintf(stderr, "--- snapshot: %" PRIu64 " accesses, %.3f s, %.0f accesses/s ---\n",
+            sim->stats.accesses, elapsed, rate);
+    (void)cache_stats_print(stderr, &sim->cache_stats, STATS_CSV);
+    fputc('\n', stderr);
+    (void)tlb_stats_print(stderr, &sim->tlb_stats, STATS_CSV);
+    fflush(stderr);
+}
+
+//=========================================================================
+int live_publish(live_t* live, const sim_t* sim)
+{
+    M_REQUIRE_NON_NULL(live);
+    M_REQUIRE_NON_NULL(sim);
+
+    const double t = now();
+    const double rate = t > live->last_time
+                        ? (double) (sim->stats.accesses - live->last_accesses) / (t - live->last_time) : 0.0;
+    live->next = sim->stats.accesses + LIVE_PERIOD;
+    live->last_time = t;
+    live->last_accesses = sim->stats.accesses;
+
+    if (live->page != NULL) write_page(live, sim, t - live->start, rate, 0);
+    if (snapshot_requested) {
+        snapshot_requested = 0;
+        print_snapshot(sim, t - live->start, rate);
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+int live_close(live_t* live, const sim_t* sim)
+{
+    M_REQUIRE_NON_NULL(live);
+    M_REQUIRE_NON_NULL(sim);
+
+    if (live->previous != NULL) {
+        (void)sigaction(SIGUSR1, live->previous, NULL);
+        free(live->previous);
+        live->previous = NULL;
+    }
+    if (live->page != NULL) {
+        const double t = now();
+        write_page(live, sim, t - live->start,
+                   t > live->start ? (double) sim->stats.accesses / (t - live->start) : 0.0, 1);
+        (void)munmap(live->page, sizeof(live_page_t));
+        (void)shm_unlink(live->name);
+        live->page = NULL;
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+int live_read(const char* name, live_page_t* snapshot)
+{
+    M_REQUIRE_NON_NULL(name);
+    M_REQUIRE_NON_NULL(snapshot);
+
+    char full_name[sizeof(((live_t*) NULL)->name)];
+    M_EXIT_IF_ERR(shm_name(name, full_name, sizeof(full_name)), "naming the page");
+    const int fd = shm_open(full_name, O_RDONLY, 0);
+    if (fd < 0) return ERR_IO;
+    const live_page_t* page = mmap(NULL, sizeof(live_page_t), PROT_READ, MAP_SHARED, fd, 0);
+    (void)close(fd);
+    M_REQUIRE(page != MAP_FAILED, ERR_IO, "cannot map shared-memory object \"%s\"", full_name);
+
+    int err = ERR_NONE;
+    if (memcmp(page->magic, LIVE_MAGIC, LIVE_MAGIC_SIZE) != 0 || page->version != LIVE_VERSION
+        || page->size != sizeof(live_page_t)) {
+        err = ERR_IO;
+    }
+    uint32_t before = 0;
+    uint32_t after = 0;
+    while (err == ERR_NONE) {
+        before = atomic_load_explicit(&page->seq, memory_order_acquire);
+        if (before % 2 == 0) {
+            memcpy(snapshot, (const void*) page, sizeof(live_page_t));
+            atomic_thread_fence(memory_order_acquire);
+            after = atomic_load_explicit(&page->seq, memory_order_relaxed);
+            if (after == before) break;
+        }
+        sched_yield();
+    }
+    (void)munmap((void*) page, sizeof(live_page_t));
+    return err;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+/**
+ * @file live_mng.h
+ * @brief live statistics: shared-memory page and signal-triggered snapshots
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "live.h"
+#include "sim.h"
+
+//=========================================================================
+/**
+ * @brief Start publishing live statistics: create the shared-memory page
+ *        (if name is not NULL) and catch SIGUSR1 to print snapshots.
+ * @param name the name of the shared-memory object ("/" prepended if missing), or NULL
+ * @param live (modified) the publisher to be initialized
+ * @return error code
+ */
+int live_open(const char* name, live_t* live);
+
+//=========================================================================
+/**
+ * @brief Whether the statistics are to be refreshed after the given number of accesses.
+ *        Meant to be tested after every access: it costs a single comparison.
+ */
+#define live_due(LIVE, ACCESSES) ((ACCESSES) >= (LIVE)->next)
+
+//=========================================================================
+/**
+ * @brief Refresh the page, and print a snapshot to stderr if SIGUSR1 was received.
+ * @param live the publisher
+ * @param sim the simulation whose counters are published
+ * @return error code
+ */
+int live_publish(live_t* live, const sim_t* sim);
+
+//=========================================================================
+/**
+ * @brief Publish the final counters (marked as done), remove the page and
+ *        restore the handling of SIGUSR1 that live_open() replaced.
+ * @param live the publisher
+ * @param sim the simulation whose counters are published
+ * @return error code
+ */
+int live_close(live_t* live, const sim_t* sim);
+
+//=========================================================================
+/**
+ * @brief Read a consistent copy of a page published by another process.
+ * @param name the name of the shared-memory object ("/" prepended if missing)
+ * @param snapshot (modified) the copy
+ * @return error code (ERR_IO if there is no such page)
+ */
+int live_read(const char* name, live_page_t* snapshot);
@@ -4,25 +4,28 @@
 #include "addr.h"
 #include "cache.h"
 
+// AGES is the age array of a set of WAYS ways (see cache_set_ages())
 
-#define LRU_age_increase(TYPE, WAYS, WAY_INDEX, LINE_INDEX) \
+// cold start: the new way gets age 0, all the others grow older (saturating at WAYS - 1)
+#define LRU_age_increase(AGES, WAYS, WAY_INDEX) \
     { \
     foreach_way(var, WAYS){  \
         if(var == WAY_INDEX){   \
-            cache_age(TYPE, WAYS, LINE_INDEX, var) = 0; \
-        } \
-        if(cache_age(TYPE, WAYS, LINE_INDEX, var) < (WAYS - 1)) { \
-            cache_age(TYPE, WAYS, LINE_INDEX, var) += 1; \
+            (AGES)[var] = 0; \
+        } else if((AGES)[var] < (WAYS) - 1) { \
+            (AGES)[var] += 1; \
         }   \
     }}
 
 
-#define LRU_age_update(TYPE, WAYS, WAY_INDEX, LINE_INDEX) \
+// hit or replacement: only the ways younger than WAY_INDEX grow older
+#define LRU_age_update(AGES, WAYS, WAY_INDEX) \
     { \
+        const uint8_t age_of_way_ = (AGES)[WAY_INDEX]; \
         foreach_way(var, WAYS){  \
-            if (cache_age(TYPE, WAYS, LINE_INDEX, var) < cache_age(TYPE, WAYS, LINE_INDEX, WAY_INDEX)) { \
-                cache_age(TYPE, WAYS, LINE_INDEX, var) += 1; \
+            if ((AGES)[var] < age_of_way_) { \
+                (AGES)[var] += 1; \
             } \
-            cache_age(TYPE, WAYS, LINE_INDEX, WAY_INDEX) = 0; \
         } \
+        (AGES)[WAY_INDEX] = 0; \
     }
@@ -23,6 +23,11 @@
 #include <assert.h>
 #include <ctype.h>
 
+// page filenames in a description, e.g. generated ones, may be long paths
+#define PAGE_FILENAME_MAX 1023
+#define STR_(X) #X
+#define STR(X) STR_(X)
+
 // ======================================================================
 /**
  * @brief Tool function to print an address.
@@ -202,8 +207,8 @@ int mem_init_from_description(const char* master_filename, void** memory, size_t
         return nb_ok;
     }
 
-    char* page_filename = calloc(50, 1);
-    nb_ok = fscanf(entree, "%s", page_filename);
+    char* page_filename = calloc(PAGE_FILENAME_MAX + 1, 1);
+    nb_ok = fscanf(entree, "%" STR(PAGE_FILENAME_MAX) "s", page_filename);
     if(nb_ok == 0 || nb_ok ==EOF){
         free(*memory);
         free(page_filename);
@@ -260,7 +265,7 @@ int mem_init_from_description(const char* master_filename, void** memory, size_t
         return nb_ok;
     }
 
-        nb_ok = fscanf(entree, "%s", page_filename);
+        nb_ok = fscanf(entree, "%" STR(PAGE_FILENAME_MAX) "s", page_filename);
         if(nb_ok == 0 || nb_ok ==EOF){
             free(*memory);
             free(page_filename);
@@ -303,7 +308,7 @@ int mem_init_from_description(const char* master_filename, void** memory, size_t
         return nb_ok;
     }
 
-    nb_ok = fscanf(entree, "%s", page_filename);
+    nb_ok = fscanf(entree, "%" STR(PAGE_FILENAME_MAX) "s", page_filename);
     if(nb_ok == 0 || nb_ok ==EOF){
         free(*memory);
         free(page_filename);
@@ -0,0 +1,53 @@
+#pragma once
+
+/**
+ * @file miss_class.h
+ * @brief definitions associated to the classification of cache misses
+ *        in compulsory, capacity and conflict misses ("three C's")
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "cache.h"
+#include "list.h"
+#include "stats.h" // for CACHE_LEVELS
+
+#include <stdint.h>
+#include <stddef.h> // for size_t
+
+/**
+ * A miss of a cache level is:
+ *  - compulsory if the line was never looked up in this level before;
+ *  - conflict if a fully-associative LRU cache of the same capacity (the "shadow"
+ *    of the level), fed with the same lines, would have hit;
+ *  - capacity otherwise.
+ *
+ * The shadow of an L1 cache sees every lookup in that L1. As L2 is a victim
+ * cache exclusive of L1, the shadow of L2 gets the L1 victims and loses the
+ * lines looked up from L1, exactly as L2 does.
+ *
+ * Shadows find lines in O(1) with an open-addressing hash table (line number ->
+ * slot), and keep the LRU order of their slots in a list (see list.h).
+ */
+
+#define SHADOW_NO_LINE UINT32_MAX
+
+typedef struct shadow_cache {
+    uint32_t capacity;      // number of lines
+    uint32_t* lines;        // line number held by each slot, SHADOW_NO_LINE if none
+    node_t** nodes;         // node of each slot in the LRU list
+    list_t lru;             // slots, from least (front) to most (back) recently used
+    uint32_t* table;        // slot + 1 for each bucket, 0 for an empty bucket
+    uint32_t table_bits;    // log2 of the number of buckets (at least twice the capacity)
+} shadow_cache_t;
+
+typedef struct miss_classifier {
+    shadow_cache_t shadows[CACHE_LEVELS];   // indexed by cache_t
+    uint8_t* seen[CACHE_LEVELS];            // one bit per line of memory, set once looked up
+    size_t nb_lines;                        // number of lines of memory
+    uint32_t line_bits;                     // log2 of the line size of the caches
+} miss_classifier_t;
+
+enum miss_class { MISS_NONE, MISS_COMPULSORY, MISS_CAPACITY, MISS_CONFLICT };
+typedef enum miss_class miss_class_t;
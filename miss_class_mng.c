@@ -0,0 +1,184 @@
+/**
+ * @file miss_class_mng.c
+ * @brief classification of cache misses in compulsory, capacity and conflict misses
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "miss_class_mng.h"
+#include "error.h"
+#include "util.h"
+
+#include <stdlib.h> // for calloc(), free()
+#include <string.h> // for memset()
+
+// Fibonacci hashing: the top bits of the product are well mixed
+#define bucket_of(SHADOW, LINE) \
+    ((uint32_t) ((LINE) * 2654435761u) >> (32 - (SHADOW)->table_bits))
+#define next_bucket(SHADOW, BUCKET) (((BUCKET) + 1) & ((1u << (SHADOW)->table_bits) - 1))
+
+//=========================================================================
+static void shadow_free(shadow_cache_t* shadow)
+{
+    while (!is_empty_list(&shadow->lru)) pop_front(&shadow->lru);
+    free(shadow->lines);
+    free(shadow->nodes);
+    free(shadow->table);
+    zero_init_ptr(shadow);
+}
+
+static int shadow_init(shadow_cache_t* shadow, uint32_t capacity)
+{
+    zero_init_ptr(shadow);
+    init_list(&shadow->lru);
+    shadow->capacity = capacity;
+    shadow->table_bits = 1;
+    while ((1u << shadow->table_bits) < 2 * capacity) ++shadow->table_bits;
+
+    shadow->lines = calloc(capacity, sizeof(uint32_t));
+    shadow->nodes = calloc(capacity, sizeof(node_t*));
+    shadow->table = calloc((size_t) 1 << shadow->table_bits, sizeof(uint32_t));
+    int ok = shadow->lines != NULL && shadow->nodes != NULL && shadow->table != NULL;
+
+    for (list_content_t slot = 0; ok && slot < capacity; ++slot) {
+        shadow->lines[slot] = SHADOW_NO_LINE;
+        shadow->nodes[slot] = push_back(&shadow->lru, &slot);
+        ok = shadow->nodes[slot] != NULL;
+    }
+    if (!ok) {
+        shadow_free(shadow);
+        M_EXIT(ERR_MEM, "cannot allocate a shadow cache of %" PRIu32 " lines", capacity);
+    }
+    return ERR_NONE;
+}
+
+// Returns the bucket holding line, or the empty bucket ending its probe sequence
+static uint32_t shadow_find(const shadow_cache_t* shadow, uint32_t line)
+{
+    uint32_t bucket = bucket_of(shadow, line);
+    while (shadow->table[bucket] != 0 && shadow->lines[shadow->table[bucket] - 1] != line) {
+        bucket = next_bucket(shadow, bucket);
+    }
+    return bucket;
+}
+
+// Empties a bucket, shifting back the following entries of its cluster
+// (no tombstones: probe sequences stay short whatever the number of removals)
+static void shadow_unhash(shadow_cache_t* shadow, uint32_t bucket)
+{
+    uint32_t hole = bucket;
+    for (uint32_t next = next_bucket(shadow, hole); shadow->table[next] != 0;
+         next = next_bucket(shadow, next)) {
+        const uint32_t home = bucket_of(shadow, shadow->lines[shadow->table[next] - 1]);
+        // the entry at next may fill the hole if its home is not in (hole, next]
+        const int movable = (hole <= next) ? (home <= hole || home > next)
+                                           : (home <= hole && home > next);
+        if (movable) {
+            shadow->table[hole] = shadow->table[next];
+            hole = next;
+        }
+    }
+    shadow->table[hole] = 0;
+}
+
+// Makes line the most recently used one, inserting it in place of the least
+// recently used one if absent. Returns whether it was present.
+static int shadow_touch(shadow_cache_t* shadow, uint32_t line)
+{
+    uint32_t bucket = shadow_find(shadow, line);
+    if (shadow->table[bucket] != 0) {
+        move_back(&shadow->lru, shadow->nodes[shadow->table[bucket] - 1]);
+        return 1;
+    }
+
+    const list_content_t slot = shadow->lru.front->value;
+    if (shadow->lines[slot] != SHADOW_NO_LINE) {
+        shadow_unhash(shadow, shadow_find(shadow, shadow->lines[slot]));
+        bucket = shadow_find(shadow, line); // the cluster may have moved
+    }
+    shadow->lines[slot] = line;
+    shadow->table[bucket] = slot + 1;
+    move_back(&shadow->lru, shadow->nodes[slot]);
+    return 0;
+}
+
+// Removes line, if present, its slot becoming the first to be reused.
+// Returns whether it was present.
+static int shadow_remove(shadow_cache_t* shadow, uint32_t line)
+{
+    const uint32_t bucket = shadow_find(shadow, line);
+    if (shadow->table[bucket] == 0) return 0;
+
+    const list_content_t slot = shadow->table[bucket] - 1;
+    shadow_unhash(shadow, bucket);
+    shadow->lines[slot] = SHADOW_NO_LINE;
+    move_front(&shadow->lru, shadow->nodes[slot]);
+    return 1;
+}
+
+//=========================================================================
+int miss_classifier_init(miss_classifier_t* classifier, size_t mem_size,
+                         const cache_geometry_t geometry[CACHE_LEVELS])
+{
+    M_REQUIRE_NON_NULL(classifier);
+    M_REQUIRE_NON_NULL(geometry);
+
+    zero_init_ptr(classifier);
+    classifier->line_bits = geometry[L1_ICACHE].offset_bits; // the same at every level
+    classifier->nb_lines = mem_size >> classifier->line_bits;
+    int err = ERR_NONE;
+    for (int level = 0; err == ERR_NONE && level < CACHE_LEVELS; ++level) {
+        err = shadow_init(&classifier->shadows[level], geometry[level].sets * geometry[level].ways);
+        if (err == ERR_NONE) {
+            classifier->seen[level] = calloc(classifier->nb_lines / 8 + 1, 1);
+            if (classifier->seen[level] == NULL) err = ERR_MEM;
+        }
+    }
+    if (err != ERR_NONE) {
+        (void)miss_classifier_free(classifier);
+        M_EXIT(err, "%s", "cannot allocate the miss classifier");
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+int miss_classifier_free(miss_classifier_t* classifier)
+{
+    M_REQUIRE_NON_NULL(classifier);
+
+    for (int level = 0; level < CACHE_LEVELS; ++level) {
+        shadow_free(&classifier->shadows[level]);
+        free(classifier->seen[level]);
+        classifier->seen[level] = NULL;
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+miss_class_t miss_classify(miss_classifier_t* classifier, cache_t level, uint32_t paddr, int hit)
+{
+    const uint32_t line = paddr >> classifier->line_bits;
+
+    int first = 0;
+    if (line < classifier->nb_lines) {
+        uint8_t* byte = &classifier->seen[level][line / 8];
+        const uint8_t bit = (uint8_t) (1u << (line % 8));
+        first = !(*byte & bit);
+        *byte |= bit;
+    }
+
+    // exclusive L2: the line looked up leaves it, whether it hits or not
+    const int in_shadow = (level == L2_CACHE) ? shadow_remove(&classifier->shadows[level], line)
+                                              : shadow_touch(&classifier->shadows[level], line);
+
+    if (hit) return MISS_NONE;
+    if (first) return MISS_COMPULSORY;
+    return in_shadow ? MISS_CONFLICT : MISS_CAPACITY;
+}
+
+//=========================================================================
+void miss_classify_victim(miss_classifier_t* classifier, uint32_t paddr)
+{
+    (void)shadow_touch(&classifier->shadows[L2_CACHE], paddr >> classifier->line_bits);
+}
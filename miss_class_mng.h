@@ -0,0 +1,51 @@
+#pragma once
+
+/**
+ * @file miss_class_mng.h
+ * @brief classification of cache misses in compulsory, capacity and conflict misses
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "miss_class.h"
+
+//=========================================================================
+/**
+ * @brief "Constructor" for miss_classifier_t: empty shadows, no line seen.
+ *        The shadows have the capacity of the caches classified.
+ * @param classifier (modified) the classifier to be initialized
+ * @param mem_size size of the memory space (in bytes), to size the seen-lines bitmaps
+ * @param geometry the geometries of the caches classified, indexed by cache_t
+ *        (see cache_hierarchy_check())
+ * @return error code
+ */
+int miss_classifier_init(miss_classifier_t* classifier, size_t mem_size,
+                         const cache_geometry_t geometry[CACHE_LEVELS]);
+
+//=========================================================================
+/**
+ * @brief "Destructor" for miss_classifier_t.
+ * @param classifier the classifier to be freed
+ * @return error code
+ */
+int miss_classifier_free(miss_classifier_t* classifier);
+
+//=========================================================================
+/**
+ * @brief Classify a lookup in a cache level, and update the shadow of that level.
+ * @param classifier the classifier
+ * @param level the cache level looked up
+ * @param paddr the physical address looked up
+ * @param hit whether the actual cache level hit
+ * @return MISS_NONE on hit, the class of the miss otherwise
+ */
+miss_class_t miss_classify(miss_classifier_t* classifier, cache_t level, uint32_t paddr, int hit);
+
+//=========================================================================
+/**
+ * @brief Insert an L1 victim in the shadow of L2, as it is inserted in L2.
+ * @param classifier the classifier
+ * @param paddr a physical address of the victim line
+ */
+void miss_classify_victim(miss_classifier_t* classifier, uint32_t paddr);
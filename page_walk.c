@@ -1,4 +1,5 @@
 #include "page_walk.h"
+#include "profile.h"
 
 #define WORD_SIZE 4
 
@@ -14,6 +15,7 @@ int page_walk(const void* mem_space, const virt_addr_t* vaddr, phy_addr_t* paddr
     M_REQUIRE(mem_space != NULL, ERR_BAD_PARAMETER, "mem_space pointer is nul%c", 'l');
     M_REQUIRE(vaddr != NULL, ERR_BAD_PARAMETER, "vaddr pointer is nul%c", 'l');
     M_REQUIRE(paddr != NULL, ERR_BAD_PARAMETER, "paddr pointer is nul%c", 'l');
+    PROFILE_START(start);
 
    pte_t pgd_content = read_page_entry(mem_space, 0,  vaddr->pgd_entry);
    pte_t pud_content = read_page_entry(mem_space, pgd_content, vaddr->pud_entry);
@@ -22,6 +24,7 @@ int page_walk(const void* mem_space, const virt_addr_t* vaddr, phy_addr_t* paddr
 
     init_phy_addr(paddr, pte_content, vaddr->page_offset);
 
+    PROFILE_STOP(PROFILE_PAGE_WALK, start);
     return ERR_NONE;
 
 }
@@ -0,0 +1,327 @@
+/**
+ * @file parse_mng.c
+ * @brief Parallel loading of text command files: the file is split in chunks
+ *        at newline boundaries, which are parsed on a pool of threads.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#define _DEFAULT_SOURCE // for madvise()
+
+#include "parse_mng.h"
+#include "error.h"
+#include "util.h"
+
+#include <string.h> // for memchr(), memcpy()
+#include <stdlib.h>
+#include <stdint.h> // for SIZE_MAX
+#include <pthread.h>
+#include <fcntl.h>    // for open()
+#include <unistd.h>   // for close(), sysconf()
+#include <sys/mman.h> // for mmap(), madvise()
+#include <sys/stat.h> // for fstat()
+
+// A chunk of the file and the result of its parsing
+typedef struct {
+    const char* begin;      // first byte (just after a '\n')
+    const char* end;        // the chunk holds the commands starting before end
+    const char* stop;       // where the parsing actually stopped
+    program_t commands;
+    int error_code;
+    int parsed;             // commands and error_code are ready (under the lock of the job)
+} parse_chunk_t;
+
+// What the threads share: the chunks, the next one to parse and the progress of the consumer
+typedef struct {
+    const char* file_end;
+    parse_chunk_t* chunks;
+    size_t nb_chunks;
+    size_t next;            // next chunk to be parsed
+    size_t consumed;        // chunks already handed to the consumer
+    size_t window;          // at most that many chunks parsed ahead of the consumer
+    int stop;               // the consumer gave up: no more chunks to be parsed
+    pthread_mutex_t lock;   // protects all the above, and the parsed flags
+    pthread_cond_t changed; // a chunk was parsed or consumed, or stop was set
+} parse_job_t;
+
+//=========================================================================
+// Parses the commands starting in [begin, end[; the last one may go past end.
+// On error, chunk->commands.nb_lines is the number of the faulty line in the chunk, minus one.
+static void chunk_parse(parse_chunk_t* chunk, const char* begin, const char* file_end)
+{
+    command_t command;
+    chunk->stop = begin;
+    chunk->error_code = ERR_NONE;
+    while (chunk->stop < chunk->end) {
+        chunk->error_code = command_parse(&chunk->stop, file_end, 1, &command);
+        if (chunk->error_code == ERR_NONE) {
+            chunk->error_code = program_add_command(&chunk->commands, &command);
+        }
+        if (chunk->error_code != ERR_NONE) return;
+    }
+}
+
+//=========================================================================
+// Parses the chunk job->next, which the caller just claimed (with the lock held)
+static void claimed_chunk_parse(parse_job_t* job)
+{
+    parse_chunk_t* chunk = &job->chunks[job->next++];
+    pthread_mutex_unlock(&job->lock);
+
+    chunk->error_code = program_init(&chunk->commands);
+    if (chunk->error_code == ERR_NONE) {
+        chunk_parse(chunk, chunk->begin, job->file_end);
+    } else {
+        chunk->stop = chunk->begin;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    chunk->parsed = 1;
+    pthread_cond_broadcast(&job->changed);
+}
+
+//=========================================================================
+// Thread body: parses chunks, at most job->window ahead of the consumer, until there is none left
+static void* parse_worker(void* arg)
+{
+    parse_job_t* job = arg;
+    pthread_mutex_lock(&job->lock);
+    for (;;) {
+        while (!job->stop && job->next < job->nb_chunks && job->next - job->consumed >= job->window) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if (job->stop || job->next >= job->nb_chunks) break;
+        claimed_chunk_parse(job);
+    }
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+//=========================================================================
+// Waits until chunk i, the next one to be consumed, is parsed. If no thread
+// took it yet, the calling thread parses it itself.
+static void chunk_wait(parse_job_t* job, size_t i)
+{
+    pthread_mutex_lock(&job->lock);
+    while (!job->chunks[i].parsed) {
+        if (job->next == i) {
+            claimed_chunk_parse(job);
+        } else {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+//=========================================================================
+// Cuts [begin, end[ in at most nb_chunks chunks, each starting right after a '\n'
+static size_t chunks_split(const char* begin, const char* end, size_t chunk_size,
+                           parse_chunk_t* chunks, size_t nb_chunks)
+{
+    size_t n = 0;
+    const char* from = begin;
+    while (from < end && n < nb_chunks) {
+        const char* to = end;
+        if (n + 1 < nb_chunks && (size_t) (end - from) > chunk_size) {
+            const char* nl = memchr(from + chunk_size - 1, '\n', (size_t) (end - from) - (chunk_size - 1));
+            if (nl != NULL) to = nl + 1;
+        }
+        chunks[n].begin = from;
+        chunks[n].end = to;
+        ++n;
+        from = to;
+    }
+    return n;
+}
+
+//=========================================================================
+static size_t default_nb_threads(void)
+{
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (size_t) online : 1;
+}
+
+//=========================================================================
+// Hands the chunks to consume() in order, as they get parsed. A chunk whose
+// parsing did not start where the previous one stopped (a command spanning
+// its first line break, or an error before it) is parsed again, sequentially,
+// from the right place. The commands before a faulty line are consumed too.
+static int chunks_consume(parse_job_t* job, program_consumer_t consume, void* data, size_t* line)
+{
+    const char* expected = job->nb_chunks > 0 ? job->chunks[0].begin : NULL;
+    for (size_t i = 0; i < job->nb_chunks; ++i) {
+        chunk_wait(job, i);
+        parse_chunk_t* chunk = &job->chunks[i];
+        if (chunk->commands.listing == NULL) return chunk->error_code; // could not be initialized
+        if (chunk->begin != expected) {
+            chunk->commands.nb_lines = 0;
+            chunk_parse(chunk, expected, job->file_end);
+        }
+
+        int error_code = consume(data, &chunk->commands);
+        if (error_code != ERR_NONE) return error_code;
+        *line += chunk->commands.nb_lines;
+        if (chunk->error_code != ERR_NONE) {
+            ++*line;
+            return chunk->error_code;
+        }
+        program_free(&chunk->commands);
+        expected = chunk->stop;
+
+        pthread_mutex_lock(&job->lock);
+        ++job->consumed;
+        pthread_cond_broadcast(&job->changed);
+        pthread_mutex_unlock(&job->lock);
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Parses the mapped file [begin, end[ in chunks of chunk_size bytes, at most
+// window chunks ahead of consume()
+static int parse_mapped(const char* begin, const char* end, size_t nb_threads, size_t chunk_size,
+                        size_t window, program_consumer_t consume, void* data, size_t* line)
+{
+    const size_t max_chunks = (size_t) (end - begin) / chunk_size + 1;
+
+    parse_job_t job;
+    job.file_end = end;
+    job.chunks = calloc(max_chunks, sizeof(parse_chunk_t));
+    M_EXIT_IF_NULL(job.chunks, max_chunks * sizeof(parse_chunk_t));
+    job.nb_chunks = chunks_split(begin, end, chunk_size, job.chunks, max_chunks);
+    job.next = 0;
+    job.consumed = 0;
+    job.window = window;
+    job.stop = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+
+    // the calling thread is one of the nb_threads: it parses whatever the others did not take yet
+    if (nb_threads > job.nb_chunks) nb_threads = job.nb_chunks;
+    pthread_t* threads = NULL;
+    size_t started = 0;
+    if (nb_threads > 1) {
+        threads = calloc(nb_threads - 1, sizeof(pthread_t));
+        for (; threads != NULL && started < nb_threads - 1; ++started) {
+            if (pthread_create(&threads[started], NULL, parse_worker, &job) != 0) break;
+        }
+    }
+
+    const int error_code = chunks_consume(&job, consume, data, line);
+
+    pthread_mutex_lock(&job.lock);
+    job.stop = 1;
+    pthread_cond_broadcast(&job.changed);
+    pthread_mutex_unlock(&job.lock);
+    for (size_t t = 0; t < started; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+
+    for (size_t i = 0; i < job.nb_chunks; ++i) {
+        program_free(&job.chunks[i].commands);
+    }
+    free(job.chunks);
+    pthread_cond_destroy(&job.changed);
+    pthread_mutex_destroy(&job.lock);
+
+    return error_code;
+}
+
+//=========================================================================
+// Maps a whole file and parses it with parse_mapped(); an empty file has no command.
+// A chunk_size of 0 is chosen from the size of the file.
+static int parse_file(const char* filename, size_t nb_threads, size_t chunk_size, size_t window,
+                      program_consumer_t consume, void* data, size_t* line)
+{
+    const int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        M_EXIT(ERR_IO, "cannot open %s", filename);
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return ERR_NONE;
+    }
+
+    const size_t size = (size_t) st.st_size;
+    const char* const begin = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    M_REQUIRE(begin != MAP_FAILED, ERR_IO, "cannot map %s", filename);
+    (void) madvise((void*) begin, size, MADV_WILLNEED);
+
+    if (nb_threads == 0) nb_threads = default_nb_threads();
+    if (chunk_size == 0) {
+        chunk_size = size / (nb_threads * PARSE_CHUNKS_PER_THREAD) + 1;
+        if (chunk_size < PARSE_MIN_CHUNK) chunk_size = PARSE_MIN_CHUNK;
+    }
+    const int error_code = parse_mapped(begin, begin + size, nb_threads, chunk_size, window,
+                                        consume, data, line);
+    munmap((void*) begin, size);
+    return error_code;
+}
+
+//=========================================================================
+// consume() of program_read_parallel(): appends the commands to the program
+static int program_append(void* data, const program_t* commands)
+{
+    program_t* program = data;
+    if (program->nb_lines + commands->nb_lines > program->allocated) {
+        const size_t wanted = program->nb_lines + commands->nb_lines;
+        command_t* const bigger = realloc(program->listing, wanted * sizeof(command_t));
+        M_EXIT_IF_NULL(bigger, wanted * sizeof(command_t));
+        program->listing = bigger;
+        program->allocated = wanted;
+    }
+    memcpy(program->listing + program->nb_lines, commands->listing, commands->nb_lines * sizeof(command_t));
+    program->nb_lines += commands->nb_lines;
+    return ERR_NONE;
+}
+
+//=========================================================================
+int program_read_parallel(const char* filename, program_t* program,
+                          size_t nb_threads, size_t chunk_size, size_t* line)
+{
+    M_REQUIRE_NON_NULL(filename);
+    M_REQUIRE_NON_NULL(program);
+
+    size_t read_lines = 0;
+    if (line == NULL) line = &read_lines;
+    *line = 0;
+
+    M_EXIT_IF_ERR(program_init(program), "initializing program");
+
+    // the whole program is kept: chunks may be parsed as far ahead as possible
+    int error_code = parse_file(filename, nb_threads, chunk_size, SIZE_MAX, program_append, program, line);
+    if (error_code == ERR_NONE) {
+        error_code = program_shrink(program);
+    }
+    if (error_code != ERR_NONE) {
+        program_free(program);
+    }
+    M_EXIT_IF(error_code != ERR_NONE, error_code, "line %zu", *line);
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+int program_parse_parallel(const char* filename, size_t nb_threads, size_t chunk_size,
+                           program_consumer_t consume, void* data, size_t* line)
+{
+    M_REQUIRE_NON_NULL(filename);
+    M_REQUIRE_NON_NULL(consume);
+
+    size_t read_lines = 0;
+    if (line == NULL) line = &read_lines;
+    *line = 0;
+
+    if (nb_threads == 0) nb_threads = default_nb_threads();
+    if (chunk_size == 0) chunk_size = PARSE_MIN_CHUNK;
+    const int error_code = parse_file(filename, nb_threads, chunk_size, PARSE_WINDOW_PER_THREAD * nb_threads,
+                                      consume, data, line);
+    M_EXIT_IF(error_code != ERR_NONE, error_code, "line %zu", *line);
+
+    return ERR_NONE;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+ * @file parse_mng.h
+ * @brief Parallel loading of text command files: the file is split in chunks
+ *        at newline boundaries, which are parsed on a pool of threads.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "commands.h"
+
+// smallest chunk handed to a thread, and number of chunks per thread (for load balancing)
+#define PARSE_MIN_CHUNK ((size_t) 1 << 20)
+#define PARSE_CHUNKS_PER_THREAD 4
+// chunks parsed ahead of their consumer, per thread, by program_parse_parallel()
+#define PARSE_WINDOW_PER_THREAD 2
+
+/**
+ * @brief Called with the commands of each chunk, in the order of the file.
+ * @return error code; anything but ERR_NONE stops the parsing
+ */
+typedef int (*program_consumer_t)(void* data, const program_t* commands);
+
+//=========================================================================
+/**
+ * @brief Read a program (list of commands) from a text file, parsing it with
+ *        several threads. The result is the same as with program_read().
+ * @param filename the name of the file to read from
+ * @param program (modified) the program to be filled from file
+ * @param nb_threads the number of parsing threads (0 for one per online processor)
+ * @param chunk_size the size in bytes of the chunks (0 for an automatic size)
+ * @param line (modified) on error, the (absolute) number of the faulty line;
+ *        otherwise the number of lines read. May be NULL.
+ * @return error code
+ */
+int program_read_parallel(const char* filename, program_t* program,
+                          size_t nb_threads, size_t chunk_size, size_t* line);
+
+//=========================================================================
+/**
+ * @brief Parse a text command file with several threads and hand its commands
+ *        to consume(), chunk by chunk, in the order of the file, on the calling
+ *        thread: the commands of a chunk can be used while the next ones are
+ *        parsed. At most PARSE_WINDOW_PER_THREAD chunks per thread are parsed
+ *        ahead of consume(), so that memory use does not depend on the size of
+ *        the file. On a faulty line, the commands before it are consumed first.
+ * @param filename the name of the file to read from
+ * @param nb_threads the number of parsing threads, the calling one included
+ *        (0 for one per online processor)
+ * @param chunk_size the size in bytes of the chunks (0 for PARSE_MIN_CHUNK)
+ * @param consume called with the commands of each chunk
+ * @param data passed back to consume()
+ * @param line (modified) number of lines read and consumed; on a parse error,
+ *        that of the faulty line. May be NULL.
+ * @return error code, of consume() if it failed
+ */
+int program_parse_parallel(const char* filename, size_t nb_threads, size_t chunk_size,
+                           program_consumer_t consume, void* data, size_t* line);
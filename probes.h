@@ -0,0 +1,43 @@
+#pragma once
+
+/**
+ * @file probes.h
+ * @brief definitions associated to probes: what observes the accesses to a
+ *        cache or TLB hierarchy (statistics, heatmap, miss classifier and
+ *        hook tables)
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "stats.h"
+#include "hooks.h"
+
+/**
+ * Probes belong to a hierarchy, not to the process: a simulation owns the
+ * probes of its caches and of its TLBs (see sim_t), so that several
+ * simulations can run in the same process, each observed on its own.
+ *
+ * Every member may be NULL (not observed); up to HOOKS_MAX hook tables can be
+ * attached at once, and are called in the order they were attached. Zeroed
+ * probes observe nothing.
+ */
+
+#define HOOKS_MAX 4 // hook tables attached at once to a hierarchy
+
+struct miss_classifier; // see miss_class.h
+
+typedef struct cache_probes {
+    cache_stats_t* stats;                   // see cache_stats_attach()
+    cache_heatmap_t* heatmap;               // see cache_heatmap_attach()
+    struct miss_classifier* classifier;     // see cache_classifier_attach()
+    const cache_hooks_t* hooks[HOOKS_MAX];  // see cache_hooks_attach()
+    unsigned nb_hooks;
+} cache_probes_t;
+
+typedef struct tlb_probes {
+    tlb_stats_t* stats;                     // see tlb_stats_attach()
+    tlb_heatmap_t* heatmap;                 // see tlb_heatmap_attach()
+    const tlb_hooks_t* hooks[HOOKS_MAX];    // see tlb_hooks_attach()
+    unsigned nb_hooks;
+} tlb_probes_t;
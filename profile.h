@@ -0,0 +1,81 @@
+#pragma once
+
+/**
+ * @file profile.h
+ * @brief definitions associated to the built-in profiler of the emulator
+ *        hot path: call counts, time and latency histogram of page_walk(),
+ *        tlb_search(), cache_hit(), cache_read() and cache_write()
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include <stdint.h>
+
+/**
+ * Only compiled in with -DPROFILE ("make PROFILE=1", after a "make clean"):
+ * otherwise PROFILE_START() and PROFILE_STOP() expand to nothing.
+ *
+ * Times are read from the time-stamp counter on x86 (PROFILE_UNIT "cycles"),
+ * from clock_gettime() elsewhere ("ns"); they are inclusive (e.g. the time of
+ * tlb_search() includes the one of its page_walk()) and include the overhead
+ * of reading the counter, a few tens of cycles.
+ *
+ * Bucket k of the histogram counts the calls that took [2^(k-1), 2^k) units
+ * (bucket 0: less than 1 unit; the last bucket: anything longer).
+ */
+
+enum profile_point {
+    PROFILE_PAGE_WALK,
+    PROFILE_TLB_SEARCH,
+    PROFILE_CACHE_HIT,
+    PROFILE_CACHE_READ,
+    PROFILE_CACHE_WRITE,    // cache_write() and cache_write_byte()
+    PROFILE_POINTS          // not a point, but their number
+};
+typedef enum profile_point profile_point_t;
+
+#define PROFILE_BUCKETS 32
+
+typedef struct profile_counters {
+    uint64_t calls;
+    uint64_t total;                         // in PROFILE_UNIT
+    uint64_t histogram[PROFILE_BUCKETS];
+} profile_counters_t;
+
+#ifdef PROFILE
+
+extern profile_counters_t profile_counters[PROFILE_POINTS];
+
+#if defined __x86_64__ || defined __i386__
+#include <x86intrin.h> // for __rdtsc()
+#define PROFILE_UNIT "cycles"
+#define profile_now() ((uint64_t) __rdtsc())
+#else
+uint64_t profile_clock_ns(void);
+#define PROFILE_UNIT "ns"
+#define profile_now() profile_clock_ns()
+#endif
+
+static inline void profile_record(profile_point_t point, uint64_t elapsed)
+{
+    profile_counters_t* counters = &profile_counters[point];
+    int bucket = elapsed == 0 ? 0 : 64 - __builtin_clzll(elapsed);
+    if (bucket >= PROFILE_BUCKETS) bucket = PROFILE_BUCKETS - 1;
+    ++counters->calls;
+    counters->total += elapsed;
+    ++counters->histogram[bucket];
+}
+
+// starts timing: declares VAR, the start time
+#define PROFILE_START(VAR) const uint64_t VAR = profile_now()
+// stops timing, and records the time from VAR to POINT
+#define PROFILE_STOP(POINT, VAR) profile_record(POINT, profile_now() - (VAR))
+
+#else
+
+#define PROFILE_UNIT ""
+#define PROFILE_START(VAR) do { } while (0)
+#define PROFILE_STOP(POINT, VAR) do { } while (0)
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * @file profile_mng.c
+ * @brief built-in profiler of the emulator hot path
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for clock_gettime()
+
+#include "profile_mng.h"
+#include "error.h"
+
+#include <inttypes.h> // for PRIu64
+#include <time.h>     // for clock_gettime()
+
+#ifdef PROFILE
+
+profile_counters_t profile_counters[PROFILE_POINTS];
+
+static const char* const POINT_NAMES[PROFILE_POINTS] = {
+    "page_walk", "tlb_search", "cache_hit", "cache_read", "cache_write"
+};
+
+#if !(defined __x86_64__ || defined __i386__)
+uint64_t profile_clock_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+#endif
+
+#endif
+
+//=========================================================================
+int profile_print(FILE* output)
+{
+    M_REQUIRE_NON_NULL(output);
+
+#ifdef PROFILE
+    fprintf(output, "%-12s %12s %16s %12s   (times in " PROFILE_UNIT ")\n",
+            "function", "calls", "total", "mean");
+    for (int point = 0; point < PROFILE_POINTS; ++point) {
+        const profile_counters_t* c = &profile_counters[point];
+        if (c->calls == 0) continue;
+        fprintf(output, "%-12s %12" PRIu64 " %16" PRIu64 " %12.1f\n", POINT_NAMES[point],
+                c->calls, c->total, (double) c->total / (double) c->calls);
+        for (int bucket = 0; bucket < PROFILE_BUCKETS; ++bucket) {
+            if (c->histogram[bucket] == 0) continue;
+            const uint64_t low = bucket == 0 ? 0 : UINT64_C(1) << (bucket - 1);
+            if (bucket < PROFILE_BUCKETS - 1) {
+                fprintf(output, "    [%10" PRIu64 ", %10" PRIu64 ")", low, UINT64_C(1) << bucket);
+            } else {
+                fprintf(output, "    [%10" PRIu64 ",   infinity)", low);
+            }
+            fprintf(output, " %12" PRIu64 " (%5.2f%%)\n", c->histogram[bucket],
+                    100.0 * (double) c->histogram[bucket] / (double) c->calls);
+        }
+    }
+#endif
+    return ERR_NONE;
+}
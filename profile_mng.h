@@ -0,0 +1,23 @@
+#pragma once
+
+/**
+ * @file profile_mng.h
+ * @brief built-in profiler of the emulator hot path
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "profile.h"
+
+#include <stdio.h> // for FILE
+
+//=========================================================================
+/**
+ * @brief Print, for every profiled function called at least once, its number
+ *        of calls, total and mean time, and its non-empty histogram buckets.
+ *        Prints nothing unless compiled with -DPROFILE.
+ * @param output the stream to print to
+ * @return error code
+ */
+int profile_print(FILE* output);
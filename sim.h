@@ -0,0 +1,63 @@
+#pragma once
+
+/**
+ * @file sim.h
+ * @brief definitions associated to a full-system simulation:
+ *        two-level TLB hierarchy in front of a two-level cache hierarchy
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "addr.h"
+#include "tlb_hrchy.h"
+#include "cache.h"
+#include "stats.h"
+#include "probes.h"
+#include "interval.h"
+#include "event_trace.h"
+#include "live.h"
+
+#include <stdint.h>
+#include <stddef.h> // for size_t
+
+/**
+ * Every command goes through the TLB hierarchy first (a page walk is only
+ * done on a TLB miss), then through the cache hierarchy with the obtained
+ * physical address.
+ */
+
+typedef struct sim_stats {
+    uint64_t accesses;      // commands executed
+    uint64_t instr_reads;   // R I
+    uint64_t data_reads;    // R DW, R DB
+    uint64_t data_writes;   // W DW, W DB
+    uint64_t tlb_hits;
+    uint64_t tlb_misses;    // = number of page walks
+    double elapsed;         // seconds spent executing commands
+} sim_stats_t;
+
+typedef struct sim {
+    void* mem_space;
+    size_t mem_size;
+
+    l1_itlb_entry_t l1_itlb[L1_ITLB_LINES];
+    l1_dtlb_entry_t l1_dtlb[L1_DTLB_LINES];
+    l2_tlb_entry_t l2_tlb[L2_TLB_LINES];
+
+    // allocated by sim_init() (see cache_alloc())
+    cache_desc_t l1_icache;
+    cache_desc_t l1_dcache;
+    cache_desc_t l2_cache;
+
+    sim_stats_t stats;
+    cache_stats_t cache_stats;
+    tlb_stats_t tlb_stats;
+    // what observes the accesses of this simulation only; the statistics
+    // above are attached by sim_init() (see cache_probes_attach())
+    cache_probes_t cache_probes;
+    tlb_probes_t tlb_probes;
+    interval_t* interval;   // interval statistics, if any (NULL after sim_init())
+    event_trace_t* events;  // sampled event trace, if any (NULL after sim_init())
+    live_t* live;           // live statistics, if any (NULL after sim_init())
+} sim_t;
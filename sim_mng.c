@@ -0,0 +1,383 @@
+/**
+ * @file sim_mng.c
+ * @brief full-system simulation functions (TLB hierarchy + cache hierarchy)
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for clock_gettime()
+
+#include "sim_mng.h"
+#include "tlb_hrchy_mng.h"
+#include "cache_mng.h"
+#include "trace_mng.h"
+#include "parse_mng.h"
+#include "interval_mng.h"
+#include "event_trace_mng.h"
+#include "live_mng.h"
+#include "error.h"
+#include "util.h"
+
+#include <inttypes.h> // for PRIu64
+#include <stdlib.h>   // for calloc(), free()
+#include <time.h>     // for clock_gettime()
+
+//=========================================================================
+int sim_init(sim_t* sim, void* mem_space, size_t mem_size, const cache_geometry_t geometry[CACHE_LEVELS])
+{
+    M_REQUIRE_NON_NULL(sim);
+    M_REQUIRE_NON_NULL(mem_space);
+    cache_geometry_t defaults[CACHE_LEVELS];
+    if (geometry == NULL) {
+        for (int level = 0; level < CACHE_LEVELS; ++level) {
+            defaults[level] = *cache_default_geometry(level);
+        }
+        geometry = defaults;
+    }
+    M_EXIT_IF_ERR(cache_hierarchy_check(geometry), "checking the cache geometries");
+
+    zero_init_ptr(sim);
+    sim->mem_space = mem_space;
+    sim->mem_size = mem_size;
+
+    M_EXIT_IF_ERR(tlb_flush(sim->l1_itlb, L1_ITLB), "flushing L1 ITLB");
+    M_EXIT_IF_ERR(tlb_flush(sim->l1_dtlb, L1_DTLB), "flushing L1 DTLB");
+    M_EXIT_IF_ERR(tlb_flush(sim->l2_tlb, L2_TLB), "flushing L2 TLB");
+
+    // allocated flushed
+    int err = cache_alloc(&sim->l1_icache, &geometry[L1_ICACHE]);
+    if (err == ERR_NONE) err = cache_alloc(&sim->l1_dcache, &geometry[L1_DCACHE]);
+    if (err == ERR_NONE) err = cache_alloc(&sim->l2_cache, &geometry[L2_CACHE]);
+    if (err != ERR_NONE) {
+        (void)sim_free(sim);
+        M_EXIT(err, "%s", "cannot allocate the caches");
+    }
+
+    M_EXIT_IF_ERR(cache_stats_attach(&sim->cache_probes, &sim->cache_stats), "attaching cache statistics");
+    M_EXIT_IF_ERR(tlb_stats_attach(&sim->tlb_probes, &sim->tlb_stats), "attaching TLB statistics");
+    M_EXIT_IF_ERR(cache_probes_attach(&sim->l1_icache, &sim->cache_probes), "observing L1 ICACHE");
+    M_EXIT_IF_ERR(cache_probes_attach(&sim->l1_dcache, &sim->cache_probes), "observing L1 DCACHE");
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+int sim_free(sim_t* sim)
+{
+    M_REQUIRE_NON_NULL(sim);
+
+    (void)cache_free(&sim->l1_icache);
+    (void)cache_free(&sim->l1_dcache);
+    (void)cache_free(&sim->l2_cache);
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Translates then reads or writes, observed by the probes of the simulation
+static int sim_access(sim_t* sim, const virt_addr_t* vaddr, command_word_t order, mem_access_t type,
+                      size_t data_size, word_t write_data, uint32_t* paddr32)
+{
+    phy_addr_t paddr;
+    int hit = 0;
+    M_EXIT_IF_ERR(tlb_search_probed(sim->mem_space, vaddr, &paddr, type,
+                                    sim->l1_itlb, sim->l1_dtlb, sim->l2_tlb, &hit, &sim->tlb_probes),
+                  "calling tlb_search()");
+    if (hit) {
+        ++sim->stats.tlb_hits;
+    } else {
+        ++sim->stats.tlb_misses;
+    }
+
+    *paddr32 = ((uint32_t) paddr.phy_page_num << PAGE_OFFSET) | paddr.page_offset;
+    M_REQUIRE(*paddr32 + data_size <= sim->mem_size, ERR_ADDR,
+              "physical address 0x%08" PRIX32 " is out of memory", *paddr32);
+
+    if (order == READ) {
+        cache_desc_t* l1_cache = (type == INSTRUCTION) ? &sim->l1_icache : &sim->l1_dcache;
+        if (data_size == sizeof(word_t)) {
+            word_t word = 0;
+            M_EXIT_IF_ERR(cache_read(sim->mem_space, &paddr, type, l1_cache,
+                                     &sim->l2_cache, &word, LRU),
+                          "calling cache_read()");
+        } else {
+            byte_t byte = 0;
+            M_EXIT_IF_ERR(cache_read_byte(sim->mem_space, &paddr, type, l1_cache,
+                                          &sim->l2_cache, &byte, LRU),
+                          "calling cache_read_byte()");
+        }
+        if (type == INSTRUCTION) {
+            ++sim->stats.instr_reads;
+        } else {
+            ++sim->stats.data_reads;
+        }
+    } else {
+        if (data_size == sizeof(word_t)) {
+            M_EXIT_IF_ERR(cache_write(sim->mem_space, &paddr, &sim->l1_dcache,
+                                      &sim->l2_cache, &write_data, LRU),
+                          "calling cache_write()");
+        } else {
+            M_EXIT_IF_ERR(cache_write_byte(sim->mem_space, &paddr, &sim->l1_dcache,
+                                           &sim->l2_cache, (byte_t) write_data, LRU),
+                          "calling cache_write_byte()");
+        }
+        ++sim->stats.data_writes;
+    }
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Attaches the hooks of the event trace to the probes of the simulation
+static int trace_hooks_attach(sim_t* sim)
+{
+    M_EXIT_IF_ERR(cache_hooks_attach(&sim->cache_probes, &sim->events->cache_hooks), "tracing the caches");
+    const int err = tlb_hooks_attach(&sim->tlb_probes, &sim->events->tlb_hooks);
+    if (err != ERR_NONE) {
+        (void)cache_hooks_detach(&sim->cache_probes, &sim->events->cache_hooks);
+        M_EXIT(err, "%s", "tracing the TLBs");
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Executes one access, whatever the representation of its command
+static int sim_execute(sim_t* sim, const virt_addr_t* vaddr, command_word_t order, mem_access_t type,
+                       size_t data_size, word_t write_data)
+{
+    // the hooks of the trace only see its sampled accesses, failed or not
+    const int traced = sim->events != NULL && event_trace_due(sim->events, sim->stats.accesses);
+    if (traced) {
+        event_trace_begin(sim->events, sim->stats.accesses, order, type);
+        M_EXIT_IF_ERR(trace_hooks_attach(sim), "tracing the access");
+    }
+    uint32_t paddr32 = 0;
+    const int err = sim_access(sim, vaddr, order, type, data_size, write_data, &paddr32);
+    if (traced) {
+        (void)cache_hooks_detach(&sim->cache_probes, &sim->events->cache_hooks);
+        (void)tlb_hooks_detach(&sim->tlb_probes, &sim->events->tlb_hooks);
+        if (err == ERR_NONE) event_trace_end(sim->events, paddr32);
+    }
+    if (err != ERR_NONE) return err;
+
+    ++sim->stats.accesses;
+    if (sim->interval != NULL && interval_due(sim->interval, sim->stats.accesses)) {
+        M_EXIT_IF_ERR(interval_sample(sim->interval, sim->stats.accesses,
+                                      &sim->cache_stats, &sim->tlb_stats),
+                      "sampling interval statistics");
+    }
+    if (sim->live != NULL && live_due(sim->live, sim->stats.accesses)) {
+        M_EXIT_IF_ERR(live_publish(sim->live, sim), "publishing live statistics");
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+int sim_execute_command(sim_t* sim, const command_t* command)
+{
+    M_REQUIRE_NON_NULL(sim);
+    M_REQUIRE_NON_NULL(command);
+
+    return sim_execute(sim, &command->vaddr, command->order, command->type,
+                       command->data_size, command->write_data);
+}
+
+//=========================================================================
+int sim_execute_packed(sim_t* sim, const packed_command_t* packed)
+{
+    M_REQUIRE_NON_NULL(sim);
+    M_REQUIRE_NON_NULL(packed);
+
+    virt_addr_t vaddr;
+    M_EXIT_IF_ERR(init_virt_addr64(&vaddr, packed_vaddr64(packed)), "converting virtual address");
+    return sim_execute(sim, &vaddr, packed_order(packed), packed_type(packed),
+                       packed_data_size(packed), packed_write_data(packed));
+}
+
+//=========================================================================
+// Returns the current time in seconds, from an arbitrary (but fixed) origin
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec + (double) t.tv_nsec * 1e-9;
+}
+
+int sim_run_program(sim_t* sim, const program_t* program, size_t* nb_done)
+{
+    M_REQUIRE_NON_NULL(sim);
+    M_REQUIRE_NON_NULL(program);
+
+    int err = ERR_NONE;
+    size_t done = 0;
+    const double start = now();
+    for_all_lines(line, program) {
+        err = sim_execute_command(sim, line);
+        if (err != ERR_NONE) break;
+        ++done;
+    }
+    sim->stats.elapsed += now() - start;
+
+    if (nb_done != NULL) *nb_done = done;
+    return err;
+}
+
+//=========================================================================
+int sim_run_packed(sim_t* sim, const packed_program_t* program, size_t* nb_done)
+{
+    M_REQUIRE_NON_NULL(sim);
+    M_REQUIRE_NON_NULL(program);
+
+    int err = ERR_NONE;
+    size_t done = 0;
+    const double start = now();
+    for_all_packed_lines(line, program) {
+        err = sim_execute_packed(sim, line);
+        if (err != ERR_NONE) break;
+        ++done;
+    }
+    sim->stats.elapsed += now() - start;
+
+    if (nb_done != NULL) *nb_done = done;
+    return err;
+}
+
+//=========================================================================
+int sim_run_records(sim_t* sim, const trace_record_t* records, size_t nb_records, size_t* nb_done)
+{
+    M_REQUIRE_NON_NULL(sim);
+    M_REQUIRE(records != NULL || nb_records == 0, ERR_BAD_PARAMETER, "%s", "records is NULL");
+
+    int err = ERR_NONE;
+    size_t done = 0;
+    const double start = now();
+    for (const trace_record_t* record = records; record < records + nb_records; ++record) {
+        err = packed_command_check(record);
+        if (err == ERR_NONE) err = sim_execute_packed(sim, record);
+        if (err != ERR_NONE) break;
+        ++done;
+    }
+    sim->stats.elapsed += now() - start;
+
+    if (nb_done != NULL) *nb_done = done;
+    return err;
+}
+
+//=========================================================================
+int sim_run_file(sim_t* sim, const char* filename, size_t* nb_done, size_t* nb_read)
+{
+    M_REQUIRE_NON_NULL(sim);
+    M_REQUIRE_NON_NULL(filename);
+
+    packed_program_t batch;
+    M_EXIT_IF_ERR(packed_program_init(&batch), "initializing batch");
+
+    trace_t trace;
+    int err = trace_open(filename, &trace);
+    size_t done = 0;
+    size_t read = 0;
+    // mapped binary trace: records are executed in place
+    const int mapped = (err == ERR_NONE && trace.records != NULL);
+    if (mapped) {
+        read = (size_t) trace.nb_records;
+        err = sim_run_records(sim, trace.records, trace.nb_records, &done);
+    }
+    while (err == ERR_NONE && !mapped) {
+        // on a faulty command, the batch holds the commands before it: they are run first
+        const int read_err = trace_next_packed(&trace, &batch, SIM_BATCH_LINES);
+        read += batch.nb_lines;
+        if (batch.nb_lines > 0) {
+            size_t batch_done = 0;
+            err = sim_run_packed(sim, &batch, &batch_done);
+            done += batch_done;
+        }
+        if (err == ERR_NONE) err = read_err;
+        if (batch.nb_lines == 0) break;
+    }
+    trace_close(&trace);
+    packed_program_free(&batch);
+
+    if (nb_done != NULL) *nb_done = done;
+    if (nb_read != NULL) *nb_read = read;
+    return err;
+}
+
+//=========================================================================
+// What sim_run_chunk() needs and counts
+typedef struct {
+    sim_t* sim;
+    size_t done;
+    size_t read;
+} sim_chunk_run_t;
+
+// consume() of sim_run_file_parallel(): executes the commands of a chunk
+static int sim_run_chunk(void* data, const program_t* commands)
+{
+    sim_chunk_run_t* run = data;
+    size_t done = 0;
+    run->read += commands->nb_lines;
+    const int err = sim_run_program(run->sim, commands, &done);
+    run->done += done;
+    return err;
+}
+
+int sim_run_file_parallel(sim_t* sim, const char* filename, size_t nb_threads,
+                          size_t* nb_done, size_t* nb_read)
+{
+    M_REQUIRE_NON_NULL(sim);
+    M_REQUIRE_NON_NULL(filename);
+
+    trace_t trace;
+    if (trace_open(filename, &trace) != ERR_NONE
+        || trace.format != TRACE_TEXT || trace.compression != COMPRESSION_NONE) {
+        trace_close(&trace);
+        return sim_run_file(sim, filename, nb_done, nb_read);
+    }
+    trace_close(&trace);
+
+    sim_chunk_run_t run = { sim, 0, 0 };
+    const int err = program_parse_parallel(filename, nb_threads, 0, sim_run_chunk, &run, NULL);
+
+    if (nb_done != NULL) *nb_done = run.done;
+    if (nb_read != NULL) *nb_read = run.read;
+    return err;
+}
+
+//=========================================================================
+// Returns num / den in percent, 0 if den is 0
+static double percent(uint64_t num, uint64_t den)
+{
+    return den == 0 ? 0.0 : 100.0 * (double) num / (double) den;
+}
+
+int sim_print_stats(FILE* output, const sim_t* sim)
+{
+    M_REQUIRE_NON_NULL(output);
+    M_REQUIRE_NON_NULL(sim);
+
+    const sim_stats_t* s = &sim->stats;
+    const uint64_t translations = s->tlb_hits + s->tlb_misses;
+
+    fprintf(output, "accesses:     %" PRIu64 "\n", s->accesses);
+    fprintf(output, "  instr reads: %" PRIu64 "\n", s->instr_reads);
+    fprintf(output, "  data reads:  %" PRIu64 "\n", s->data_reads);
+    fprintf(output, "  data writes: %" PRIu64 "\n", s->data_writes);
+    fprintf(output, "TLB hits:     %" PRIu64 " (%.2f%%)\n", s->tlb_hits, percent(s->tlb_hits, translations));
+    fprintf(output, "TLB misses:   %" PRIu64 " (%.2f%%)\n", s->tlb_misses, percent(s->tlb_misses, translations));
+    fprintf(output, "page walks:   %" PRIu64 "\n", s->tlb_misses);
+
+    const cache_counters_t* l1i = &sim->cache_stats.counters[L1_ICACHE][INSTRUCTION];
+    const cache_counters_t* l1d = &sim->cache_stats.counters[L1_DCACHE][DATA];
+    const cache_counters_t* l2i = &sim->cache_stats.counters[L2_CACHE][INSTRUCTION];
+    const cache_counters_t* l2d = &sim->cache_stats.counters[L2_CACHE][DATA];
+    const uint64_t l2_hits = l2i->hits + l2d->hits;
+    fprintf(output, "L1I hits:     %" PRIu64 " (%.2f%%)\n", l1i->hits, percent(l1i->hits, l1i->hits + l1i->misses));
+    fprintf(output, "L1D hits:     %" PRIu64 " (%.2f%%)\n", l1d->hits, percent(l1d->hits, l1d->hits + l1d->misses));
+    fprintf(output, "L2 hits:      %" PRIu64 " (%.2f%%)\n", l2_hits,
+            percent(l2_hits, l2_hits + l2i->misses + l2d->misses));
+    fprintf(output, "elapsed:      %.6f s\n", s->elapsed);
+    fprintf(output, "throughput:   %.0f accesses/s\n",
+            s->elapsed > 0.0 ? (double) s->accesses / s->elapsed : 0.0);
+
+    return ERR_NONE;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+/**
+ * @file sim_mng.h
+ * @brief full-system simulation functions (TLB hierarchy + cache hierarchy)
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "sim.h"
+#include "commands.h"
+#include "trace.h"
+#include <stdio.h> // for FILE
+
+#define SIM_BATCH_LINES 4096
+
+//=========================================================================
+/**
+ * @brief "Constructor" for sim_t: allocate the caches for the given geometries,
+ *        flush all TLBs and caches and reset statistics.
+ *
+ * The per-level cache and TLB statistics of the simulation are attached to the
+ * cache and TLB hierarchies (see cache_stats_attach() and tlb_stats_attach()):
+ * one simulation is run at a time.
+ * The memory space is not copied: it has to outlive the simulation.
+ * @param sim (modified) the simulation to be initialized
+ * @param mem_space starting address of the memory space
+ * @param mem_size size of the memory space (in bytes)
+ * @param geometry the cache geometries, indexed by cache_t (see
+ *        cache_hierarchy_check()), NULL for the default ones of cache.h
+ * @return error code
+ */
+int sim_init(sim_t* sim, void* mem_space, size_t mem_size, const cache_geometry_t geometry[CACHE_LEVELS]);
+
+//=========================================================================
+/**
+ * @brief "Destructor" for sim_t: free the caches (not the memory space).
+ * @param sim the simulation to be freed
+ * @return error code
+ */
+int sim_free(sim_t* sim);
+
+//=========================================================================
+/**
+ * @brief Execute one command: address translation through the TLB hierarchy
+ *        (page walk on miss only), then access through the cache hierarchy.
+ *
+ * @param sim the simulation to run the command on
+ * @param command the command to be executed
+ * @return error code
+ */
+int sim_execute_command(sim_t* sim, const command_t* command);
+
+//=========================================================================
+/**
+ * @brief Same as sim_execute_command(), for a packed command.
+ *        The command must have been checked (see packed_command_check()).
+ *
+ * @param sim the simulation to run the command on
+ * @param packed the command to be executed
+ * @return error code
+ */
+int sim_execute_packed(sim_t* sim, const packed_command_t* packed);
+
+//=========================================================================
+/**
+ * @brief Execute all the commands of a program, in order.
+ *        Stops at the first failing command.
+ *
+ * @param sim the simulation to run the program on
+ * @param program the program to be executed
+ * @param nb_done (modified) number of commands successfully executed; may be NULL
+ * @return error code
+ */
+int sim_run_program(sim_t* sim, const program_t* program, size_t* nb_done);
+
+//=========================================================================
+/**
+ * @brief Same as sim_run_program(), for a packed program.
+ *
+ * @param sim the simulation to run the program on
+ * @param program the packed program to be executed
+ * @param nb_done (modified) number of commands successfully executed; may be NULL
+ * @return error code
+ */
+int sim_run_packed(sim_t* sim, const packed_program_t* program, size_t* nb_done);
+
+//=========================================================================
+/**
+ * @brief Execute binary trace records in place (e.g. from a memory-mapped trace),
+ *        without copying them into a program. Each record is checked before being
+ *        executed. Stops at the first faulty or failing record.
+ *
+ * @param sim the simulation to run the records on
+ * @param records the first record to be executed
+ * @param nb_records the number of records to be executed
+ * @param nb_done (modified) number of records successfully executed; may be NULL
+ * @return error code
+ */
+int sim_run_records(sim_t* sim, const trace_record_t* records, size_t nb_records, size_t* nb_done);
+
+//=========================================================================
+/**
+ * @brief Execute all the commands of a trace file. Text traces are streamed batch
+ *        by batch (SIM_BATCH_LINES commands at a time) and binary traces are executed
+ *        in place from their mapping, so that memory use does not depend on the length
+ *        of the file. Compressed traces are decompressed on the fly and streamed too.
+ *        Stops at the first faulty or failing command; the commands read before a
+ *        faulty one are executed.
+ *
+ * @param sim the simulation to run the file on
+ * @param filename the name of the trace file
+ * @param nb_done (modified) number of commands successfully executed; may be NULL
+ * @param nb_read (modified) number of commands successfully read; may be NULL.
+ *        On error, if nb_read == nb_done, command nb_read + 1 could not be read (or
+ *        the file not be opened); otherwise command nb_done + 1 failed.
+ * @return error code
+ */
+int sim_run_file(sim_t* sim, const char* filename, size_t* nb_done, size_t* nb_read);
+
+//=========================================================================
+/**
+ * @brief Same as sim_run_file(), but an uncompressed text command file is parsed
+ *        by chunks on nb_threads threads (see program_parse_parallel()) while the
+ *        calling thread executes the parsed chunks in order. Other traces are run
+ *        by sim_run_file().
+ *
+ * @param sim the simulation to run the file on
+ * @param filename the name of the trace file
+ * @param nb_threads the number of parsing threads (0 for one per online processor)
+ * @param nb_done (modified) number of commands successfully executed; may be NULL
+ * @param nb_read (modified) number of commands successfully read; may be NULL (see sim_run_file())
+ * @return error code
+ */
+int sim_run_file_parallel(sim_t* sim, const char* filename, size_t nb_threads,
+                          size_t* nb_done, size_t* nb_read);
+
+//=========================================================================
+/**
+ * @brief Print the statistics of a simulation (TLB and cache hit rates, throughput) to a stream.
+ * @param output the stream to print to
+ * @param sim the simulation
+ * @return error code
+ */
+int sim_print_stats(FILE* output, const sim_t* sim);
@@ -0,0 +1,168 @@
+#pragma once
+
+/**
+ * @file stats.h
+ * @brief definitions associated to the statistics counters of the memory hierarchy
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "mem_access.h"
+#include "cache.h"
+#include "tlb_hrchy.h"
+
+#include <stdint.h>
+
+#define CACHE_LEVELS       3 // L1_ICACHE, L1_DCACHE, L2_CACHE
+#define TLB_LEVELS         3 // L1_ITLB, L1_DTLB, L2_TLB
+#define MEM_ACCESS_TYPES   2 // INSTRUCTION, DATA
+#define PAGE_WALK_READS    4 // one entry read per level of page table: PGD, PUD, PMD, PTE
+
+/**
+ * Counters of one cache level, for one type of access (instruction or data).
+ *
+ * reads, writes:  word accesses looked up in this level (a byte write counts as one write);
+ *                 at L2, these are the L1 misses
+ * hits, misses:   outcome of these lookups
+ * cold_fills:     lines inserted in an invalid way
+ * evictions:      lines inserted in place of a valid (least recently used) line
+ * promotions:     (L1 only) lines moved from L2 to this level on an L2 hit
+ * victim_inserts: (L1 only) lines evicted from this level and inserted in L2
+ * compulsory, capacity, conflict:
+ *                 classes of the misses, only counted when a miss classifier is
+ *                 attached (see cache_classifier_attach())
+ */
+typedef struct cache_counters {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t cold_fills;
+    uint64_t evictions;
+    uint64_t promotions;
+    uint64_t victim_inserts;
+    uint64_t compulsory;
+    uint64_t capacity;
+    uint64_t conflict;
+} cache_counters_t;
+
+/**
+ * Counters of the whole cache hierarchy, indexed by level (cache_t)
+ * then by type of access (mem_access_t).
+ * At L1, only [L1_ICACHE][INSTRUCTION] and [L1_DCACHE][DATA] are used.
+ */
+typedef struct cache_stats {
+    cache_counters_t counters[CACHE_LEVELS][MEM_ACCESS_TYPES];
+} cache_stats_t;
+
+/**
+ * Counters of one TLB.
+ *
+ * hits, misses:  outcome of the lookups in this TLB (at L2, these are the L1 misses)
+ * invalidations: (L1 only) valid entries invalidated because the entry inserted in
+ *                the other L1 TLB evicted their translation from L2
+ */
+typedef struct tlb_counters {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+} tlb_counters_t;
+
+/**
+ * Counters of the page walks done on TLB misses, and of the memory reads they make.
+ */
+typedef struct page_walk_counters {
+    uint64_t walks;
+    uint64_t reads;
+} page_walk_counters_t;
+
+/**
+ * Counters of the TLB hierarchy, indexed by TLB (tlb_t).
+ */
+typedef struct tlb_stats {
+    tlb_counters_t counters[TLB_LEVELS];
+    page_walk_counters_t page_walks;
+} tlb_stats_t;
+
+/**
+ * Counters of the single fully-associative TLB (tlb.h).
+ */
+typedef struct tlb_simple_stats {
+    tlb_counters_t tlb;
+    page_walk_counters_t page_walks;
+} tlb_simple_stats_t;
+
+/**
+ * Counters of one set of a cache, or of one line of a direct-mapped TLB.
+ *
+ * accesses:  lookups in this set (at L2 and in the L2 TLB, these are the L1 misses)
+ * misses:    lookups that missed
+ * evictions: valid lines (entries) replaced by another one in this set
+ */
+typedef struct set_counters {
+    uint64_t accesses;
+    uint64_t misses;
+    uint64_t evictions;
+} set_counters_t;
+
+/**
+ * Per-set counters of the cache hierarchy.
+ */
+typedef struct cache_heatmap {
+    set_counters_t l1_icache[CACHE_MAX_SETS];
+    set_counters_t l1_dcache[CACHE_MAX_SETS];
+    set_counters_t l2_cache[CACHE_MAX_SETS];
+    uint32_t nb_sets[CACHE_LEVELS];     // sets in use, indexed by cache_t
+} cache_heatmap_t;
+
+/**
+ * Per-line counters of the (direct-mapped) TLB hierarchy.
+ */
+typedef struct tlb_heatmap {
+    set_counters_t l1_itlb[L1_ITLB_LINES];
+    set_counters_t l1_dtlb[L1_DTLB_LINES];
+    set_counters_t l2_tlb[L2_TLB_LINES];
+} tlb_heatmap_t;
+
+enum stats_format { STATS_CSV, STATS_JSON };
+typedef enum stats_format stats_format_t;
+
+// --------------------------------------------------
+// increments a counter, if statistics are collected (STATS not NULL)
+#define cache_stats_count(STATS, LEVEL, ACCESS, COUNTER) \
+    do { \
+        if ((STATS) != NULL) ++(STATS)->counters[LEVEL][ACCESS].COUNTER; \
+    } while (0)
+
+// --------------------------------------------------
+// counts one page walk, if statistics are collected (WALKS not NULL)
+#define page_walk_count(WALKS) \
+    do { \
+        if ((WALKS) != NULL) { \
+            ++(WALKS)->walks; \
+            (WALKS)->reads += PAGE_WALK_READS; \
+        } \
+    } while (0)
+
+// --------------------------------------------------
+// increments a counter of a set of a cache level, if collected (HEATMAP not NULL)
+#define heatmap_count(HEATMAP, LEVEL, SET, COUNTER) \
+    do { \
+        if ((HEATMAP) != NULL) { \
+            set_counters_t* sets_ = (LEVEL) == L1_ICACHE ? (HEATMAP)->l1_icache \
+                                  : (LEVEL) == L1_DCACHE ? (HEATMAP)->l1_dcache : (HEATMAP)->l2_cache; \
+            ++sets_[SET].COUNTER; \
+        } \
+    } while (0)
+
+// --------------------------------------------------
+// same for a line of a TLB
+#define tlb_heatmap_count(HEATMAP, TLB, LINE, COUNTER) \
+    do { \
+        if ((HEATMAP) != NULL) { \
+            set_counters_t* lines_ = (TLB) == L1_ITLB ? (HEATMAP)->l1_itlb \
+                                   : (TLB) == L1_DTLB ? (HEATMAP)->l1_dtlb : (HEATMAP)->l2_tlb; \
+            ++lines_[LINE].COUNTER; \
+        } \
+    } while (0)
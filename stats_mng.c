@@ -0,0 +1,199 @@
+/**
+ * @file stats_mng.c
+ * @brief statistics of the memory hierarchy: reset and export
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "stats_mng.h"
+#include "error.h"
+#include "util.h"
+
+#include <string.h>   // for strcmp(), memset()
+#include <inttypes.h> // for PRIu64
+
+static const char* const CACHE_LEVEL_NAMES[CACHE_LEVELS] = { "l1i", "l1d", "l2" };
+static const char* const ACCESS_NAMES[MEM_ACCESS_TYPES] = { "instruction", "data" };
+static const char* const TLB_NAMES[TLB_LEVELS] = { "l1_itlb", "l1_dtlb", "l2_tlb" };
+
+// Applies MACRO(FIELD) to every field of a cache_counters_t, in order
+#define FOREACH_CACHE_COUNTER(MACRO) \
+    MACRO(reads) MACRO(writes) MACRO(hits) MACRO(misses) \
+    MACRO(cold_fills) MACRO(evictions) MACRO(promotions) MACRO(victim_inserts) \
+    MACRO(compulsory) MACRO(capacity) MACRO(conflict)
+
+// Same for tlb_counters_t
+#define FOREACH_TLB_COUNTER(MACRO) \
+    MACRO(hits) MACRO(misses) MACRO(invalidations)
+
+//=========================================================================
+int stats_format_parse(const char* name, stats_format_t* format)
+{
+    M_REQUIRE_NON_NULL(name);
+    M_REQUIRE_NON_NULL(format);
+
+    if (!strcmp(name, "csv")) {
+        *format = STATS_CSV;
+    } else if (!strcmp(name, "json")) {
+        *format = STATS_JSON;
+    } else {
+        M_EXIT(ERR_BAD_PARAMETER, "unknown stats format \"%s\"", name);
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+float stats_ratio(uint64_t num, uint64_t den)
+{
+    return den == 0 ? 0.0f : (float) ((double) num / (double) den);
+}
+
+//=========================================================================
+int cache_stats_init(cache_stats_t* stats)
+{
+    M_REQUIRE_NON_NULL(stats);
+    zero_init_ptr(stats);
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Whether a level sees accesses of the given type: L1 caches are split, L2 is unified
+static int cache_level_used(int level, int access)
+{
+    return level == L2_CACHE || (level == L1_ICACHE) == (access == INSTRUCTION);
+}
+
+#define CSV_HEADER(FIELD) ",\"" #FIELD "\""
+#define CSV_VALUE(FIELD)  fprintf(output, ",%" PRIu64, c->FIELD);
+#define JSON_VALUE(FIELD) fprintf(output, "%s\"" #FIELD "\": %" PRIu64, sep, c->FIELD); sep = ", ";
+
+int cache_stats_print(FILE* output, const cache_stats_t* stats, stats_format_t format)
+{
+    M_REQUIRE_NON_NULL(output);
+    M_REQUIRE_NON_NULL(stats);
+    M_REQUIRE(format == STATS_CSV || format == STATS_JSON, ERR_BAD_PARAMETER,
+              "unknown stats format %d", format);
+
+    if (format == STATS_CSV) {
+        fputs("\"level\",\"access\"" FOREACH_CACHE_COUNTER(CSV_HEADER) "\n", output);
+        for (int level = 0; level < CACHE_LEVELS; ++level) {
+            for (int access = 0; access < MEM_ACCESS_TYPES; ++access) {
+                if (!cache_level_used(level, access)) continue;
+                const cache_counters_t* c = &stats->counters[level][access];
+                fprintf(output, "\"%s\",\"%s\"", CACHE_LEVEL_NAMES[level], ACCESS_NAMES[access]);
+                FOREACH_CACHE_COUNTER(CSV_VALUE)
+                putc('\n', output);
+            }
+        }
+    } else {
+        fputs("{\n", output);
+        for (int level = 0; level < CACHE_LEVELS; ++level) {
+            fprintf(output, "  \"%s\": {", CACHE_LEVEL_NAMES[level]);
+            const char* level_sep = "\n";
+            for (int access = 0; access < MEM_ACCESS_TYPES; ++access) {
+                if (!cache_level_used(level, access)) continue;
+                const cache_counters_t* c = &stats->counters[level][access];
+                const char* sep = "";
+                fprintf(output, "%s    \"%s\": { ", level_sep, ACCESS_NAMES[access]);
+                FOREACH_CACHE_COUNTER(JSON_VALUE)
+                fputs(" }", output);
+                level_sep = ",\n";
+            }
+            fprintf(output, "\n  }%s\n", level + 1 < CACHE_LEVELS ? "," : "");
+        }
+        fputs("}\n", output);
+    }
+
+    return ferror(output) ? ERR_IO : ERR_NONE;
+}
+
+//=========================================================================
+int tlb_stats_init(tlb_stats_t* stats)
+{
+    M_REQUIRE_NON_NULL(stats);
+    zero_init_ptr(stats);
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Exports nb_tlbs TLBs, the page walks being those of the last one
+static int tlbs_print(FILE* output, const tlb_counters_t* counters, const char* const* names,
+                      int nb_tlbs, const page_walk_counters_t* walks, stats_format_t format)
+{
+    M_REQUIRE(format == STATS_CSV || format == STATS_JSON, ERR_BAD_PARAMETER,
+              "unknown stats format %d", format);
+
+    if (format == STATS_CSV) {
+        fputs("\"tlb\"" FOREACH_TLB_COUNTER(CSV_HEADER) ",\"page_walks\",\"walk_reads\"\n", output);
+        for (int i = 0; i < nb_tlbs; ++i) {
+            const tlb_counters_t* c = &counters[i];
+            const int last = (i + 1 == nb_tlbs);
+            fprintf(output, "\"%s\"", names[i]);
+            FOREACH_TLB_COUNTER(CSV_VALUE)
+            fprintf(output, ",%" PRIu64 ",%" PRIu64 "\n",
+                    last ? walks->walks : 0, last ? walks->reads : 0);
+        }
+    } else {
+        fputs("{\n", output);
+        for (int i = 0; i < nb_tlbs; ++i) {
+            const tlb_counters_t* c = &counters[i];
+            const char* sep = "";
+            fprintf(output, "  \"%s\": { ", names[i]);
+            FOREACH_TLB_COUNTER(JSON_VALUE)
+            fputs(" },\n", output);
+        }
+        fprintf(output, "  \"page_walks\": { \"walks\": %" PRIu64 ", \"reads\": %" PRIu64 " }\n}\n",
+                walks->walks, walks->reads);
+    }
+
+    return ferror(output) ? ERR_IO : ERR_NONE;
+}
+
+//=========================================================================
+int tlb_stats_print(FILE* output, const tlb_stats_t* stats, stats_format_t format)
+{
+    M_REQUIRE_NON_NULL(output);
+    M_REQUIRE_NON_NULL(stats);
+
+    return tlbs_print(output, stats->counters, TLB_NAMES, TLB_LEVELS, &stats->page_walks, format);
+}
+
+//=========================================================================
+int tlb_simple_stats_print(FILE* output, const tlb_simple_stats_t* stats, stats_format_t format)
+{
+    M_REQUIRE_NON_NULL(output);
+    M_REQUIRE_NON_NULL(stats);
+
+    static const char* const name[1] = { "tlb" };
+    return tlbs_print(output, &stats->tlb, name, 1, &stats->page_walks, format);
+}
+
+//=========================================================================
+// Exports the counters of the nb_sets sets of one structure
+static void sets_print(FILE* output, const char* name, const set_counters_t* sets, size_t nb_sets)
+{
+    for (size_t set = 0; set < nb_sets; ++set) {
+        fprintf(output, "\"%s\"," SIZE_T_FMT ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                name, set, sets[set].accesses, sets[set].misses, sets[set].evictions);
+    }
+}
+
+#define SETS_PRINT(NAME, SETS) sets_print(output, NAME, SETS, sizeof(SETS) / sizeof(SETS[0]))
+
+int heatmap_print(FILE* output, const cache_heatmap_t* cache, const tlb_heatmap_t* tlb)
+{
+    M_REQUIRE_NON_NULL(output);
+    M_REQUIRE_NON_NULL(cache);
+    M_REQUIRE_NON_NULL(tlb);
+
+    fputs("\"structure\",\"set\",\"accesses\",\"misses\",\"evictions\"\n", output);
+    sets_print(output, CACHE_LEVEL_NAMES[L1_ICACHE], cache->l1_icache, cache->nb_sets[L1_ICACHE]);
+    sets_print(output, CACHE_LEVEL_NAMES[L1_DCACHE], cache->l1_dcache, cache->nb_sets[L1_DCACHE]);
+    sets_print(output, CACHE_LEVEL_NAMES[L2_CACHE], cache->l2_cache, cache->nb_sets[L2_CACHE]);
+    SETS_PRINT(TLB_NAMES[L1_ITLB], tlb->l1_itlb);
+    SETS_PRINT(TLB_NAMES[L1_DTLB], tlb->l1_dtlb);
+    SETS_PRINT(TLB_NAMES[L2_TLB], tlb->l2_tlb);
+
+    return ferror(output) ? ERR_IO : ERR_NONE;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+/**
+ * @file stats_mng.h
+ * @brief statistics of the memory hierarchy: reset and export
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "stats.h"
+#include <stdio.h> // for FILE
+#include <stdint.h>
+
+//=========================================================================
+/**
+ * @brief Ratio of two counters, as published by the interval and live statistics.
+ * @param num the numerator
+ * @param den the denominator
+ * @return num / den, 0 if den is 0
+ */
+float stats_ratio(uint64_t num, uint64_t den);
+
+//=========================================================================
+/**
+ * @brief Parse the name of an export format ("csv" or "json").
+ * @param name the name to be parsed
+ * @param format (modified) the corresponding format
+ * @return error code (ERR_BAD_PARAMETER for an unknown name)
+ */
+int stats_format_parse(const char* name, stats_format_t* format);
+
+//=========================================================================
+/**
+ * @brief Reset all the counters of a cache hierarchy.
+ * @param stats (modified) the statistics to be reset
+ * @return error code
+ */
+int cache_stats_init(cache_stats_t* stats);
+
+//=========================================================================
+/**
+ * @brief Export the counters of a cache hierarchy to a stream.
+ *
+ * CSV: a header line, then one line per level and type of access actually used.
+ * JSON: an object with one member per level, each with one member per type of access.
+ *
+ * @param output the stream to print to
+ * @param stats the statistics to be exported
+ * @param format the export format
+ * @return error code
+ */
+int cache_stats_print(FILE* output, const cache_stats_t* stats, stats_format_t format);
+
+//=========================================================================
+/**
+ * @brief Reset all the counters of a TLB hierarchy.
+ * @param stats (modified) the statistics to be reset
+ * @return error code
+ */
+int tlb_stats_init(tlb_stats_t* stats);
+
+//=========================================================================
+/**
+ * @brief Export the counters of a TLB hierarchy to a stream.
+ *
+ * CSV: a header line, then one line per TLB; the page walks (and their memory
+ * reads) are reported on the line of the last-level TLB, the misses of which they serve.
+ * JSON: an object with one member per TLB, plus a "page_walks" member.
+ *
+ * @param output the stream to print to
+ * @param stats the statistics to be exported
+ * @param format the export format
+ * @return error code
+ */
+int tlb_stats_print(FILE* output, const tlb_stats_t* stats, stats_format_t format);
+
+//=========================================================================
+/**
+ * @brief Export the counters of a fully-associative TLB to a stream,
+ *        in the same way as tlb_stats_print() (with a single "tlb").
+ * @param output the stream to print to
+ * @param stats the statistics to be exported
+ * @param format the export format
+ * @return error code
+ */
+int tlb_simple_stats_print(FILE* output, const tlb_simple_stats_t* stats, stats_format_t format);
+
+//=========================================================================
+/**
+ * @brief Export per-set counters of the caches and per-line counters of the TLBs,
+ *        as a CSV matrix: a header line, then one line per set (line) of each
+ *        structure ("l1i", "l1d", "l2", "l1_itlb", "l1_dtlb", "l2_tlb"), in order.
+ * @param output the stream to print to
+ * @param cache the per-set counters of the caches
+ * @param tlb the per-line counters of the TLBs
+ * @return error code
+ */
+int heatmap_print(FILE* output, const cache_heatmap_t* cache, const tlb_heatmap_t* tlb);
@@ -40,15 +40,15 @@ static void error(const char* pgm, const char* msg)
 // ======================================================================
 void execute_command(void *mem_space,
                      const command_t* command,
-                     l1_icache_entry_t *l1_icache,
-                     l1_icache_entry_t *l1_dcache,
-                     l2_cache_entry_t *l2_cache)
+                     cache_desc_t *l1_icache,
+                     cache_desc_t *l1_dcache,
+                     cache_desc_t *l2_cache)
 {
     phy_addr_t paddr;
     assert(page_walk(mem_space, &command->vaddr, &paddr) == ERR_NONE);
     uint8_t byte;
     uint32_t word;
-    void *l1_cache;
+    cache_desc_t *l1_cache;
 
     switch (command->order) {
     case READ:
@@ -101,29 +101,26 @@ int main(int argc, char *argv[])
     program_t pgm;
     if (err == ERR_NONE) {
         if(program_read(argv[3], &pgm) == ERR_NONE) {
-            l1_icache_entry_t l1_icache[L1_ICACHE_LINES * L1_ICACHE_WAYS];
-            l1_icache_entry_t l1_dcache[L1_DCACHE_LINES * L1_DCACHE_WAYS];
-            l2_cache_entry_t l2_cache[L2_CACHE_LINES * L2_CACHE_WAYS];
-            memset(l1_icache, 0, sizeof(l1_icache));
-            memset(l1_dcache, 0, sizeof(l1_dcache));
-            memset(l2_cache,  0, sizeof(l2_cache));
-
-            /* Flush caches before use */
-            assert(cache_flush(l1_icache, L1_ICACHE) == ERR_NONE);
-            assert(cache_flush(l1_dcache, L1_DCACHE) == ERR_NONE);
-            assert(cache_flush(l2_cache, L2_CACHE) == ERR_NONE);
+            /* Caches are allocated flushed */
+            cache_desc_t l1_icache, l1_dcache, l2_cache;
+            assert(cache_alloc(&l1_icache, cache_default_geometry(L1_ICACHE)) == ERR_NONE);
+            assert(cache_alloc(&l1_dcache, cache_default_geometry(L1_DCACHE)) == ERR_NONE);
+            assert(cache_alloc(&l2_cache, cache_default_geometry(L2_CACHE)) == ERR_NONE);
 
             for_all_lines(line, &pgm) {
-                execute_command(mem_space, line, l1_icache, l1_dcache, l2_cache);
+                execute_command(mem_space, line, &l1_icache, &l1_dcache, &l2_cache);
 
                 printf("L1_ICACHE: \n\n");
-                cache_dump(stdout, l1_icache, L1_ICACHE);
+                cache_dump(stdout, &l1_icache);
                 printf("L1_DCACHE: \n\n");
-                cache_dump(stdout, l1_dcache, L1_DCACHE);
+                cache_dump(stdout, &l1_dcache);
                 printf("L2_CACHE: \n\n");
-                cache_dump(stdout, l2_cache, L2_CACHE);
+                cache_dump(stdout, &l2_cache);
                 printf("\n=======================================\n\n");
             }
+            cache_free(&l1_icache);
+            cache_free(&l1_dcache);
+            cache_free(&l2_cache);
         } else {
             error(argv[0], "problem initializing program from provided file.");
             return 3;
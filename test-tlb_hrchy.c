@@ -26,15 +26,15 @@
     do {                                                                         \
         fputc('\n', f_out); fputc('\n', f_out);                                  \
         for (int tlb_line_index = 0; tlb_line_index < (N); tlb_line_index++) {   \
-            if(((TYPE *) (tlb) + tlb_line_index)->v)                             \
+            if(tlb_entry_valid(((TYPE *) (tlb))[tlb_line_index]))                \
                 fprintf(f_out, "%d; %08X; %05X;\n" ,                             \
-                        ((TYPE *) (tlb) + tlb_line_index)->v,                    \
-                        ((TYPE *) (tlb) + tlb_line_index)->tag,                  \
-                        ((TYPE *) (tlb) + tlb_line_index)->phy_page_num          \
+                        tlb_entry_valid(((TYPE *) (tlb))[tlb_line_index]),       \
+                        (unsigned) tlb_entry_tag(((TYPE *) (tlb))[tlb_line_index]), \
+                        tlb_entry_phy_page_num(((TYPE *) (tlb))[tlb_line_index]) \
                 );                                                               \
             else                                                                 \
                 fprintf(f_out, "%d; --------; -----;\n" ,                        \
-                        ((TYPE *) (tlb) + tlb_line_index)->v                     \
+                        tlb_entry_valid(((TYPE *) (tlb))[tlb_line_index])        \
                 );                                                               \
         }} while(0)
 
@@ -94,9 +94,9 @@ int main(int argc, char* argv[])
 
             for (size_t tlb_line_index = 0; tlb_line_index < TLB_LINES; tlb_line_index++) {
                 fprintf(f_out, "%d; %"PRIx64"; %05X;\n",
-                        tlb[tlb_line_index].v,
-                        (uint64_t) tlb[tlb_line_index].tag,
-                        tlb[tlb_line_index].phy_page_num
+                        tlb_entry_valid(tlb[tlb_line_index]),
+                        (uint64_t) tlb_entry_tag(tlb[tlb_line_index]),
+                        tlb_entry_phy_page_num(tlb[tlb_line_index])
                        );
             }
             print_list(f_out, &ll);
@@ -0,0 +1,449 @@
+#!/bin/bash
+
+## Basic tests for the full-system emulator (TLB hierarchy + caches)
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+# ======================================================================
+# tool function
+check_output() {
+
+    checkX "Full-system emulator" "$1"
+
+    ref='tests/files'
+    memfile="${ref}/$3"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="${ref}/$4"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    EXPECTED_OUTPUT="${5}"
+
+    mytmp="$(new_tmp_file)"
+    # timings are not reproducible: only compare the counters
+    ACTUAL_OUTPUT="$("$1" "$2" "$memfile" "$cmdfile" 2>"$mytmp" | grep -v -e '^elapsed' -e '^throughput' || cat "$mytmp")"
+
+    diff -w <(echo "$ACTUAL_OUTPUT") <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$ACTUAL_OUTPUT"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: per-level cache and TLB statistics (-s csv, with extra options)
+check_cache_stats() {
+
+    checkX "Full-system emulator" "$1"
+
+    memfile="tests/files/$3"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="tests/files/$4"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    EXPECTED_OUTPUT="${5}"
+
+    prefix="$(new_tmp_file)"
+    statsfile="$(new_tmp_file)"
+    "$1" $2 -s csv -o "$prefix" dump "$memfile" "$cmdfile" > /dev/null || exit 1
+    cat "$prefix-cache.csv" <(echo) "$prefix-tlb.csv" > "$statsfile"
+    rm -f "$prefix-cache.csv" "$prefix-tlb.csv"
+
+    diff -w "$statsfile" <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$(cat "$statsfile")"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: interval statistics (-i period -I file.csv)
+check_intervals() {
+
+    checkX "Full-system emulator" "$1"
+
+    memfile="tests/files/$3"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="tests/files/$4"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    EXPECTED_OUTPUT="${5}"
+
+    csvfile="$(new_tmp_file).csv"
+    "$1" -i "$2" -I "$csvfile" dump "$memfile" "$cmdfile" > /dev/null || exit 1
+    ACTUAL_OUTPUT="$(cat "$csvfile")"
+    rm -f "$csvfile"
+
+    diff -w <(echo "$ACTUAL_OUTPUT") <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$ACTUAL_OUTPUT"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: per-set counters (-H file), sets never accessed left aside
+check_heatmap() {
+
+    checkX "Full-system emulator" "$1"
+
+    memfile="tests/files/$2"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="tests/files/$3"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    EXPECTED_OUTPUT="${4}"
+
+    csvfile="$(new_tmp_file)"
+    "$1" -H "$csvfile" dump "$memfile" "$cmdfile" > /dev/null || exit 1
+    # 64 + 64 + 512 cache sets, 16 + 16 + 64 TLB lines
+    [ "$(wc -l < "$csvfile")" -eq 737 ] || (echo "FAIL (wrong number of sets)"; exit 1)
+    ACTUAL_OUTPUT="$(grep -v ',0,0,0$' "$csvfile")"
+
+    diff -w <(echo "$ACTUAL_OUTPUT") <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$ACTUAL_OUTPUT"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: event log (-E file), summarized as the number of each event
+check_events() {
+
+    checkX "Full-system emulator" "$1"
+
+    memfile="tests/files/$2"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="tests/files/$3"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    EXPECTED_OUTPUT="${4}"
+
+    csvfile="$(new_tmp_file)"
+    "$1" -E "$csvfile" dump "$memfile" "$cmdfile" > /dev/null || exit 1
+    ACTUAL_OUTPUT="$(tail -n +2 "$csvfile" | cut -d, -f1,2 | sort | uniq -c | awk '{ print $2 "," $1 }')"
+
+    diff -w <(echo "$ACTUAL_OUTPUT") <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$ACTUAL_OUTPUT"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: sampled event trace (-r rate -R file), dumped one record per line
+check_event_trace() {
+
+    checkX "Full-system emulator" "$1"
+
+    memfile="tests/files/$3"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="tests/files/$4"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    EXPECTED_OUTPUT="${5}"
+
+    binfile="$(new_tmp_file)"
+    "$1" -r "$2" -R "$binfile" dump "$memfile" "$cmdfile" > /dev/null || exit 1
+    ACTUAL_OUTPUT="$(od -A n -t x1 -v -w24 "$binfile")"
+
+    diff -w <(echo "$ACTUAL_OUTPUT") <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$ACTUAL_OUTPUT"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: event log and sampled event trace together (-E file -r rate
+# -R file): both must be the same as when written on their own
+check_events_and_trace() {
+
+    checkX "Full-system emulator" "$1"
+
+    memfile="tests/files/$3"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="tests/files/$4"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    csvfile="$(new_tmp_file)"
+    binfile="$(new_tmp_file)"
+    both_csvfile="$(new_tmp_file)"
+    both_binfile="$(new_tmp_file)"
+    "$1" -E "$csvfile" dump "$memfile" "$cmdfile" > /dev/null || exit 1
+    "$1" -r "$2" -R "$binfile" dump "$memfile" "$cmdfile" > /dev/null || exit 1
+    "$1" -E "$both_csvfile" -r "$2" -R "$both_binfile" dump "$memfile" "$cmdfile" > /dev/null || exit 1
+
+    cmp -s "$csvfile" "$both_csvfile" && cmp -s "$binfile" "$both_binfile" \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo "event log or trace differs when written together"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: the event log cannot be created: the emulator exits with
+# status 4, but the event trace already opened is still closed (header written)
+check_early_exit() {
+
+    checkX "Full-system emulator" "$1"
+
+    memfile="tests/files/$2"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="tests/files/$3"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    EXPECTED_OUTPUT="${4}"
+
+    binfile="$(new_tmp_file)"
+    status=0
+    "$1" -r 1 -R "$binfile" -E /nonexistent/events.csv dump "$memfile" "$cmdfile" > /dev/null 2>&1 || status=$?
+    ACTUAL_OUTPUT="$(echo "status: $status"; od -A n -t x1 -v -w24 "$binfile")"
+
+    diff -w <(echo "$ACTUAL_OUTPUT") <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$ACTUAL_OUTPUT"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: live statistics (-L name), read by live-monitor during the
+# run, and a snapshot on SIGUSR1. The emulator is held before its first
+# refresh (every 65536 accesses) by writing interval statistics of every
+# access to a FIFO nobody reads yet: the snapshot is printed at that refresh.
+check_live() {
+
+    checkX "Full-system emulator" "$1"
+    checkX "Live monitor" "$2"
+
+    memfile="tests/files/$3"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="tests/files/$4"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    EXPECTED_OUTPUT="${5}"
+
+    longfile="$(new_tmp_file)"
+    yes "$(cat "$cmdfile")" | head -n 65540 > "$longfile" || true
+    fifo="$(new_tmp_file)"
+    rm -f "$fifo"
+    mkfifo "$fifo"
+    exec 4<> "$fifo"
+    errfile="$(new_tmp_file)"
+    monfile="$(new_tmp_file)"
+    name="i7test$$"
+
+    "$1" -L "$name" -i 1 -I "$fifo" dump "$memfile" "$longfile" > /dev/null 2> "$errfile" &
+    pid=$!
+    for i in $(seq 100); do
+        "$2" "$name" > "$monfile" 2> /dev/null && break
+        sleep 0.1
+    done
+    kill -USR1 $pid
+    cat <&4 > /dev/null &
+    drain=$!
+    status=0
+    wait $pid || status=$?
+    kill $drain
+    exec 4<&-
+    monitor=0
+    "$2" "$name" > /dev/null 2>&1 || monitor=$?
+    ACTUAL_OUTPUT="$(sed -e "s/^pid $pid:/pid:/" -e 's/ in .*//' "$monfile"; \
+                     grep '^--- snapshot' "$errfile" | sed 's/,.*//'; \
+                     echo "status: $status"; echo "monitor after the run: $monitor")"
+
+    diff -w <(echo "$ACTUAL_OUTPUT") <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$ACTUAL_OUTPUT"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: faulty command file: the commands before the faulty line are
+# executed, then the line is reported and the exit status is 3
+check_read_error() {
+
+    checkX "Full-system emulator" "$1"
+
+    memfile="tests/files/$2"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    cmdfile="tests/files/$3"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    EXPECTED_OUTPUT="${4}"
+
+    errfile="$(new_tmp_file)"
+    outfile="$(new_tmp_file)"
+    status=0
+    "$1" dump "$memfile" "$cmdfile" > "$outfile" 2> "$errfile" || status=$?
+    ACTUAL_OUTPUT="$(echo "status: $status"; grep '^ERROR' "$errfile" | sed "s|$cmdfile|FILE|"; grep '^accesses' "$outfile")"
+
+    diff -w <(echo "$ACTUAL_OUTPUT") <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$ACTUAL_OUTPUT"; \
+            exit 1)
+}
+
+# ======================================================================
+printf "Test %1d (emulator 1): " $((++test))
+check_output emulator dump memory-dump-01.mem commands01.txt \
+"accesses:     5
+  instr reads: 1
+  data reads:  2
+  data writes: 2
+TLB hits:     2 (40.00%)
+TLB misses:   3 (60.00%)
+page walks:   3
+L1I hits:     0 (0.00%)
+L1D hits:     1 (25.00%)
+L2 hits:      0 (0.00%)"
+
+printf "Test %1d (hierarchy statistics 1): " $((++test))
+check_cache_stats emulator "" memory-dump-01.mem commands01.txt \
+'"level","access","reads","writes","hits","misses","cold_fills","evictions","promotions","victim_inserts","compulsory","capacity","conflict"
+"l1i","instruction",1,0,0,1,1,0,0,0,0,0,0
+"l1d","data",2,2,1,3,3,0,0,0,0,0,0
+"l2","instruction",1,0,0,1,0,0,0,0,0,0,0
+"l2","data",1,2,0,3,0,0,0,0,0,0,0
+
+"tlb","hits","misses","invalidations","page_walks","walk_reads"
+"l1_itlb",0,1,1,0,0
+"l1_dtlb",2,2,0,0,0
+"l2_tlb",0,3,0,3,12'
+
+printf "Test %1d (miss classification 1): " $((++test))
+check_cache_stats emulator -c memory-dump-01.mem commands01.txt \
+'"level","access","reads","writes","hits","misses","cold_fills","evictions","promotions","victim_inserts","compulsory","capacity","conflict"
+"l1i","instruction",1,0,0,1,1,0,0,0,1,0,0
+"l1d","data",2,2,1,3,3,0,0,0,3,0,0
+"l2","instruction",1,0,0,1,0,0,0,0,1,0,0
+"l2","data",1,2,0,3,0,0,0,0,3,0,0
+
+"tlb","hits","misses","invalidations","page_walks","walk_reads"
+"l1_itlb",0,1,1,0,0
+"l1_dtlb",2,2,0,0,0
+"l2_tlb",0,3,0,3,12'
+
+printf "Test %1d (interval statistics 1): " $((++test))
+check_intervals emulator 2 memory-dump-01.mem commands01.txt \
+'"accesses","l1i_hit_ratio","l1d_hit_ratio","l2_hit_ratio","l1i_mpki","l1d_mpki","l2_mpki","tlb_miss_ratio","l1_tlb_miss_ratio"
+2,0.0000,0.0000,0.0000,500.00,500.00,1000.00,1.0000,1.0000
+4,0.0000,0.5000,0.0000,0.00,500.00,500.00,0.5000,0.5000
+5,0.0000,0.0000,0.0000,0.00,1000.00,1000.00,0.0000,0.0000'
+
+printf "Test %1d (per-set counters 1): " $((++test))
+check_heatmap emulator memory-dump-01.mem commands01.txt \
+'"structure","set","accesses","misses","evictions"
+"l1i",0,1,1,0
+"l1d",0,3,2,0
+"l1d",1,1,1,0
+"l2",0,2,2,0
+"l2",1,1,1,0
+"l2",256,1,1,0
+"l1_itlb",0,1,1,0
+"l1_dtlb",0,4,2,1
+"l2_tlb",0,3,3,2'
+
+printf "Test %1d (cache geometry 1): " $((++test))
+check_cache_stats emulator "-G l1d=1,1,16 -G l2=1,1,16" memory-dump-01.mem commands01.txt \
+'"level","access","reads","writes","hits","misses","cold_fills","evictions","promotions","victim_inserts","compulsory","capacity","conflict"
+"l1i","instruction",1,0,0,1,1,0,0,0,0,0,0
+"l1d","data",2,2,1,3,1,2,0,2,0,0,0
+"l2","instruction",1,0,0,1,0,0,0,0,0,0,0
+"l2","data",1,2,0,3,1,1,0,0,0,0,0
+
+"tlb","hits","misses","invalidations","page_walks","walk_reads"
+"l1_itlb",0,1,1,0,0
+"l1_dtlb",2,2,0,0,0
+"l2_tlb",0,3,0,3,12'
+
+# the promotion of the first line to L1i leaves an invalid way before the second one in L2,
+# which must still hit there
+printf "Test %1d (cache geometry 2): " $((++test))
+check_cache_stats emulator "-G l1d=1,1,16 -G l1i=1,2,16 -G l2=1,16,16" memory-dump-01.mem commands03.txt \
+'"level","access","reads","writes","hits","misses","cold_fills","evictions","promotions","victim_inserts","compulsory","capacity","conflict"
+"l1i","instruction",1,0,0,1,1,0,1,0,0,0,0
+"l1d","data",4,0,0,4,1,3,1,3,0,0,0
+"l2","instruction",1,0,1,0,0,0,0,0,0,0,0
+"l2","data",4,0,1,3,3,0,0,0,0,0,0
+
+"tlb","hits","misses","invalidations","page_walks","walk_reads"
+"l1_itlb",0,1,1,0,0
+"l1_dtlb",0,4,1,0,0
+"l2_tlb",0,5,0,5,20'
+
+printf "Test %1d (event hooks 1): " $((++test))
+check_events emulator memory-dump-01.mem commands01.txt \
+'"evict","l1_dtlb",1
+"evict","l1_itlb",1
+"evict","l2_tlb",2
+"fill","l1_dtlb",2
+"fill","l1_itlb",1
+"fill","l1d",3
+"fill","l1i",1
+"fill","l2_tlb",3
+"hit","l1_dtlb",2
+"hit","l1d",1
+"miss","l1_dtlb",2
+"miss","l1_itlb",1
+"miss","l1d",3
+"miss","l1i",1
+"miss","l2",4
+"miss","l2_tlb",3
+"walk","l2_tlb",3'
+
+printf "Test %1d (event trace 1): " $((++test))
+check_event_trace emulator 2 memory-dump-01.mem commands01.txt \
+'69 37 45 54 01 00 18 00 02 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00
+00 00 00 00 00 00 00 00 00 80 00 00 ff ff ff ff 00 00 02 02 00 00 00 00
+02 00 00 00 00 00 00 00 02 b0 00 00 ff ff ff ff 00 01 00 00 00 00 00 00
+04 00 00 00 00 00 00 00 10 a0 00 00 ff ff ff ff 01 01 00 02 00 00 00 00'
+
+printf "Test %1d (event hooks and trace together): " $((++test))
+check_events_and_trace emulator 2 memory-dump-01.mem commands03.txt
+
+printf "Test %1d (early exit): " $((++test))
+check_early_exit emulator memory-dump-01.mem commands01.txt \
+"status: 4
+69 37 45 54 01 00 18 00 01 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00"
+
+printf "Test %1d (live statistics): " $((++test))
+check_live emulator live-monitor memory-dump-01.mem commands01.txt \
+"pid: 0 accesses
+--- snapshot: 65536 accesses
+status: 0
+monitor after the run: 2"
+
+# three copies of commands01.txt, then a faulty line 16
+printf "Test %1d (faulty command file 1): " $((++test))
+check_read_error emulator memory-dump-01.mem commands04.txt \
+"status: 3
+ERROR: cannot read command 16 of FILE: Bad parameter
+accesses:     15"
+
+# ======================================================================
+echo "SUCCESS"
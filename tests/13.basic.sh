@@ -0,0 +1,174 @@
+#!/bin/bash
+
+## Basic tests for binary traces
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+# ======================================================================
+# tool function: text -> binary -> text shall give back the program
+check_round_trip() {
+
+    checkX "Trace converter" "$1"
+    checkX "Test commands and programs emulation" test-commands
+
+    testfile="tests/files/$2"
+    [ -f "$testfile" ] || error "Expected test file \"$testfile\" not found."
+
+    bintrace="$(new_tmp_file)"
+    txttrace="$(new_tmp_file)"
+    "$1" bin "$testfile" "$bintrace" && "$1" txt "$bintrace" "$txttrace" || exit 1
+
+    diff -w "$txttrace" <(test-commands "$testfile") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: the emulator shall give the same counters on both formats
+check_same_emulation() {
+
+    checkX "Trace converter" "$1"
+    checkX "Full-system emulator" emulator
+
+    memfile="tests/files/$2"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    testfile="tests/files/$3"
+    [ -f "$testfile" ] || error "Expected test file \"$testfile\" not found."
+
+    bintrace="$(new_tmp_file)"
+    "$1" bin "$testfile" "$bintrace" || exit 1
+
+    diff -w <(emulator dump "$memfile" "$bintrace" | grep -v -e '^elapsed' -e '^throughput') \
+            <(emulator dump "$memfile" "$testfile" | grep -v -e '^elapsed' -e '^throughput') \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: parallel parsing (-j) shall give the same binary trace;
+# with a number of lines, on the test file repeated up to that many lines
+# (several chunks, converted one by one)
+check_parallel() {
+
+    checkX "Trace converter" "$1"
+
+    testfile="tests/files/$2"
+    [ -f "$testfile" ] || error "Expected test file \"$testfile\" not found."
+
+    if [ $# -gt 2 ]; then
+        longfile="$(new_tmp_file)"
+        yes "$(cat "$testfile")" | head -n "$3" > "$longfile" || true
+        testfile="$longfile"
+    fi
+
+    seqtrace="$(new_tmp_file)"
+    partrace="$(new_tmp_file)"
+    "$1" bin "$testfile" "$seqtrace" && "$1" -j 4 bin "$testfile" "$partrace" || exit 1
+
+    cmp -s "$seqtrace" "$partrace" \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: gzip-compressed traces (text or binary) shall be read transparently
+check_gzip() {
+
+    checkX "Trace converter" "$1"
+    checkX "Full-system emulator" emulator
+
+    memfile="tests/files/$2"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    testfile="tests/files/$3"
+    [ -f "$testfile" ] || error "Expected test file \"$testfile\" not found."
+
+    bintrace="$(new_tmp_file)"
+    gztext="$(new_tmp_file)"
+    gzbin="$(new_tmp_file)"
+    "$1" bin "$testfile" "$bintrace" || exit 1
+    gzip -c "$testfile" > "$gztext" && gzip -c "$bintrace" > "$gzbin" || exit 1
+
+    expected="$(emulator dump "$memfile" "$testfile" | grep -v -e '^elapsed' -e '^throughput')"
+    diff -w <(emulator dump "$memfile" "$gztext" | grep -v -e '^elapsed' -e '^throughput') <(echo "$expected") \
+        && diff -w <(emulator dump "$memfile" "$gzbin" | grep -v -e '^elapsed' -e '^throughput') <(echo "$expected") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: zstd-compressed traces (text or binary) shall be read transparently
+# when built with ZSTD=1, and be refused with a clear message otherwise
+check_zstd() {
+
+    checkX "Trace converter" "$1"
+    checkX "Full-system emulator" emulator
+
+    if ! command -v zstd > /dev/null; then
+        echo "SKIPPED (no zstd command)"
+        return
+    fi
+
+    memfile="tests/files/$2"
+    [ -f "$memfile" ] || error "Expected mem dump file \"$memfile\" not found."
+
+    testfile="tests/files/$3"
+    [ -f "$testfile" ] || error "Expected test file \"$testfile\" not found."
+
+    bintrace="$(new_tmp_file)"
+    zsttext="$(new_tmp_file)"
+    zstbin="$(new_tmp_file)"
+    errors="$(new_tmp_file)"
+    "$1" bin "$testfile" "$bintrace" || exit 1
+    zstd -q -f -c "$testfile" > "$zsttext" && zstd -q -f -c "$bintrace" > "$zstbin" || exit 1
+
+    status=0
+    emulator dump "$memfile" "$zsttext" > /dev/null 2> "$errors" || status=$?
+    if grep -q "built without zstd" "$errors"; then
+        # no parse error, nothing emulated
+        [ $status -eq 3 ] && ! grep -q "cannot read command" "$errors" \
+            && echo "PASS (built without zstd)" \
+            || (echo "FAIL"; \
+                exit 1)
+        return
+    fi
+
+    expected="$(emulator dump "$memfile" "$testfile" | grep -v -e '^elapsed' -e '^throughput')"
+    diff -w <(emulator dump "$memfile" "$zsttext" | grep -v -e '^elapsed' -e '^throughput') <(echo "$expected") \
+        && diff -w <(emulator dump "$memfile" "$zstbin" | grep -v -e '^elapsed' -e '^throughput') <(echo "$expected") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+printf "Test %1d (trace-convert 1): " $((++test))
+check_round_trip trace-convert commands01.txt
+
+printf "Test %1d (trace-convert 2): " $((++test))
+check_round_trip trace-convert commands02.txt
+
+printf "Test %1d (emulator on binary trace): " $((++test))
+check_same_emulation trace-convert memory-dump-01.mem commands02.txt
+
+printf "Test %1d (trace-convert -j): " $((++test))
+check_parallel trace-convert commands02.txt
+
+printf "Test %1d (trace-convert -j, several chunks): " $((++test))
+check_parallel trace-convert commands02.txt 200000
+
+printf "Test %1d (gzip-compressed traces): " $((++test))
+check_gzip trace-convert memory-dump-01.mem commands02.txt
+
+printf "Test %1d (zstd-compressed traces): " $((++test))
+check_zstd trace-convert memory-dump-01.mem commands02.txt
+
+# ======================================================================
+echo "SUCCESS"
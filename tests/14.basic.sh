@@ -0,0 +1,54 @@
+#!/bin/bash
+
+## Basic tests for trace importers
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+# ======================================================================
+# tool function: imported (text) trace shall be the expected one
+check_import() {
+
+    checkX "Trace importer" "$1"
+
+    testfile="tests/files/$3"
+    [ -f "$testfile" ] || error "Expected test file \"$testfile\" not found."
+
+    EXPECTED_OUTPUT="${4}"
+
+    txttrace="$(new_tmp_file)"
+    "$1" "$2" txt "$testfile" "$txttrace" || exit 1
+
+    diff -w "$txttrace" <(echo -e "$EXPECTED_OUTPUT") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Expected:\n$EXPECTED_OUTPUT"; \
+            echo -e "Actual:\n$(cat "$txttrace")"; \
+            exit 1)
+}
+
+# ======================================================================
+# fetches cover whole words; data accesses are split in aligned words and bytes
+IMPORTED="R I @0x0000000000000000
+R I @0x0000000000000004
+R I @0x0000000000000008
+R DW @0x0000000000200000
+W DB 0x00 @0x0000000000200001
+W DB 0x00 @0x0000000000200002
+W DB 0x00 @0x0000000000200003
+W DB 0x00 @0x0000000000200004
+R DW @0x0000000000200010
+R DW @0x0000000000200014
+W DW 0x00000000 @0x0000000000200010
+W DW 0x00000000 @0x0000000000200014
+R DB @0x0000000000200022"
+
+printf "Test %1d (lackey import): " $((++test))
+check_import trace-import lackey lackey-01.txt "$IMPORTED"
+
+printf "Test %1d (memtrace import): " $((++test))
+check_import trace-import memtrace memtrace-01.txt "$IMPORTED"
+
+# ======================================================================
+echo "SUCCESS"
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+## Basic tests for synthetic workloads
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+# generated memory descriptions come with their page files
+readonly GEN_DIR="$(mktemp -d)"
+trap 'status=$?; rm -rf "$GEN_DIR"; cleanup; exit $status' EXIT
+
+# ======================================================================
+# tool function: a generated workload shall run on its generated memory,
+# with the same counters from its binary and text traces
+check_workload() {
+
+    checkX "Trace generator" "$1"
+    checkX "Full-system emulator" emulator
+
+    desc="$GEN_DIR/$2.desc"
+    "$1" -n 2000 -s 2M -i 1 -m "$desc" $2 bin "$GEN_DIR/$2.bin" \
+        && "$1" -n 2000 -s 2M -i 1 $2 txt "$GEN_DIR/$2.txt" || exit 1
+
+    counters="$(emulator desc "$desc" "$GEN_DIR/$2.bin" | grep -v -e '^elapsed' -e '^throughput')" || exit 1
+
+    echo "$counters" | grep -q '^accesses: *4000$' \
+        && diff -w <(echo "$counters") \
+                   <(emulator desc "$desc" "$GEN_DIR/$2.txt" | grep -v -e '^elapsed' -e '^throughput') \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            echo -e "Actual:\n$counters"; \
+            exit 1)
+}
+
+# ======================================================================
+for pattern in seq stride random zipf chase stencil matmul; do
+    printf "Test %1d ($pattern workload): " $((++test))
+    check_workload trace-gen $pattern
+done
+
+# ======================================================================
+echo "SUCCESS"
@@ -9,13 +9,12 @@
  */
 
 #include "addr.h"
+#include "tlb_entry.h"
 
 #include <stdint.h>
 
 #define TLB_LINES 128 // the number of entries
 
 typedef struct tlb_entry {
-    uint64_t tag : VIRT_PAGE_NUM;
-    uint32_t phy_page_num : PHY_PAGE_NUM;
-    uint8_t v : 1;
+    uint64_t meta; // tag (the virtual page number), phy_page_num and v, see tlb_entry.h
 } tlb_entry_t;
@@ -0,0 +1,59 @@
+#pragma once
+
+/**
+ * @file tlb_entry.h
+ * @brief packed metadata word shared by all the TLB entries (tlb.h, tlb_hrchy.h)
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "addr.h"
+
+#include <stdint.h>
+
+/**
+ * Each TLB entry is one 64-bit word, without C bitfields:
+ *
+ *   63  62      56 55              36 35                  0
+ *  +---+----------+------------------+---------------------+
+ *  | v | reserved |   phy_page_num   |         tag         |
+ *  +---+----------+------------------+---------------------+
+ *
+ *  - tag: virtual page number, without the line index bits in the
+ *    direct-mapped TLBs (32 bits in L1, 30 in L2, 36 in the simple TLB);
+ *  - phy_page_num: the physical page number of the translation;
+ *  - reserved bits are 0; v is the valid bit.
+ *
+ * An all-zero word (e.g. after a flush) is an invalid entry, and a lookup
+ * checks the valid bit and the tag with one masked comparison
+ * (tlb_entry_matches()).
+ */
+
+#define TLB_ENTRY_TAG_BITS      VIRT_PAGE_NUM
+#define TLB_ENTRY_PPN_SHIFT     TLB_ENTRY_TAG_BITS
+#define TLB_ENTRY_VALID_SHIFT   63
+
+#define TLB_ENTRY_TAG_MASK      ((UINT64_C(1) << TLB_ENTRY_TAG_BITS) - 1)
+#define TLB_ENTRY_PPN_MASK      (((UINT64_C(1) << PHY_PAGE_NUM) - 1) << TLB_ENTRY_PPN_SHIFT)
+#define TLB_ENTRY_VALID         (UINT64_C(1) << TLB_ENTRY_VALID_SHIFT)
+
+_Static_assert(TLB_ENTRY_PPN_SHIFT + PHY_PAGE_NUM <= TLB_ENTRY_VALID_SHIFT,
+               "the tag and physical page number of a TLB entry do not fit in 63 bits");
+
+// metadata word of an entry
+#define tlb_entry_pack(TAG, PHY_PAGE_NUM_, V) \
+    (((uint64_t)(TAG) & TLB_ENTRY_TAG_MASK) \
+     | (((uint64_t)(PHY_PAGE_NUM_) << TLB_ENTRY_PPN_SHIFT) & TLB_ENTRY_PPN_MASK) \
+     | ((V) ? TLB_ENTRY_VALID : 0))
+
+// fields of an entry (any TLB entry type)
+#define tlb_entry_tag(ENTRY)          ((ENTRY).meta & TLB_ENTRY_TAG_MASK)
+#define tlb_entry_phy_page_num(ENTRY) ((uint32_t)(((ENTRY).meta & TLB_ENTRY_PPN_MASK) >> TLB_ENTRY_PPN_SHIFT))
+#define tlb_entry_valid(ENTRY)        ((uint8_t)((ENTRY).meta >> TLB_ENTRY_VALID_SHIFT))
+
+// whether an entry is valid and holds TAG
+#define tlb_entry_matches(ENTRY, TAG) \
+    (((ENTRY).meta & (TLB_ENTRY_VALID | TLB_ENTRY_TAG_MASK)) == (TLB_ENTRY_VALID | (uint64_t)(TAG)))
+
+#define tlb_entry_invalidate(ENTRY)   ((ENTRY).meta &= ~TLB_ENTRY_VALID)
@@ -9,6 +9,7 @@
  */
 
 #include "addr.h"
+#include "tlb_entry.h"
 #include "error.h"
 
 #include <stdint.h>
@@ -34,24 +35,20 @@
 
 /**
  * L1 ITLB, L1 DTLB, and L2 TLB are all direct-mapped.
+ * Each entry is one packed word (see tlb_entry.h), with a tag of
+ * TAG_1_SIZE bits in L1 and TAG_2_SIZE bits in L2.
  */
 
 typedef struct l1_itlb_entry {
-    uint32_t tag : TAG_1_SIZE;
-    uint32_t  phy_page_num : PHY_PAGE_NUM;
-    uint8_t v : 1;
+    uint64_t meta;
 } l1_itlb_entry_t;
 
 typedef struct l1_dtlb_entry {
-    uint32_t tag : TAG_1_SIZE;
-    uint32_t  phy_page_num : PHY_PAGE_NUM;
-    uint8_t v : 1;
+    uint64_t meta;
 } l1_dtlb_entry_t;
 
 typedef struct l2_tlb_entry {
-    uint32_t tag : TAG_2_SIZE;
-    uint32_t  phy_page_num : PHY_PAGE_NUM;
-    uint8_t v : 1;
+    uint64_t meta;
 } l2_tlb_entry_t;
 
 enum tlb { L1_ITLB, L1_DTLB, L2_TLB };
@@ -1,13 +1,71 @@
 #include "tlb_hrchy_mng.h"
+#include "profile.h"
 
+#include <string.h> // for memmove()
+
+// probes of a hierarchy observing nothing (see tlb_search())
+static const tlb_probes_t no_probes;
+
+//=========================================================================
+int tlb_stats_attach(tlb_probes_t* probes, tlb_stats_t* stats){
+    M_REQUIRE_NON_NULL(probes);
+    probes->stats = stats;
+    return ERR_NONE;
+}
+
+//=========================================================================
+int tlb_heatmap_attach(tlb_probes_t* probes, tlb_heatmap_t* heatmap){
+    M_REQUIRE_NON_NULL(probes);
+    probes->heatmap = heatmap;
+    return ERR_NONE;
+}
+
+//=========================================================================
+int tlb_hooks_attach(tlb_probes_t* probes, const tlb_hooks_t* hooks){
+    M_REQUIRE_NON_NULL(probes);
+    M_REQUIRE_NON_NULL(hooks);
+    M_REQUIRE(probes->nb_hooks < HOOKS_MAX, ERR_MEM, "already %d hook tables attached", HOOKS_MAX);
+    probes->hooks[probes->nb_hooks++] = hooks;
+    return ERR_NONE;
+}
+
+//=========================================================================
+int tlb_hooks_detach(tlb_probes_t* probes, const tlb_hooks_t* hooks){
+    M_REQUIRE_NON_NULL(probes);
+    for (unsigned i = 0; i < probes->nb_hooks; ++i) {
+        if (probes->hooks[i] == hooks) {
+            // the others keep their order
+            memmove(&probes->hooks[i], &probes->hooks[i + 1], (probes->nb_hooks - i - 1) * sizeof(probes->hooks[0]));
+            --probes->nb_hooks;
+            return ERR_NONE;
+        }
+    }
+    M_EXIT(ERR_BAD_PARAMETER, "%s", "hook table not attached");
+}
+
+// physical address of a page, as given to the hooks
+#define page_paddr(PHY_PAGE_NUM) ((uint32_t)(PHY_PAGE_NUM) << PAGE_OFFSET)
+
+// reports the replacement of the valid entry INDEX of an L1 TLB, if any
+#define fire_l1_evict(PROBES, TLB, TLB_TYPE, INDEX) \
+    do { \
+        if (tlb_entry_valid((TLB)[INDEX])) \
+            fire_hook(PROBES, on_evict, TLB_TYPE, INDEX, 0, page_paddr(tlb_entry_phy_page_num((TLB)[INDEX]))); \
+    } while(0)
+
+// increments a counter of a TLB, if statistics are collected (STATS not NULL)
+#define tlb_stats_count(STATS, TLB, COUNTER) \
+    do { \
+        if ((STATS) != NULL) ++(STATS)->counters[TLB].COUNTER; \
+    } while(0)
 
 //=========================================================================
 
 #define init_entry(TYPE, LINES_BITS) \
     do { \
-        ((TYPE *)tlb_entry)->tag = virt_addr_t_to_virtual_page_number(vaddr) >> LINES_BITS; /*we remove the index to keep only tag*/ \
-        ((TYPE *)tlb_entry)->phy_page_num = paddr->phy_page_num; \
-        ((TYPE *)tlb_entry)->v = 1; \
+        /*we remove the index to keep only tag*/ \
+        ((TYPE *)tlb_entry)->meta = tlb_entry_pack(virt_addr_t_to_virtual_page_number(vaddr) >> LINES_BITS, \
+                                                   paddr->phy_page_num, 1); \
     } while(0)
 
 int tlb_entry_init( const virt_addr_t * vaddr,
@@ -64,9 +122,7 @@ int tlb_flush(void *tlb, tlb_t tlb_type){
 #define insert(TYPE, LINES) \
     do { \
         M_REQUIRE(line_index < LINES, ERR_BAD_PARAMETER, "insert : line index bigger than L1_ITLB_LINES %c", ' '); \
-        ((TYPE *)tlb)[line_index].tag = ((TYPE *)tlb_entry)->tag; \
-        ((TYPE *)tlb)[line_index].phy_page_num = ((TYPE *)tlb_entry)->phy_page_num; \
-        ((TYPE *)tlb)[line_index].v = ((TYPE *)tlb_entry)->v; \
+        ((TYPE *)tlb)[line_index].meta = ((const TYPE *)tlb_entry)->meta; \
     } while(0)
 
 int tlb_insert( uint32_t line_index,
@@ -98,8 +154,8 @@ int tlb_insert( uint32_t line_index,
     do { \
         line_index = virtual_page_number % LINES; \
         tag = virtual_page_number >> LINES_BITS; \
-        if(((TYPE *)tlb)[line_index].v == 1 && ((TYPE *)tlb)[line_index].tag == tag){ \
-            paddr->phy_page_num = ((TYPE *)tlb)[line_index].phy_page_num; \
+        if(tlb_entry_matches(((const TYPE *)tlb)[line_index], tag)){ \
+            paddr->phy_page_num = tlb_entry_phy_page_num(((const TYPE *)tlb)[line_index]); \
             paddr->page_offset = vaddr->page_offset; \
             hit = 1; \
         } \
@@ -150,20 +206,20 @@ int tlb_hit( const virt_addr_t * vaddr,
 #define insert_in_tlb(TYPE, TAG, INDEX, POINTER, TYPE2) \
     do { \
         TYPE entry_casted; \
-        entry_casted.phy_page_num = paddr->phy_page_num; \
-        entry_casted.tag = TAG; \
-        entry_casted.v = 1; \
+        entry_casted.meta = tlb_entry_pack(TAG, paddr->phy_page_num, 1); \
         error_code = tlb_insert(INDEX, &entry_casted, POINTER, TYPE2); \
     } while(0)
 
-int tlb_search( const void * mem_space,
+// the lookup itself, timed by tlb_search()
+static int tlb_search_levels( const void * mem_space,
                 const virt_addr_t * vaddr,
                 phy_addr_t * paddr,
                 mem_access_t access,
                 l1_itlb_entry_t * l1_itlb,
                 l1_dtlb_entry_t * l1_dtlb,
                 l2_tlb_entry_t * l2_tlb,
-                int* hit_or_miss){
+                int* hit_or_miss,
+                const tlb_probes_t* probes){
 
     M_REQUIRE_NON_NULL(mem_space);
     M_REQUIRE_NON_NULL(vaddr);
@@ -184,10 +240,19 @@ int tlb_search( const void * mem_space,
         pointer_and_type(l1_dtlb, L1_DTLB);
     }
     hit = tlb_hit(vaddr, paddr, tlb_pointer, tlb_type);
+    if (probes->heatmap != NULL) {
+        const uint32_t line = virt_addr_t_to_virtual_page_number(vaddr) % L1_ITLB_LINES; // = L1_DTLB_LINES
+        tlb_heatmap_count(probes->heatmap, tlb_type, line, accesses);
+        if (!hit) tlb_heatmap_count(probes->heatmap, tlb_type, line, misses);
+    }
     if(hit == 1){
+        tlb_stats_count(probes->stats, tlb_type, hits);
+        fire_hook(probes, on_hit, tlb_type, virt_addr_t_to_virtual_page_number(vaddr) % L1_ITLB_LINES,
+                  0, page_paddr(paddr->phy_page_num));
         *hit_or_miss = 1;
         return ERR_NONE;
     }
+    tlb_stats_count(probes->stats, tlb_type, misses);
 
     // second level: search in l2_tlb
     int error_code = 0;
@@ -200,18 +265,31 @@ int tlb_search( const void * mem_space,
     } else {
         index_and_tag(L1_DTLB_LINES, L1_DTLB_LINES_BITS);
     }
+    // the L1 entry to be replaced, in any case, from now on
+    if (access == INSTRUCTION ? tlb_entry_valid(l1_itlb[index_tlb1]) : tlb_entry_valid(l1_dtlb[index_tlb1])) {
+        tlb_heatmap_count(probes->heatmap, tlb_type, index_tlb1, evictions);
+    }
 
     hit = tlb_hit(vaddr, paddr, l2_tlb, L2_TLB);
+    tlb_heatmap_count(probes->heatmap, L2_TLB, virtual_page_number % L2_TLB_LINES, accesses);
     if(hit == 1){
+        tlb_stats_count(probes->stats, L2_TLB, hits);
+        fire_hook(probes, on_miss, tlb_type, index_tlb1, 0, page_paddr(paddr->phy_page_num));
+        fire_hook(probes, on_hit, L2_TLB, virtual_page_number % L2_TLB_LINES, 0, page_paddr(paddr->phy_page_num));
         *hit_or_miss = 1;
 
         //insert in the right tlb1
         if(access == INSTRUCTION){
+            fire_l1_evict(probes, l1_itlb, L1_ITLB, index_tlb1);
             insert_in_tlb(l1_itlb_entry_t, tag_tlb1, index_tlb1, tlb_pointer, tlb_type);
         }
         else {
+            fire_l1_evict(probes, l1_dtlb, L1_DTLB, index_tlb1);
             insert_in_tlb(l1_dtlb_entry_t, tag_tlb1, index_tlb1, tlb_pointer, tlb_type);
         }
+        if (error_code == ERR_NONE) {
+            fire_hook(probes, on_fill, tlb_type, index_tlb1, 0, page_paddr(paddr->phy_page_num));
+        }
 
         return error_code;
     }
@@ -219,37 +297,87 @@ int tlb_search( const void * mem_space,
     //no hit part
 
     //page walk
+    tlb_stats_count(probes->stats, L2_TLB, misses);
+    tlb_heatmap_count(probes->heatmap, L2_TLB, virtual_page_number % L2_TLB_LINES, misses);
+    if (tlb_entry_valid(l2_tlb[virtual_page_number % L2_TLB_LINES])) {
+        tlb_heatmap_count(probes->heatmap, L2_TLB, virtual_page_number % L2_TLB_LINES, evictions);
+    }
     *hit_or_miss = 0;
     error_code = page_walk(mem_space, vaddr, paddr);
     if(error_code != ERR_NONE) return error_code;
+    page_walk_count(probes->stats == NULL ? NULL : &probes->stats->page_walks);
 
     //insert in tlb2
     uint32_t tag_tlb2 = virtual_page_number >> L2_TLB_LINES_BITS;
     uint32_t index_tlb2 = virtual_page_number % L2_TLB_LINES;
+    fire_hook(probes, on_miss, tlb_type, index_tlb1, 0, page_paddr(paddr->phy_page_num));
+    fire_hook(probes, on_miss, L2_TLB, index_tlb2, 0, page_paddr(paddr->phy_page_num));
+    fire_hook(probes, on_page_walk, L2_TLB, index_tlb2, 0, page_paddr(paddr->phy_page_num));
+    if (tlb_entry_valid(l2_tlb[index_tlb2])) {
+        fire_hook(probes, on_evict, L2_TLB, index_tlb2, 0, page_paddr(tlb_entry_phy_page_num(l2_tlb[index_tlb2])));
+    }
     insert_in_tlb(l2_tlb_entry_t, tag_tlb2, index_tlb2, l2_tlb, L2_TLB);
 
     if(error_code != ERR_NONE) return error_code;
+    fire_hook(probes, on_fill, L2_TLB, index_tlb2, 0, page_paddr(paddr->phy_page_num));
 
     size_t mask_tlb1 = 3;                                           //to catch only the two LSB bits of the tlb1 tag
     size_t msb_index_tlb2 = index_tlb2 >> (L2_TLB_LINES_BITS - 2);  // to catch only the two MSB bits of the index on tlb2
 
     if(access == INSTRUCTION){
             //insert in tlb1
+            fire_l1_evict(probes, l1_itlb, L1_ITLB, index_tlb1);
             insert_in_tlb(l1_itlb_entry_t, tag_tlb1, index_tlb1, tlb_pointer, tlb_type);
+            if(error_code != ERR_NONE) return error_code;
+            fire_hook(probes, on_fill, L1_ITLB, index_tlb1, 0, page_paddr(paddr->phy_page_num));
 
             //check if must invalidate in other tlb
 
-            if((l1_dtlb[index_tlb1].tag & mask_tlb1) == msb_index_tlb2){
-                l1_dtlb[index_tlb1].v = 0;
+            if((tlb_entry_tag(l1_dtlb[index_tlb1]) & mask_tlb1) == msb_index_tlb2){
+                if(tlb_entry_valid(l1_dtlb[index_tlb1])) tlb_stats_count(probes->stats, L1_DTLB, invalidations);
+                fire_l1_evict(probes, l1_dtlb, L1_DTLB, index_tlb1);
+                tlb_entry_invalidate(l1_dtlb[index_tlb1]);
             }
         }
         else {
             //insert in tlb1
+            fire_l1_evict(probes, l1_dtlb, L1_DTLB, index_tlb1);
             insert_in_tlb(l1_dtlb_entry_t, tag_tlb1, index_tlb1, tlb_pointer, tlb_type);
+            if(error_code != ERR_NONE) return error_code;
+            fire_hook(probes, on_fill, L1_DTLB, index_tlb1, 0, page_paddr(paddr->phy_page_num));
             //check if must invalidate in other tlb
-            if((l1_itlb[index_tlb1].tag & mask_tlb1) == msb_index_tlb2){
-                l1_itlb[index_tlb1].v = 0;
+            if((tlb_entry_tag(l1_itlb[index_tlb1]) & mask_tlb1) == msb_index_tlb2){
+                if(tlb_entry_valid(l1_itlb[index_tlb1])) tlb_stats_count(probes->stats, L1_ITLB, invalidations);
+                fire_l1_evict(probes, l1_itlb, L1_ITLB, index_tlb1);
+                tlb_entry_invalidate(l1_itlb[index_tlb1]);
             }
         }
     return error_code;
 }
+
+int tlb_search_probed( const void * mem_space,
+                const virt_addr_t * vaddr,
+                phy_addr_t * paddr,
+                mem_access_t access,
+                l1_itlb_entry_t * l1_itlb,
+                l1_dtlb_entry_t * l1_dtlb,
+                l2_tlb_entry_t * l2_tlb,
+                int* hit_or_miss,
+                const tlb_probes_t* probes){
+    PROFILE_START(start);
+    const int error_code = tlb_search_levels(mem_space, vaddr, paddr, access, l1_itlb, l1_dtlb, l2_tlb, hit_or_miss,
+                                             probes != NULL ? probes : &no_probes);
+    PROFILE_STOP(PROFILE_TLB_SEARCH, start);
+    return error_code;
+}
+
+int tlb_search( const void * mem_space,
+                const virt_addr_t * vaddr,
+                phy_addr_t * paddr,
+                mem_access_t access,
+                l1_itlb_entry_t * l1_itlb,
+                l1_dtlb_entry_t * l1_dtlb,
+                l2_tlb_entry_t * l2_tlb,
+                int* hit_or_miss){
+    return tlb_search_probed(mem_space, vaddr, paddr, access, l1_itlb, l1_dtlb, l2_tlb, hit_or_miss, NULL);
+}
@@ -12,6 +12,9 @@
 #include "mem_access.h"
 #include "addr.h"
 #include "page_walk.h"
+#include "stats.h"
+#include "hooks.h"
+#include "probes.h"
 
 //=========================================================================
 /**
@@ -98,3 +101,66 @@ int tlb_search( const void * mem_space,
                 l1_dtlb_entry_t * l1_dtlb,
                 l2_tlb_entry_t * l2_tlb,
                 int* hit_or_miss);
+
+//=========================================================================
+/**
+ * @brief Same as tlb_search(), observed by the given probes (see probes.h).
+ *
+ * @param probes what observes the lookup (statistics, heatmap, hooks),
+ *        NULL for nothing (as tlb_search())
+ * @return error code
+ */
+int tlb_search_probed( const void * mem_space,
+                const virt_addr_t * vaddr,
+                phy_addr_t * paddr,
+                mem_access_t access,
+                l1_itlb_entry_t * l1_itlb,
+                l1_dtlb_entry_t * l1_dtlb,
+                l2_tlb_entry_t * l2_tlb,
+                int* hit_or_miss,
+                const tlb_probes_t* probes);
+
+//=========================================================================
+/**
+ * @brief Collect the statistics of the lookups observed by the given probes
+ *        (hits, misses, invalidations and page walks) into the given
+ *        counters, which must outlive the collection.
+ *
+ * Counters are only incremented, never reset (see tlb_stats_init()).
+ * When no statistics are attached (the default), the only cost is one test per event.
+ * @param probes the probes of a hierarchy
+ * @param stats the counters to be updated, NULL to stop collecting
+ * @return error code
+ */
+int tlb_stats_attach(tlb_probes_t* probes, tlb_stats_t* stats);
+
+//=========================================================================
+/**
+ * @brief Collect per-line counters of the lookups observed by the given
+ *        probes (accesses, misses and evictions of every line of every TLB)
+ *        into the given heatmap, which must outlive the collection.
+ * @param probes the probes of a hierarchy
+ * @param heatmap the counters to be updated, NULL to stop collecting
+ * @return error code
+ */
+int tlb_heatmap_attach(tlb_probes_t* probes, tlb_heatmap_t* heatmap);
+
+//=========================================================================
+/**
+ * @brief Call the given callbacks on the events of the lookups observed by
+ *        the given probes (see hooks.h), after those of the tables already
+ *        attached (up to HOOKS_MAX). The table must outlive its use.
+ * @param probes the probes of a hierarchy
+ * @param hooks the callbacks to be called
+ * @return error code (ERR_MEM when HOOKS_MAX tables are already attached)
+ */
+int tlb_hooks_attach(tlb_probes_t* probes, const tlb_hooks_t* hooks);
+
+//=========================================================================
+/**
+ * @brief Stop calling a table attached by tlb_hooks_attach().
+ * @param probes the probes of a hierarchy
+ * @param hooks the table to be detached
+ * @return error code (ERR_BAD_PARAMETER if it was not attached)
+ */
+int tlb_hooks_detach(tlb_probes_t* probes, const tlb_hooks_t* hooks);
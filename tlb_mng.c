@@ -1,5 +1,12 @@
 #include "tlb_mng.h"
 
+// statistics of the lookups, if any (see tlb_simple_stats_attach())
+static tlb_simple_stats_t * attached_stats = NULL;
+
+int tlb_simple_stats_attach(tlb_simple_stats_t * stats) {
+    attached_stats = stats;
+    return ERR_NONE;
+}
 
 int tlb_entry_init( const virt_addr_t * vaddr,
     const phy_addr_t * paddr,
@@ -8,9 +15,7 @@ int tlb_entry_init( const virt_addr_t * vaddr,
     M_REQUIRE_NON_NULL(paddr);
     M_REQUIRE_NON_NULL(tlb_entry);
 
-    tlb_entry->tag = virt_addr_t_to_virtual_page_number(vaddr);
-    tlb_entry->phy_page_num = paddr->phy_page_num;
-    tlb_entry->v = 1;
+    tlb_entry->meta = tlb_entry_pack(virt_addr_t_to_virtual_page_number(vaddr), paddr->phy_page_num, 1);
 
     return ERR_NONE;
 }
@@ -35,9 +40,9 @@ int tlb_hit(const virt_addr_t * vaddr,
     uint64_t virt_page_num = virt_addr_t_to_virtual_page_number(vaddr);
 
     for_all_nodes_reverse(node, replacement_policy->ll) {
-        if (tlb[node->value].tag == virt_page_num && tlb[node->value].v) {
+        if (tlb_entry_matches(tlb[node->value], virt_page_num)) {
             paddr->page_offset = vaddr->page_offset;
-            paddr->phy_page_num = tlb[node->value].phy_page_num;
+            paddr->phy_page_num = tlb_entry_phy_page_num(tlb[node->value]);
             replacement_policy->move_back(replacement_policy->ll, node);
 
             return 1;
@@ -58,9 +63,7 @@ int tlb_insert( uint32_t line_index,
         return ERR_BAD_PARAMETER; // index out of bounds
     }
 
-    tlb[line_index].tag = tlb_entry->tag;
-    tlb[line_index].phy_page_num = tlb_entry->phy_page_num;
-    tlb[line_index].v = tlb_entry->v;
+    tlb[line_index].meta = tlb_entry->meta;
 
     return ERR_NONE;
 }
@@ -79,8 +82,13 @@ int tlb_search( const void * mem_space,
     M_REQUIRE_NON_NULL(hit_or_miss);
 
     *hit_or_miss = tlb_hit(vaddr, paddr, tlb, replacement_policy);
+    if (attached_stats != NULL) {
+        if (*hit_or_miss) ++attached_stats->tlb.hits;
+        else ++attached_stats->tlb.misses;
+    }
     if (!(*hit_or_miss)) {
         if (page_walk(mem_space, vaddr, paddr) == ERR_NONE) {
+            page_walk_count(attached_stats == NULL ? NULL : &attached_stats->page_walks);
             tlb_entry_t tlb_entry;
             tlb_entry_init(vaddr, paddr, &tlb_entry);
 
@@ -14,6 +14,7 @@
 #include "error.h"
 #include "addr_mng.h"
 #include "page_walk.h"
+#include "stats.h"
 
 
 typedef struct replacement_policy {
@@ -92,3 +93,14 @@ int tlb_search( const void * mem_space,
                 tlb_entry_t * tlb,
                 replacement_policy_t * replacement_policy,
                 int* hit_or_miss);
+
+//=========================================================================
+/**
+ * @brief Collect the statistics of tlb_search() (hits, misses and page walks)
+ *        into the given counters, which must outlive the collection.
+ *
+ * Counters are only incremented, never reset.
+ * @param stats the counters to be updated, NULL to stop collecting
+ * @return error code
+ */
+int tlb_simple_stats_attach(tlb_simple_stats_t* stats);
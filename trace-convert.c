@@ -0,0 +1,129 @@
+/**
+ * @file trace-convert.c
+ * @brief converts command traces between the text and the binary formats
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#if defined _WIN32  || defined _WIN64
+#define __USE_MINGW_ANSI_STDIO 1
+#endif
+
+#include "error.h"
+#include "commands.h"
+#include "trace_mng.h"
+#include "parse_mng.h"
+#include "compress_mng.h" // for compression_supported()
+#include "util.h" // for SIZE_T_FMT
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [-j threads] (bin|txt) input_trace output_trace\n", pgm);
+    fprintf(stderr, "examples: %s bin commands01.txt commands01.trace\n", pgm);
+    fprintf(stderr, "          %s txt commands01.trace commands01.txt\n", pgm);
+    fprintf(stderr, "          %s -j 8 bin commands01.txt commands01.trace\n", pgm);
+    fprintf(stderr, "-j parses an uncompressed text input with the given number of threads (0 = one per CPU), chunk by chunk.\n");
+}
+
+// ======================================================================
+// Where the chunks parsed in parallel are written
+typedef struct {
+    trace_writer_t* writer;
+    FILE* text_output;
+} output_t;
+
+// Writes the commands of a chunk, as soon as it is parsed (see program_parse_parallel())
+static int write_chunk(void* data, const program_t* commands)
+{
+    const output_t* output = data;
+    return trace_writer_add_program(output->writer, commands, output->text_output);
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    // text input parsed in parallel, chunk by chunk; -1 means streamed
+    long nb_threads = -1;
+    if (argc > 2 && !strcmp(argv[1], "-j")) {
+        char* end = NULL;
+        nb_threads = strtol(argv[2], &end, 10);
+        if (*argv[2] == '\0' || *end != '\0' || nb_threads < 0) {
+            error(argv[0], "invalid number of threads.");
+            return 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc < 4) {
+        error(argv[0], "please provide output format, input and output filenames:");
+        return 1;
+    }
+    int to_binary = 1;
+    if (strcmp(argv[1], "bin")) {
+        if (strcmp(argv[1], "txt")) {
+            error(argv[0], "unknown output format.");
+            return 1;
+        }
+        to_binary = 0;
+    }
+
+    trace_t trace;
+    if (trace_open(argv[2], &trace) != ERR_NONE) {
+        error(argv[0], compression_supported(compression_of_file(argv[2])) ? "cannot open input trace."
+              : "input trace is zstd-compressed, but trace-convert was built without zstd (make ZSTD=1).");
+        return 2;
+    }
+
+    trace_writer_t writer;
+    FILE* text_output = NULL;
+    int err = ERR_NONE;
+    if (to_binary) {
+        err = trace_writer_open(argv[3], &writer);
+    } else {
+        text_output = fopen(argv[3], "w");
+        if (text_output == NULL) err = ERR_IO;
+    }
+    if (err != ERR_NONE) {
+        trace_close(&trace);
+        error(argv[0], "cannot open output trace.");
+        return 3;
+    }
+
+    trace_writer_t* const binary_output = to_binary ? &writer : NULL;
+    program_t batch;
+    err = program_init(&batch);
+    if (err == ERR_NONE && nb_threads >= 0 && trace.format == TRACE_TEXT && trace.compression == COMPRESSION_NONE) {
+        (void)trace_close(&trace);
+        output_t output = { binary_output, text_output };
+        err = program_parse_parallel(argv[2], (size_t) nb_threads, 0, write_chunk, &output, &trace.line);
+    } else {
+        while (err == ERR_NONE) {
+            err = trace_next(&trace, &batch, TRACE_BUFFER_RECORDS);
+            if (err != ERR_NONE || batch.nb_lines == 0) break;
+
+            err = trace_writer_add_program(binary_output, &batch, text_output);
+        }
+    }
+    if (err != ERR_NONE) {
+        fprintf(stderr, "ERROR: command " SIZE_T_FMT ": %s\n", trace.line, ERR_MESSAGES[err - ERR_NONE]);
+    }
+
+    (void)program_free(&batch);
+    (void)trace_close(&trace);
+    if (to_binary) {
+        if (trace_writer_close(&writer) != ERR_NONE && err == ERR_NONE) err = ERR_IO;
+    } else {
+        if (fclose(text_output) != 0 && err == ERR_NONE) err = ERR_IO;
+    }
+    return err == ERR_NONE ? 0 : 4;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file trace-gen.c
+ * @brief generates synthetic command traces, and the memory description to run them
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#if defined _WIN32  || defined _WIN64
+#define __USE_MINGW_ANSI_STDIO 1
+#endif
+
+#define _POSIX_C_SOURCE 200809L // for getopt()
+
+#include "error.h"
+#include "commands.h"
+#include "trace_mng.h"
+#include "workload_mng.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h> // for strtoull(), strtod()
+#include <string.h>
+#include <unistd.h> // for getopt()
+#include <assert.h>
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [options] pattern (bin|txt) output_trace\n", pgm);
+    fprintf(stderr, "patterns: seq, stride, random, zipf, chase, stencil, matmul\n");
+    fprintf(stderr, "options:  -n accesses   number of data accesses (100000)\n");
+    fprintf(stderr, "          -s size       data footprint in bytes, k/M/G suffixes allowed (1M)\n");
+    fprintf(stderr, "          -S stride     stride, or node size for chase, in bytes (64)\n");
+    fprintf(stderr, "          -a alpha      Zipf exponent (0.99)\n");
+    fprintf(stderr, "          -d dim        stencil grid side or matrix side, in words (256)\n");
+    fprintf(stderr, "          -t tile       matmul tile side, in words (16)\n");
+    fprintf(stderr, "          -w percent    share of writes for seq/stride/random/zipf (25)\n");
+    fprintf(stderr, "          -i fetches    instruction fetches per data access (1)\n");
+    fprintf(stderr, "          -c size       size of the fetched loop body, in bytes (256)\n");
+    fprintf(stderr, "          -r seed       seed of the pseudo-random generator (1)\n");
+    fprintf(stderr, "          -m desc_file  also write a memory description (and its page files) to run the trace\n");
+    fprintf(stderr, "example:  %s -n 1000000 -s 64M -m zipf.desc zipf bin zipf.trace\n", pgm);
+}
+
+// ======================================================================
+// Parses a non-negative number with an optional k, M or G (binary) suffix
+static int parse_size(const char* text, uint64_t* value)
+{
+    char* end = NULL;
+    *value = strtoull(text, &end, 0);
+    if (end == text) return ERR_BAD_PARAMETER;
+    switch (*end) {
+    case 'k': case 'K': *value <<= 10; ++end; break;
+    case 'M': *value <<= 20; ++end; break;
+    case 'G': *value <<= 30; ++end; break;
+    default: break;
+    }
+    return (*end == '\0' && text[0] != '-') ? ERR_NONE : ERR_BAD_PARAMETER;
+}
+
+// ======================================================================
+// Where the generated commands go
+typedef struct {
+    trace_writer_t* writer;     // binary output, or
+    FILE* text_output;          // text output, by batches:
+    program_t batch;
+} output_t;
+
+static int output_flush(output_t* out)
+{
+    const int err = program_print(out->text_output, &out->batch);
+    out->batch.nb_lines = 0;
+    return err;
+}
+
+static int output_command(void* arg, const packed_command_t* packed)
+{
+    output_t* out = arg;
+    if (out->writer != NULL) return trace_writer_add_packed(out->writer, packed);
+
+    command_t command;
+    M_EXIT_IF_ERR(command_unpack(packed, &command), "unpacking command");
+    M_EXIT_IF_ERR(program_add_command(&out->batch, &command), "adding command");
+    return out->batch.nb_lines >= TRACE_BUFFER_RECORDS ? output_flush(out) : ERR_NONE;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    workload_t workload;
+    (void)workload_init(&workload);
+    const char* mem_filename = NULL;
+
+    int opt;
+    int ok = 1;
+    uint64_t value = 0;
+    while (ok && (opt = getopt(argc, argv, "n:s:S:a:d:t:w:i:c:r:m:")) != -1) {
+        if (opt == 'a') {
+            char* end = NULL;
+            workload.zipf_alpha = strtod(optarg, &end);
+            ok = (end != optarg && *end == '\0');
+            continue;
+        }
+        if (opt == 'm') {
+            mem_filename = optarg;
+            continue;
+        }
+        ok = (opt != '?') && parse_size(optarg, &value) == ERR_NONE;
+        switch (opt) {
+        case 'n': workload.nb_accesses = value; break;
+        case 's': workload.size = value; break;
+        case 'S': workload.stride = value; break;
+        case 'd': workload.dim = value; break;
+        case 't': workload.tile = value; break;
+        case 'w': workload.write_percent = (unsigned) value; ok = ok && value <= 100; break;
+        case 'i': workload.ifetch = (unsigned) value; break;
+        case 'c': workload.code_size = value; break;
+        case 'r': workload.seed = value; break;
+        default: break;
+        }
+    }
+    if (!ok) {
+        error(argv[0], "invalid option.");
+        return 1;
+    }
+    if (argc - optind < 3) {
+        error(argv[0], "please provide pattern, output format and output filename:");
+        return 1;
+    }
+    if (workload_pattern_parse(argv[optind], &workload.pattern) != ERR_NONE) {
+        error(argv[0], "unknown pattern.");
+        return 1;
+    }
+    int to_binary = 1;
+    if (strcmp(argv[optind + 1], "bin")) {
+        if (strcmp(argv[optind + 1], "txt")) {
+            error(argv[0], "unknown output format.");
+            return 1;
+        }
+        to_binary = 0;
+    }
+    if (workload_check(&workload) != ERR_NONE) {
+        error(argv[0], "invalid workload parameters.");
+        return 1;
+    }
+
+    trace_writer_t writer;
+    output_t out;
+    zero_init_var(out);
+    int err = program_init(&out.batch);
+    if (err == ERR_NONE && to_binary) {
+        err = trace_writer_open(argv[optind + 2], &writer);
+        out.writer = &writer;
+    } else if (err == ERR_NONE) {
+        out.text_output = fopen(argv[optind + 2], "w");
+        if (out.text_output == NULL) err = ERR_IO;
+    }
+    if (err != ERR_NONE) {
+        (void)program_free(&out.batch);
+        error(argv[0], "cannot open output trace.");
+        return 3;
+    }
+
+    workload_pages_t pages;
+    err = workload_generate(&workload, output_command, &out, mem_filename != NULL ? &pages : NULL);
+    if (err == ERR_NONE && !to_binary) err = output_flush(&out);
+    if (err == ERR_NONE && mem_filename != NULL) {
+        err = workload_write_memory(mem_filename, &pages);
+        (void)workload_pages_free(&pages);
+    }
+    if (err != ERR_NONE) {
+        fprintf(stderr, "ERROR: %s\n", ERR_MESSAGES[err - ERR_NONE]);
+    }
+
+    (void)program_free(&out.batch);
+    if (to_binary) {
+        if (trace_writer_close(&writer) != ERR_NONE && err == ERR_NONE) err = ERR_IO;
+    } else {
+        if (fclose(out.text_output) != 0 && err == ERR_NONE) err = ERR_IO;
+    }
+    return err == ERR_NONE ? 0 : 4;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file trace-import.c
+ * @brief imports Valgrind lackey or DynamoRIO memtrace traces as command traces
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#if defined _WIN32  || defined _WIN64
+#define __USE_MINGW_ANSI_STDIO 1
+#endif
+
+#define _POSIX_C_SOURCE 200809L // for getline()
+
+#include "error.h"
+#include "commands.h"
+#include "import_mng.h"
+#include "trace_mng.h"
+#include "compress_mng.h"
+#include "util.h" // for SIZE_T_FMT
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s (lackey|memtrace) (bin|txt) input_trace output_trace\n", pgm);
+    fprintf(stderr, "examples: %s lackey bin lackey.log program.trace\n", pgm);
+    fprintf(stderr, "          %s memtrace txt memtrace.ls.1234.0000.log program.txt\n", pgm);
+    fprintf(stderr, "input traces may be gzip-compressed.\n");
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        error(argv[0], "please provide input format, output format, input and output filenames:");
+        return 1;
+    }
+
+    import_format_t format = IMPORT_LACKEY;
+    if (strcmp(argv[1], "lackey")) {
+        if (strcmp(argv[1], "memtrace")) {
+            error(argv[0], "unknown input format.");
+            return 1;
+        }
+        format = IMPORT_MEMTRACE;
+    }
+    int to_binary = 1;
+    if (strcmp(argv[2], "bin")) {
+        if (strcmp(argv[2], "txt")) {
+            error(argv[0], "unknown output format.");
+            return 1;
+        }
+        to_binary = 0;
+    }
+
+    FILE* input = compress_fopen(argv[3], NULL);
+    if (input == NULL) {
+        error(argv[0], "cannot open input trace.");
+        return 2;
+    }
+
+    trace_writer_t writer;
+    FILE* text_output = NULL;
+    int err = ERR_NONE;
+    if (to_binary) {
+        err = trace_writer_open(argv[4], &writer);
+    } else {
+        text_output = fopen(argv[4], "w");
+        if (text_output == NULL) err = ERR_IO;
+    }
+    if (err != ERR_NONE) {
+        fclose(input);
+        error(argv[0], "cannot open output trace.");
+        return 3;
+    }
+
+    trace_writer_t* const binary_output = to_binary ? &writer : NULL;
+    program_t batch;
+    char* line = NULL;
+    size_t line_size = 0;
+    size_t line_number = 0;
+    err = program_init(&batch);
+    while (err == ERR_NONE && getline(&line, &line_size, input) >= 0) {
+        ++line_number;
+        err = import_line(format, line, &batch);
+        if (err == ERR_NONE && batch.nb_lines >= TRACE_BUFFER_RECORDS) {
+            err = trace_writer_add_program(binary_output, &batch, text_output);
+            batch.nb_lines = 0;
+        }
+    }
+    if (err == ERR_NONE && ferror(input)) err = ERR_IO;
+    if (err == ERR_NONE) err = trace_writer_add_program(binary_output, &batch, text_output);
+    if (err != ERR_NONE) {
+        fprintf(stderr, "ERROR: line " SIZE_T_FMT ": %s\n", line_number, ERR_MESSAGES[err - ERR_NONE]);
+    }
+
+    free(line);
+    (void)program_free(&batch);
+    fclose(input);
+    if (to_binary) {
+        if (trace_writer_close(&writer) != ERR_NONE && err == ERR_NONE) err = ERR_IO;
+    } else {
+        if (fclose(text_output) != 0 && err == ERR_NONE) err = ERR_IO;
+    }
+    return err == ERR_NONE ? 0 : 4;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+/**
+ * @file trace.h
+ * @brief Type definitions for command traces: text or compact binary files.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "commands.h" // for program_stream_t, packed_command_t
+#include "compress.h" // for compression_t
+
+#include <stdio.h>  // for FILE
+#include <stdint.h>
+
+/**
+ * Binary trace format (version 1), all fields in host (little-endian) byte order:
+ *  - one header (trace_header_t, 16 bytes),
+ *  - followed by nb_records fixed-width records (trace_record_t, 16 bytes each),
+ *    one per command, in program order.
+ */
+
+#define TRACE_MAGIC         "i7TR" // 4 bytes, no terminating '\0' in file
+#define TRACE_MAGIC_SIZE    4
+#define TRACE_VERSION       1
+
+typedef struct trace_header {
+    char magic[TRACE_MAGIC_SIZE];   // TRACE_MAGIC
+    uint16_t version;               // TRACE_VERSION
+    uint16_t record_size;           // sizeof(trace_record_t)
+    uint64_t nb_records;            // number of records following the header
+} trace_header_t;
+
+// records are packed commands (see commands.h), stored as is:
+// a mapped binary trace is a packed program
+typedef packed_command_t trace_record_t;
+
+enum trace_format { TRACE_TEXT, TRACE_BINARY };
+typedef enum trace_format trace_format_t;
+
+#define TRACE_BUFFER_RECORDS 4096
+
+#define TRACE_READ_RECORDS 256 // records read at once from a compressed binary trace
+
+/**
+ * @brief Reader over a trace file, whatever its format.
+ *        Binary traces are memory-mapped (read-only, shared): records are
+ *        used in place, and concurrent readers of a same file share the
+ *        page cache instead of each holding its own copy.
+ *        Compressed traces (text or binary) are decompressed on the fly,
+ *        on a background thread: binary records are then read from file.
+ */
+struct trace {
+    trace_format_t format;
+    compression_t compression;
+    program_stream_t text;          // TRACE_TEXT only
+    void* map;                      // TRACE_BINARY only: the whole mapped file
+    size_t map_size;                // TRACE_BINARY only: size of the mapping, in bytes
+    const trace_record_t* records;  // TRACE_BINARY only: first record, inside the mapping
+    uint64_t nb_records;            // TRACE_BINARY only: records announced in header
+    FILE* file;                     // compressed TRACE_BINARY only: records after the header
+    size_t line;                    // commands read so far (faulty one in case of error)
+};
+typedef struct trace trace_t;
+
+/**
+ * @brief Writer of binary trace files.
+ */
+struct trace_writer {
+    FILE* file;
+    uint64_t nb_records;
+};
+typedef struct trace_writer trace_writer_t;
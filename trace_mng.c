@@ -0,0 +1,336 @@
+/**
+ * @file trace_mng.c
+ * @brief Command trace management: reading text or binary traces, writing binary traces.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#define _DEFAULT_SOURCE // for madvise()
+
+#include "trace_mng.h"
+#include "compress_mng.h"
+#include "addr_mng.h"
+#include "error.h"
+#include "util.h"
+
+#include <string.h> // for memcmp()
+#include <stdlib.h>
+#include <fcntl.h>    // for open()
+#include <unistd.h>   // for close()
+#include <sys/mman.h> // for mmap(), madvise()
+#include <sys/stat.h> // for fstat()
+
+_Static_assert(sizeof(trace_header_t) == 16, "binary trace header must be 16 bytes");
+_Static_assert(sizeof(trace_record_t) == 16, "binary trace records must be 16 bytes");
+
+//=========================================================================
+int trace_record_from_command(const command_t* command, trace_record_t* record)
+{
+    return command_pack(command, record);
+}
+
+//=========================================================================
+int trace_record_to_command(const trace_record_t* record, command_t* command)
+{
+    return command_unpack(record, command);
+}
+
+//=========================================================================
+// Checks the header of a binary trace
+static int trace_header_check(const trace_header_t* header)
+{
+    M_REQUIRE(memcmp(header->magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) == 0, ERR_BAD_PARAMETER, "%s", "not a binary trace");
+    M_REQUIRE(header->version == TRACE_VERSION, ERR_BAD_PARAMETER,
+              "unsupported trace version %u", header->version);
+    M_REQUIRE(header->record_size == sizeof(trace_record_t), ERR_SIZE,
+              "unexpected record size %u", header->record_size);
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Maps a whole binary trace file in memory and checks its header
+static int trace_map(int fd, trace_t* trace)
+{
+    struct stat st;
+    M_REQUIRE(fstat(fd, &st) == 0, ERR_IO, "%s", "cannot stat trace file");
+    M_REQUIRE((size_t) st.st_size >= sizeof(trace_header_t), ERR_IO, "%s", "truncated trace header");
+
+    trace->map_size = (size_t) st.st_size;
+    trace->map = mmap(NULL, trace->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (trace->map == MAP_FAILED) {
+        trace->map = NULL;
+        M_EXIT_ERR(ERR_MEM, "cannot map %zu bytes", trace->map_size);
+    }
+    (void) madvise(trace->map, trace->map_size, MADV_SEQUENTIAL);
+
+    const trace_header_t* header = trace->map;
+    M_EXIT_IF_ERR(trace_header_check(header), "checking trace header");
+    M_REQUIRE(header->nb_records <= (trace->map_size - sizeof(trace_header_t)) / sizeof(trace_record_t),
+              ERR_IO, "truncated trace: %" PRIu64 " records announced", header->nb_records);
+
+    trace->records = (const trace_record_t*) (header + 1);
+    trace->nb_records = header->nb_records;
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Opens a compressed trace: its format is recognized on the decompressed data
+static int trace_open_compressed(const char* filename, trace_t* trace)
+{
+    decompressor_t* decomp = malloc(sizeof(decompressor_t));
+    M_EXIT_IF_NULL(decomp, sizeof(decompressor_t));
+    int err = decompressor_open(filename, trace->compression, decomp);
+    if (err != ERR_NONE) {
+        free(decomp);
+        return err;
+    }
+
+    char magic[TRACE_MAGIC_SIZE];
+    size_t got = 0;
+    err = decompressor_peek(decomp, magic, TRACE_MAGIC_SIZE, &got);
+    FILE* file = (err == ERR_NONE) ? decompressor_fopen(decomp) : NULL;
+    if (file == NULL) {
+        decompressor_close(decomp);
+        free(decomp);
+        return err != ERR_NONE ? err : ERR_IO;
+    }
+
+    if (got != TRACE_MAGIC_SIZE || memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0) {
+        trace->format = TRACE_TEXT;
+        return program_stream_attach(file, &trace->text);
+    }
+
+    trace->format = TRACE_BINARY;
+    trace->file = file;
+    trace_header_t header;
+    err = fread(&header, sizeof(header), 1, file) == 1 ? trace_header_check(&header) : ERR_IO;
+    if (err != ERR_NONE) {
+        trace_close(trace);
+        M_EXIT_ERR(err, "%s", "reading compressed trace header");
+    }
+    trace->nb_records = header.nb_records;
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+int trace_open(const char* filename, trace_t* trace)
+{
+    M_REQUIRE_NON_NULL(filename);
+    M_REQUIRE_NON_NULL(trace);
+
+    zero_init_ptr(trace);
+    const int fd = open(filename, O_RDONLY);
+    M_REQUIRE(fd >= 0, ERR_IO, "cannot open \"%s\"", filename);
+
+    char magic[TRACE_MAGIC_SIZE];
+    const ssize_t got = read(fd, magic, TRACE_MAGIC_SIZE);
+    trace->compression = compression_detect(magic, got > 0 ? (size_t) got : 0);
+    if (trace->compression != COMPRESSION_NONE) {
+        close(fd);
+        return trace_open_compressed(filename, trace);
+    }
+
+    if (got != TRACE_MAGIC_SIZE || memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0) {
+        // not a binary trace: read it as text
+        close(fd);
+        trace->format = TRACE_TEXT;
+        return program_stream_open(filename, &trace->text);
+    }
+
+    trace->format = TRACE_BINARY;
+    const int err = trace_map(fd, trace);
+    close(fd); // the mapping stays valid
+    if (err != ERR_NONE) {
+        trace_close(trace);
+    }
+    return err;
+}
+
+//=========================================================================
+int trace_next(trace_t* trace, program_t* batch, size_t max_lines)
+{
+    M_REQUIRE_NON_NULL(trace);
+    M_REQUIRE_NON_NULL(batch);
+
+    if (trace->format == TRACE_TEXT) {
+        const int err = program_stream_next(&trace->text, batch, max_lines);
+        trace->line = trace->text.line;
+        return err;
+    }
+
+    batch->nb_lines = 0;
+    trace_record_t buffer[TRACE_READ_RECORDS];
+    const trace_record_t* records = (trace->file != NULL) ? buffer : trace->records + trace->line;
+    size_t nb_read = 0;
+    while (batch->nb_lines < max_lines && trace->line < trace->nb_records) {
+        if (trace->file != NULL) {
+            // compressed trace: records come by small blocks
+            if (nb_read == 0) {
+                size_t wanted = TRACE_READ_RECORDS;
+                if (wanted > max_lines - batch->nb_lines) wanted = max_lines - batch->nb_lines;
+                if (wanted > trace->nb_records - trace->line) wanted = (size_t) (trace->nb_records - trace->line);
+                nb_read = fread(buffer, sizeof(trace_record_t), wanted, trace->file);
+                M_REQUIRE(nb_read == wanted, ERR_IO, "truncated trace: record %zu missing", trace->line + nb_read + 1);
+                records = buffer;
+            }
+            --nb_read;
+        }
+
+        command_t command;
+        int err = trace_record_to_command(records++, &command);
+        ++trace->line;
+        if (err == ERR_NONE) err = program_add_command(batch, &command);
+        M_EXIT_IF(err != ERR_NONE, err, "record %zu", trace->line);
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+int trace_next_packed(trace_t* trace, packed_program_t* batch, size_t max_lines)
+{
+    M_REQUIRE_NON_NULL(trace);
+    M_REQUIRE_NON_NULL(batch);
+
+    if (trace->format == TRACE_TEXT) {
+        const int err = program_stream_next_packed(&trace->text, batch, max_lines);
+        trace->line = trace->text.line;
+        return err;
+    }
+
+    batch->nb_lines = 0;
+    trace_record_t buffer[TRACE_READ_RECORDS];
+    int truncated = 0;
+    while (batch->nb_lines < max_lines && trace->line < trace->nb_records) {
+        size_t wanted = max_lines - batch->nb_lines;
+        if (wanted > trace->nb_records - trace->line) wanted = (size_t) (trace->nb_records - trace->line);
+
+        const trace_record_t* records = buffer;
+        if (trace->file != NULL) {
+            // compressed trace: records come by small blocks
+            if (wanted > TRACE_READ_RECORDS) wanted = TRACE_READ_RECORDS;
+            const size_t nb_read = fread(buffer, sizeof(trace_record_t), wanted, trace->file);
+            if (nb_read < wanted) {
+                // keeps the records before the missing one
+                wanted = nb_read;
+                truncated = 1;
+            }
+        } else {
+            records = trace->records + trace->line;
+        }
+
+        for (const trace_record_t* record = records; record < records + wanted; ++record) {
+            ++trace->line;
+            const int err = packed_program_add_command(batch, record);
+            M_EXIT_IF(err != ERR_NONE, err, "record %zu", trace->line);
+        }
+        if (truncated) {
+            ++trace->line;
+            M_EXIT_ERR(ERR_IO, "truncated trace: record %zu missing", trace->line);
+        }
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+int trace_close(trace_t* trace)
+{
+    M_REQUIRE_NON_NULL(trace);
+
+    if (trace->format == TRACE_TEXT) {
+        return program_stream_close(&trace->text);
+    }
+    int err = ERR_NONE;
+    if (trace->file != NULL && fclose(trace->file) != 0) err = ERR_IO;
+    trace->file = NULL;
+    if (trace->map != NULL) munmap(trace->map, trace->map_size);
+    trace->map = NULL;
+    trace->records = NULL;
+
+    return err;
+}
+
+//=========================================================================
+// Writes the header of a binary trace at the beginning of the file
+static int trace_header_write(FILE* file, uint64_t nb_records)
+{
+    trace_header_t header;
+    zero_init_var(header);
+    memcpy(header.magic, TRACE_MAGIC, TRACE_MAGIC_SIZE);
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(trace_record_t);
+    header.nb_records = nb_records;
+
+    M_REQUIRE(fseek(file, 0L, SEEK_SET) == 0, ERR_IO, "%s", "cannot seek to trace header");
+    M_REQUIRE(fwrite(&header, sizeof(header), 1, file) == 1, ERR_IO, "%s", "cannot write trace header");
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+int trace_writer_open(const char* filename, trace_writer_t* writer)
+{
+    M_REQUIRE_NON_NULL(filename);
+    M_REQUIRE_NON_NULL(writer);
+
+    writer->file = fopen(filename, "wb");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(writer->file, ERR_IO);
+    writer->nb_records = 0;
+
+    // provisional header: the number of records is only known on close
+    const int err = trace_header_write(writer->file, 0);
+    if (err != ERR_NONE) {
+        fclose(writer->file);
+        writer->file = NULL;
+    }
+    return err;
+}
+
+//=========================================================================
+int trace_writer_add(trace_writer_t* writer, const command_t* command)
+{
+    trace_record_t record;
+    M_EXIT_IF_ERR(trace_record_from_command(command, &record), "converting command");
+    return trace_writer_add_packed(writer, &record);
+}
+
+//=========================================================================
+int trace_writer_add_packed(trace_writer_t* writer, const packed_command_t* packed)
+{
+    M_REQUIRE_NON_NULL(writer);
+    M_REQUIRE_NON_NULL(writer->file);
+    M_REQUIRE_NON_NULL(packed);
+
+    M_REQUIRE(fwrite(packed, sizeof(*packed), 1, writer->file) == 1, ERR_IO,
+              "cannot write record %" PRIu64, writer->nb_records);
+    ++writer->nb_records;
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+int trace_writer_add_program(trace_writer_t* writer, const program_t* program, FILE* text_output)
+{
+    if (writer == NULL) return program_print(text_output, program);
+
+    for_all_lines(line, program) {
+        M_EXIT_IF_ERR(trace_writer_add(writer, line), "writing binary trace");
+    }
+    return ERR_NONE;
+}
+
+//=========================================================================
+int trace_writer_close(trace_writer_t* writer)
+{
+    M_REQUIRE_NON_NULL(writer);
+    M_REQUIRE_NON_NULL(writer->file);
+
+    int err = trace_header_write(writer->file, writer->nb_records);
+    if (fclose(writer->file) != 0 && err == ERR_NONE) err = ERR_IO;
+    writer->file = NULL;
+
+    return err;
+}
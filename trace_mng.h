@@ -0,0 +1,118 @@
+#pragma once
+
+/**
+ * @file trace_mng.h
+ * @brief Command trace management: reading text or binary traces, writing binary traces.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "trace.h"
+#include "commands.h"
+
+//=========================================================================
+/**
+ * @brief Convert a command to a binary trace record.
+ * @param command the command to be converted
+ * @param record (modified) the corresponding record
+ * @return error code
+ */
+int trace_record_from_command(const command_t* command, trace_record_t* record);
+
+//=========================================================================
+/**
+ * @brief Convert a binary trace record to a command, checked with command_check().
+ * @param record the record to be converted
+ * @param command (modified) the corresponding command
+ * @return error code
+ */
+int trace_record_to_command(const trace_record_t* record, command_t* command);
+
+//=========================================================================
+/**
+ * @brief Open a trace file for reading. Its format (text or binary) is
+ *        detected from its first bytes.
+ * @param filename the name of the trace file
+ * @param trace (modified) the trace to be opened
+ * @return error code
+ */
+int trace_open(const char* filename, trace_t* trace);
+
+//=========================================================================
+/**
+ * @brief Read the next batch of commands from a trace.
+ *        The previous content of the batch is discarded; at end of trace, the batch is left empty.
+ *        On error, trace->line is the number of the faulty command and the batch holds the
+ *        commands read before it.
+ * @param trace the trace to read from
+ * @param batch (modified) an initialized program, filled with at most max_lines commands
+ * @param max_lines the maximum number of commands to read
+ * @return error code
+ */
+int trace_next(trace_t* trace, program_t* batch, size_t max_lines);
+
+//=========================================================================
+/**
+ * @brief Same as trace_next(), into a packed program: binary records are copied as is.
+ *        On error too, the batch holds the commands read before the faulty one.
+ * @param trace the trace to read from
+ * @param batch (modified) an initialized packed program, filled with at most max_lines commands
+ * @param max_lines the maximum number of commands to read
+ * @return error code
+ */
+int trace_next_packed(trace_t* trace, packed_program_t* batch, size_t max_lines);
+
+//=========================================================================
+/**
+ * @brief Close a trace.
+ * @param trace the trace to be closed
+ * @return error code
+ */
+int trace_close(trace_t* trace);
+
+//=========================================================================
+/**
+ * @brief Create a binary trace file (header is finalized on close).
+ * @param filename the name of the file to be written
+ * @param writer (modified) the writer to be opened
+ * @return error code
+ */
+int trace_writer_open(const char* filename, trace_writer_t* writer);
+
+//=========================================================================
+/**
+ * @brief Append a command to a binary trace file.
+ * @param writer the writer
+ * @param command the command to be appended
+ * @return error code
+ */
+int trace_writer_add(trace_writer_t* writer, const command_t* command);
+
+//=========================================================================
+/**
+ * @brief Append a packed command to a binary trace file, as is.
+ * @param writer the writer
+ * @param packed the packed command to be appended
+ * @return error code
+ */
+int trace_writer_add_packed(trace_writer_t* writer, const packed_command_t* packed);
+
+//=========================================================================
+/**
+ * @brief Append all the commands of a program to a binary trace file,
+ *        or print them as text when there is no writer (see program_print()).
+ * @param writer the writer, or NULL for text output
+ * @param program the program to be appended
+ * @param text_output where the program is printed when writer is NULL
+ * @return error code
+ */
+int trace_writer_add_program(trace_writer_t* writer, const program_t* program, FILE* text_output);
+
+//=========================================================================
+/**
+ * @brief Write the final header and close a binary trace file.
+ * @param writer the writer to be closed
+ * @return error code
+ */
+int trace_writer_close(trace_writer_t* writer);
@@ -0,0 +1,65 @@
+#pragma once
+
+/**
+ * @file workload.h
+ * @brief Type definitions for synthetic workloads (parameterized access patterns).
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "commands.h" // for packed_command_t
+#include <stdint.h>
+
+enum workload_pattern {
+    WORKLOAD_SEQ,       // sequential scan of the data region
+    WORKLOAD_STRIDE,    // fixed stride through the data region (wrapping around)
+    WORKLOAD_RANDOM,    // uniformly random words of the data region
+    WORKLOAD_ZIPF,      // Zipfian hot set over the words of the data region
+    WORKLOAD_CHASE,     // pointer chase along a random cycle of nodes
+    WORKLOAD_STENCIL,   // 5-point 2D stencil from one dim x dim grid into another
+    WORKLOAD_MATMUL,    // tiled dim x dim matrix multiply C += A * B
+    WORKLOAD_PATTERNS   // not a pattern: number of patterns
+};
+typedef enum workload_pattern workload_pattern_t;
+
+#define WORKLOAD_CODE_BASE  ((uint64_t) 0x0000000000000000)
+#define WORKLOAD_DATA_BASE  ((uint64_t) 0x0000000040000000)
+
+/**
+ * @brief Parameters of a workload. Sizes are in bytes, dim and tile in words.
+ *        Between data accesses, ifetch instruction fetches walk a loop body of
+ *        code_size bytes (interleaved instruction stream).
+ */
+struct workload {
+    workload_pattern_t pattern;
+    uint64_t nb_accesses;       // number of data accesses to generate
+    uint64_t size;              // data footprint (seq, stride, random, zipf, chase)
+    uint64_t stride;            // stride (stride) or node size (chase)
+    double zipf_alpha;          // Zipf exponent (> 0)
+    uint64_t dim;               // grid side (stencil) or matrix side (matmul)
+    uint64_t tile;              // tile side (matmul)
+    unsigned write_percent;     // share of writes (seq, stride, random, zipf)
+    unsigned ifetch;            // instruction fetches per data access
+    uint64_t code_size;         // size of the loop body
+    uint64_t seed;              // seed of the (portable) pseudo-random generator
+};
+typedef struct workload workload_t;
+
+/**
+ * @brief Receiver of the generated commands, called once per command, in order.
+ *        A non-zero (error) return stops the generation.
+ */
+typedef int (*workload_sink_t)(void* arg, const packed_command_t* command);
+
+/**
+ * @brief Set of the virtual pages touched by a workload:
+ *        one bitmap for the code region, one for the data region.
+ */
+struct workload_pages {
+    uint8_t* code;
+    uint64_t code_pages;
+    uint8_t* data;
+    uint64_t data_pages;
+};
+typedef struct workload_pages workload_pages_t;
@@ -0,0 +1,581 @@
+/**
+ * @file workload_mng.c
+ * @brief Synthetic workload generation, with the memory description to run it.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "workload_mng.h"
+#include "addr.h"
+#include "error.h"
+#include "util.h"
+
+#include <string.h> // for strcmp(), memset()
+#include <stdlib.h>
+#include <math.h>   // for exp(), log(), expm1(), log1p()
+#include <inttypes.h> // for PRIx64
+
+#define WORKLOAD_DEFAULT_ACCESSES   100000
+#define WORKLOAD_DEFAULT_SIZE       ((uint64_t) 1 << 20)
+#define WORKLOAD_DEFAULT_STRIDE     64
+#define WORKLOAD_DEFAULT_ALPHA      0.99
+#define WORKLOAD_DEFAULT_DIM        256
+#define WORKLOAD_DEFAULT_TILE       16
+#define WORKLOAD_DEFAULT_WRITES     25
+#define WORKLOAD_DEFAULT_IFETCH     1
+#define WORKLOAD_DEFAULT_CODE_SIZE  256
+
+#define PAGE_ENTRIES                PD_ENTRIES
+#define MAX_PHY_PAGES               ((uint64_t) 1 << PHY_PAGE_NUM)
+// multiplier scattering the Zipf ranks over the data region (prime)
+#define ZIPF_SCATTER                2654435761u
+
+static const char* const PATTERN_NAMES[WORKLOAD_PATTERNS] = {
+    "seq", "stride", "random", "zipf", "chase", "stencil", "matmul"
+};
+
+//=========================================================================
+int workload_init(workload_t* workload)
+{
+    M_REQUIRE_NON_NULL(workload);
+
+    zero_init_ptr(workload);
+    workload->pattern = WORKLOAD_SEQ;
+    workload->nb_accesses = WORKLOAD_DEFAULT_ACCESSES;
+    workload->size = WORKLOAD_DEFAULT_SIZE;
+    workload->stride = WORKLOAD_DEFAULT_STRIDE;
+    workload->zipf_alpha = WORKLOAD_DEFAULT_ALPHA;
+    workload->dim = WORKLOAD_DEFAULT_DIM;
+    workload->tile = WORKLOAD_DEFAULT_TILE;
+    workload->write_percent = WORKLOAD_DEFAULT_WRITES;
+    workload->ifetch = WORKLOAD_DEFAULT_IFETCH;
+    workload->code_size = WORKLOAD_DEFAULT_CODE_SIZE;
+    workload->seed = 1;
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+int workload_pattern_parse(const char* name, workload_pattern_t* pattern)
+{
+    M_REQUIRE_NON_NULL(name);
+    M_REQUIRE_NON_NULL(pattern);
+
+    for (int p = 0; p < WORKLOAD_PATTERNS; ++p) {
+        if (strcmp(name, PATTERN_NAMES[p]) == 0) {
+            *pattern = (workload_pattern_t) p;
+            return ERR_NONE;
+        }
+    }
+    M_EXIT_ERR(ERR_BAD_PARAMETER, "unknown pattern \"%s\"", name);
+}
+
+//=========================================================================
+// Size of the data region of a workload, in bytes
+static uint64_t data_span(const workload_t* workload)
+{
+    const uint64_t matrix = workload->dim * workload->dim * sizeof(word_t);
+    switch (workload->pattern) {
+    case WORKLOAD_STENCIL:
+        return 2 * matrix;
+    case WORKLOAD_MATMUL:
+        return 3 * matrix;
+    default:
+        return workload->size;
+    }
+}
+
+//=========================================================================
+int workload_check(const workload_t* workload)
+{
+    M_REQUIRE_NON_NULL(workload);
+    M_REQUIRE(workload->pattern < WORKLOAD_PATTERNS, ERR_BAD_PARAMETER, "invalid pattern %d", workload->pattern);
+    M_REQUIRE(workload->write_percent <= 100, ERR_BAD_PARAMETER, "write share %u%% is over 100%%", workload->write_percent);
+    M_REQUIRE(workload->ifetch == 0 || (workload->code_size >= sizeof(word_t) && workload->code_size % sizeof(word_t) == 0),
+              ERR_SIZE, "code size %" PRIu64 " must be a non-zero multiple of 4", workload->code_size);
+
+    switch (workload->pattern) {
+    case WORKLOAD_STENCIL:
+        M_REQUIRE(workload->dim >= 3, ERR_SIZE, "stencil grid side %" PRIu64 " must be at least 3", workload->dim);
+        break;
+    case WORKLOAD_MATMUL:
+        M_REQUIRE(workload->dim >= 1 && workload->tile >= 1, ERR_SIZE, "%s", "matrix and tile sides must be positive");
+        break;
+    case WORKLOAD_STRIDE:
+    case WORKLOAD_CHASE:
+        M_REQUIRE(workload->stride >= sizeof(word_t) && workload->stride % sizeof(word_t) == 0, ERR_SIZE,
+                  "stride %" PRIu64 " must be a non-zero multiple of 4", workload->stride);
+        M_REQUIRE(workload->size >= workload->stride, ERR_SIZE, "%s", "size must be at least one stride");
+        M_REQUIRE(workload->size / workload->stride <= UINT32_MAX, ERR_SIZE, "%s", "too many nodes");
+        // fall through
+    default:
+        M_REQUIRE(workload->size >= sizeof(word_t) && workload->size % sizeof(word_t) == 0, ERR_SIZE,
+                  "size %" PRIu64 " must be a non-zero multiple of 4", workload->size);
+        break;
+    }
+    M_REQUIRE(workload->pattern != WORKLOAD_ZIPF || workload->zipf_alpha > 0.0, ERR_BAD_PARAMETER,
+              "Zipf exponent %g must be positive", workload->zipf_alpha);
+
+    // the data region must fit between its base and the end of the virtual address space
+    M_REQUIRE(data_span(workload) <= ((uint64_t) 1 << (VIRT_ADDR - VIRT_ADDR_RES)) - WORKLOAD_DATA_BASE,
+              ERR_SIZE, "%s", "data region is too large");
+    M_REQUIRE(workload->code_size <= WORKLOAD_DATA_BASE - WORKLOAD_CODE_BASE, ERR_SIZE, "%s", "code region is too large");
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+// Portable pseudo-random generator (splitmix64)
+static uint64_t rng_next(uint64_t* state)
+{
+    uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+// uniform in [0, 1)
+static double rng_uniform(uint64_t* state)
+{
+    return (double) (rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// uniform in [0, n)
+static uint64_t rng_below(uint64_t* state, uint64_t n)
+{
+    return rng_next(state) % n;
+}
+
+//=========================================================================
+// Generation state
+typedef struct {
+    const workload_t* workload;
+    workload_sink_t sink;
+    void* arg;
+    workload_pages_t* pages;
+    uint64_t rng;
+    uint64_t pc;            // offset of the next instruction fetch in the loop body
+    uint64_t done;          // data accesses generated so far
+} generator_t;
+
+// Records a touched page
+static void page_touch(uint8_t* bitmap, uint64_t offset)
+{
+    const uint64_t page = offset >> PAGE_OFFSET;
+    bitmap[page / 8] |= (uint8_t) (1u << (page % 8));
+}
+
+// Generates the instruction fetches preceding a data access, then the data access
+static int emit_data(generator_t* g, uint64_t offset, command_word_t order, word_t write_data)
+{
+    packed_command_t command;
+    zero_init_var(command);
+    command.type = INSTRUCTION;
+    command.order = READ;
+    command.data_size = sizeof(word_t);
+    for (unsigned i = 0; i < g->workload->ifetch; ++i) {
+        command.vaddr = WORKLOAD_CODE_BASE + g->pc;
+        if (g->pages != NULL) page_touch(g->pages->code, g->pc);
+        M_EXIT_IF_ERR(g->sink(g->arg, &command), "sending instruction fetch");
+        g->pc = (g->pc + sizeof(word_t)) % g->workload->code_size;
+    }
+
+    command.type = DATA;
+    command.order = (uint8_t) order;
+    command.write_data = (order == WRITE) ? write_data : 0;
+    command.vaddr = WORKLOAD_DATA_BASE + offset;
+    if (g->pages != NULL) page_touch(g->pages->data, offset);
+    M_EXIT_IF_ERR(g->sink(g->arg, &command), "sending data access");
+    ++g->done;
+
+    return ERR_NONE;
+}
+
+// Generates one data access at OFFSET (of the data region), unless all were generated
+#define EMIT(G, OFFSET, ORDER) \
+    do { \
+        if ((G)->done >= (G)->workload->nb_accesses) return ERR_NONE; \
+        const word_t data_ = (ORDER) == WRITE ? (word_t) rng_next(&(G)->rng) : 0; \
+        M_EXIT_IF_ERR(emit_data(G, OFFSET, ORDER, data_), "generating access"); \
+    } while (0)
+
+// Read or write, according to the share of writes
+static command_word_t random_order(generator_t* g)
+{
+    return rng_below(&g->rng, 100) < g->workload->write_percent ? WRITE : READ;
+}
+
+//=========================================================================
+// Sequential scan or fixed stride, wrapping around the data region
+static int generate_stride(generator_t* g, uint64_t stride)
+{
+    const uint64_t size = g->workload->size;
+    for (uint64_t offset = 0; ; offset = (offset + stride) % size) {
+        EMIT(g, offset & ~(uint64_t) (sizeof(word_t) - 1), random_order(g));
+    }
+}
+
+//=========================================================================
+static int generate_random(generator_t* g)
+{
+    const uint64_t words = g->workload->size / sizeof(word_t);
+    for (;;) {
+        EMIT(g, rng_below(&g->rng, words) * sizeof(word_t), random_order(g));
+    }
+}
+
+//=========================================================================
+// Zipf sampling by rejection-inversion (W. Hormann, G. Derflinger, 1996):
+// constant time and memory whatever the number of items.
+
+// log1p(x) / x, continuous at 0
+static double helper1(double x)
+{
+    return fabs(x) > 1e-8 ? log1p(x) / x : 1.0 - x * (0.5 - x / 3.0);
+}
+
+// expm1(x) / x, continuous at 0
+static double helper2(double x)
+{
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x / 3.0);
+}
+
+static double zipf_h(double alpha, double x)
+{
+    return exp(-alpha * log(x));
+}
+
+static double zipf_H(double alpha, double x)
+{
+    const double log_x = log(x);
+    return helper2((1.0 - alpha) * log_x) * log_x;
+}
+
+static double zipf_H_inv(double alpha, double x)
+{
+    double t = x * (1.0 - alpha);
+    if (t < -1.0) t = -1.0;
+    return exp(helper1(t) * x);
+}
+
+static int generate_zipf(generator_t* g)
+{
+    const double alpha = g->workload->zipf_alpha;
+    const uint64_t n = g->workload->size / sizeof(word_t);
+    const double h_x1 = zipf_H(alpha, 1.5) - 1.0;
+    const double h_n = zipf_H(alpha, (double) n + 0.5);
+    const double s = 2.0 - zipf_H_inv(alpha, zipf_H(alpha, 2.5) - zipf_h(alpha, 2.0));
+    // the hottest words are scattered over the region rather than packed at its start
+    const uint64_t scatter = (n % ZIPF_SCATTER == 0) ? 1 : ZIPF_SCATTER;
+
+    for (;;) {
+        uint64_t k = 0;
+        for (;;) {
+            const double u = h_n + rng_uniform(&g->rng) * (h_x1 - h_n);
+            const double x = zipf_H_inv(alpha, u);
+            k = (uint64_t) (x + 0.5);
+            if (k < 1) k = 1;
+            if (k > n) k = n;
+            if ((double) k - x <= s || u >= zipf_H(alpha, (double) k + 0.5) - zipf_h(alpha, (double) k)) break;
+        }
+        EMIT(g, ((k - 1) * scatter % n) * sizeof(word_t), random_order(g));
+    }
+}
+
+//=========================================================================
+// Pointer chase: one read per node, along a single random cycle through all nodes
+static int generate_chase(generator_t* g)
+{
+    const uint64_t nodes = g->workload->size / g->workload->stride;
+    uint32_t* next = calloc(nodes, sizeof(uint32_t));
+    M_EXIT_IF_NULL(next, nodes * sizeof(uint32_t));
+
+    // Sattolo's algorithm: a uniformly random cyclic permutation
+    for (uint64_t i = 0; i < nodes; ++i) next[i] = (uint32_t) i;
+    for (uint64_t i = nodes - 1; i > 0; --i) {
+        const uint64_t j = rng_below(&g->rng, i);
+        const uint32_t tmp = next[i];
+        next[i] = next[j];
+        next[j] = tmp;
+    }
+
+    int err = ERR_NONE;
+    for (uint64_t node = 0; err == ERR_NONE && g->done < g->workload->nb_accesses; node = next[node]) {
+        err = emit_data(g, node * g->workload->stride, READ, 0);
+    }
+    free(next);
+    return err;
+}
+
+//=========================================================================
+// 5-point stencil sweeps, from grid A into grid B, then back
+static int generate_stencil(generator_t* g)
+{
+    const uint64_t dim = g->workload->dim;
+    const uint64_t grid = dim * dim * sizeof(word_t);
+#define CELL(BASE, I, J) ((BASE) + ((I) * dim + (J)) * sizeof(word_t))
+    for (uint64_t from = 0, to = grid; ; from = grid - from, to = grid - to) {
+        for (uint64_t i = 1; i + 1 < dim; ++i) {
+            for (uint64_t j = 1; j + 1 < dim; ++j) {
+                EMIT(g, CELL(from, i - 1, j), READ);
+                EMIT(g, CELL(from, i, j - 1), READ);
+                EMIT(g, CELL(from, i, j), READ);
+                EMIT(g, CELL(from, i, j + 1), READ);
+                EMIT(g, CELL(from, i + 1, j), READ);
+                EMIT(g, CELL(to, i, j), WRITE);
+            }
+        }
+    }
+}
+
+//=========================================================================
+// Tiled C += A * B, repeated
+static int generate_matmul(generator_t* g)
+{
+    const uint64_t dim = g->workload->dim;
+    const uint64_t tile = g->workload->tile;
+    const uint64_t matrix = dim * dim * sizeof(word_t);
+    const uint64_t a = 0, b = matrix, c = 2 * matrix;
+    for (;;) {
+        for (uint64_t ii = 0; ii < dim; ii += tile) {
+            for (uint64_t jj = 0; jj < dim; jj += tile) {
+                for (uint64_t kk = 0; kk < dim; kk += tile) {
+                    for (uint64_t i = ii; i < ii + tile && i < dim; ++i) {
+                        for (uint64_t j = jj; j < jj + tile && j < dim; ++j) {
+                            EMIT(g, CELL(c, i, j), READ);
+                            for (uint64_t k = kk; k < kk + tile && k < dim; ++k) {
+                                EMIT(g, CELL(a, i, k), READ);
+                                EMIT(g, CELL(b, k, j), READ);
+                            }
+                            EMIT(g, CELL(c, i, j), WRITE);
+                        }
+                    }
+                }
+            }
+        }
+    }
+#undef CELL
+}
+
+//=========================================================================
+int workload_pages_free(workload_pages_t* pages)
+{
+    M_REQUIRE_NON_NULL(pages);
+
+    free(pages->code);
+    free(pages->data);
+    zero_init_ptr(pages);
+
+    return ERR_NONE;
+}
+
+//=========================================================================
+int workload_generate(const workload_t* workload, workload_sink_t sink, void* arg,
+                      workload_pages_t* pages)
+{
+    M_REQUIRE_NON_NULL(sink);
+    M_EXIT_IF_ERR(workload_check(workload), "checking workload");
+
+    generator_t g;
+    zero_init_var(g);
+    g.workload = workload;
+    g.sink = sink;
+    g.arg = arg;
+    g.pages = pages;
+    g.rng = workload->seed;
+
+    if (pages != NULL) {
+        zero_init_ptr(pages);
+        pages->code_pages = (workload->code_size + PAGE_SIZE - 1) / PAGE_SIZE;
+        pages->data_pages = (data_span(workload) + PAGE_SIZE - 1) / PAGE_SIZE;
+        pages->code = calloc(pages->code_pages / 8 + 1, 1);
+        pages->data = calloc(pages->data_pages / 8 + 1, 1);
+        if (pages->code == NULL || pages->data == NULL) {
+            workload_pages_free(pages);
+            M_EXIT_ERR(ERR_MEM, "%s", "cannot allocate page bitmaps");
+        }
+    }
+
+    int err = ERR_NONE;
+    switch (workload->pattern) {
+    case WORKLOAD_SEQ:
+        err = generate_stride(&g, sizeof(word_t));
+        break;
+    case WORKLOAD_STRIDE:
+        err = generate_stride(&g, workload->stride);
+        break;
+    case WORKLOAD_RANDOM:
+        err = generate_random(&g);
+        break;
+    case WORKLOAD_ZIPF:
+        err = generate_zipf(&g);
+        break;
+    case WORKLOAD_CHASE:
+        err = generate_chase(&g);
+        break;
+    case WORKLOAD_STENCIL:
+        err = generate_stencil(&g);
+        break;
+    case WORKLOAD_MATMUL:
+        err = generate_matmul(&g);
+        break;
+    default:
+        err = ERR_BAD_PARAMETER;
+        break;
+    }
+
+    if (err != ERR_NONE && pages != NULL) workload_pages_free(pages);
+    return err;
+}
+
+//=========================================================================
+// Page tables being built: tables[0] is the PGD, at physical address 0
+typedef struct {
+    uint32_t page;                  // physical page number
+    pte_t entries[PAGE_ENTRIES];
+} page_table_t;
+
+typedef struct {
+    page_table_t* tables;
+    size_t nb_tables;
+    size_t allocated;
+    uint64_t nb_phy_pages;          // physical pages used so far (tables and data)
+    long current[3];                // current PUD, PMD and PTE tables (-1 if none)
+    uint64_t prefix[3];             // the part of the virtual page number they cover
+} page_tables_t;
+
+// Adds an empty table, on a new physical page; returns its index, -1 on error
+static long table_new(page_tables_t* pt)
+{
+    if (pt->nb_tables == pt->allocated) {
+        const size_t allocated = 2 * pt->allocated + 1;
+        page_table_t* bigger = realloc(pt->tables, allocated * sizeof(page_table_t));
+        if (bigger == NULL) return -1;
+        pt->tables = bigger;
+        pt->allocated = allocated;
+    }
+    page_table_t* table = &pt->tables[pt->nb_tables];
+    memset(table, 0, sizeof(page_table_t));
+    table->page = (uint32_t) pt->nb_phy_pages++;
+    return (long) pt->nb_tables++;
+}
+
+// Maps virtual page number vpn on a new physical page.
+// Pages must be mapped in increasing order: tables are then created only
+// when the part of vpn they cover changes.
+static int map_page(page_tables_t* pt, uint64_t vpn)
+{
+    static const int shift[4] = { PUD_ENTRY + PMD_ENTRY + PTE_ENTRY, PMD_ENTRY + PTE_ENTRY, PTE_ENTRY, 0 };
+
+    long parent = 0; // PGD
+    for (int level = 0; level < 3; ++level) {
+        const uint64_t prefix = vpn >> shift[level];
+        if (pt->current[level] < 0 || pt->prefix[level] != prefix) {
+            const long table = table_new(pt);
+            M_REQUIRE(table >= 0, ERR_MEM, "%s", "cannot allocate page table");
+            pt->tables[parent].entries[prefix & (PAGE_ENTRIES - 1)] = (pte_t) (pt->tables[table].page << PAGE_OFFSET);
+            pt->current[level] = table;
+            pt->prefix[level] = prefix;
+            for (int below = level + 1; below < 3; ++below) pt->current[below] = -1;
+        }
+        parent = pt->current[level];
+    }
+    pt->tables[parent].entries[vpn & (PAGE_ENTRIES - 1)] = (pte_t) (pt->nb_phy_pages++ << PAGE_OFFSET);
+
+    return ERR_NONE;
+}
+
+// Next touched page at or after *page in a bitmap of count pages; returns 0 if none
+static int next_touched(const uint8_t* bitmap, uint64_t count, uint64_t* page)
+{
+    for (; *page < count; ++*page) {
+        if (bitmap[*page / 8] & (1u << (*page % 8))) return 1;
+    }
+    return 0;
+}
+
+// Writes a page file: content (may be NULL for zeros), padded with zeros to PAGE_SIZE
+static int page_file_write(const char* filename, const void* content, size_t size)
+{
+    static const char zeros[PAGE_SIZE];
+    FILE* file = fopen(filename, "wb");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(file, ERR_IO);
+    int ok = (content == NULL || fwrite(content, size, 1, file) == 1);
+    const size_t padding = PAGE_SIZE - (content == NULL ? 0 : size);
+    ok = ok && fwrite(zeros, padding, 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    M_REQUIRE(ok, ERR_IO, "cannot write page file %s", filename);
+
+    return ERR_NONE;
+}
+
+// Writes the description and the page files from the built tables
+static int memory_write(const char* filename, const page_tables_t* pt, const workload_pages_t* pages)
+{
+    const size_t name_size = strlen(filename) + 32;
+    char* name = malloc(name_size);
+    M_EXIT_IF_NULL(name, name_size);
+    FILE* desc = fopen(filename, "w");
+    if (desc == NULL) {
+        free(name);
+        M_EXIT_ERR(ERR_IO, "cannot create %s", filename);
+    }
+
+    int err = ERR_NONE;
+    fprintf(desc, "%" PRIu64 "\n", pt->nb_phy_pages * PAGE_SIZE);
+    snprintf(name, name_size, "%s-pgd.bin", filename);
+    fprintf(desc, "%s\n%zu\n", name, pt->nb_tables - 1);
+    err = page_file_write(name, pt->tables[0].entries, sizeof(pt->tables[0].entries));
+    for (size_t t = 1; err == ERR_NONE && t < pt->nb_tables; ++t) {
+        snprintf(name, name_size, "%s-t%zu.bin", filename, t);
+        fprintf(desc, "0x%08" PRIX32 " %s\n", (uint32_t) (pt->tables[t].page << PAGE_OFFSET), name);
+        err = page_file_write(name, pt->tables[t].entries, sizeof(pt->tables[t].entries));
+    }
+
+    // all data pages share one zero-filled page file
+    snprintf(name, name_size, "%s-data.bin", filename);
+    if (err == ERR_NONE) err = page_file_write(name, NULL, 0);
+    for (uint64_t p = 0; err == ERR_NONE && next_touched(pages->code, pages->code_pages, &p); ++p) {
+        fprintf(desc, "0x%016" PRIX64 " %s\n", WORKLOAD_CODE_BASE + (p << PAGE_OFFSET), name);
+    }
+    for (uint64_t p = 0; err == ERR_NONE && next_touched(pages->data, pages->data_pages, &p); ++p) {
+        fprintf(desc, "0x%016" PRIX64 " %s\n", WORKLOAD_DATA_BASE + (p << PAGE_OFFSET), name);
+    }
+
+    if (ferror(desc) && err == ERR_NONE) err = ERR_IO;
+    if (fclose(desc) != 0 && err == ERR_NONE) err = ERR_IO;
+    free(name);
+    return err;
+}
+
+//=========================================================================
+int workload_write_memory(const char* filename, const workload_pages_t* pages)
+{
+    M_REQUIRE_NON_NULL(filename);
+    M_REQUIRE_NON_NULL(pages);
+    M_REQUIRE_NON_NULL(pages->code);
+    M_REQUIRE_NON_NULL(pages->data);
+
+    page_tables_t pt;
+    zero_init_var(pt);
+    for (int level = 0; level < 3; ++level) pt.current[level] = -1;
+    M_REQUIRE(table_new(&pt) == 0, ERR_MEM, "%s", "cannot allocate PGD");
+
+    // code pages come before data pages: they are all mapped in increasing order
+    int err = ERR_NONE;
+    for (uint64_t p = 0; err == ERR_NONE && next_touched(pages->code, pages->code_pages, &p); ++p) {
+        err = map_page(&pt, (WORKLOAD_CODE_BASE >> PAGE_OFFSET) + p);
+    }
+    for (uint64_t p = 0; err == ERR_NONE && next_touched(pages->data, pages->data_pages, &p); ++p) {
+        err = map_page(&pt, (WORKLOAD_DATA_BASE >> PAGE_OFFSET) + p);
+    }
+    if (err == ERR_NONE && pt.nb_phy_pages > MAX_PHY_PAGES) {
+        err = ERR_SIZE;
+        debug_print("%" PRIu64 " physical pages needed, only %" PRIu64 " available", pt.nb_phy_pages, MAX_PHY_PAGES);
+    }
+    if (err == ERR_NONE) err = memory_write(filename, &pt, pages);
+
+    free(pt.tables);
+    return err;
+}
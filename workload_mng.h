@@ -0,0 +1,68 @@
+#pragma once
+
+/**
+ * @file workload_mng.h
+ * @brief Synthetic workload generation, with the memory description to run it.
+ *
+ * @author Ewan Golfier, Jonathan Reymond
+ * @date 2019
+ */
+
+#include "workload.h"
+#include <stdio.h>
+
+//=========================================================================
+/**
+ * @brief Set the default parameters of a workload.
+ * @param workload (modified) the workload to be initialized
+ * @return error code
+ */
+int workload_init(workload_t* workload);
+
+//=========================================================================
+/**
+ * @brief Parse a pattern name ("seq", "stride", "random", "zipf", "chase", "stencil", "matmul").
+ * @param name the name to be parsed
+ * @param pattern (modified) the corresponding pattern
+ * @return error code
+ */
+int workload_pattern_parse(const char* name, workload_pattern_t* pattern);
+
+//=========================================================================
+/**
+ * @brief Check the parameters of a workload (sizes, alignment, limits).
+ * @param workload the workload to be checked
+ * @return error code
+ */
+int workload_check(const workload_t* workload);
+
+//=========================================================================
+/**
+ * @brief Generate the commands of a workload; the same parameters always give the same commands.
+ * @param workload the workload to be generated
+ * @param sink the receiver of the commands
+ * @param arg passed to sink
+ * @param pages (modified) the touched pages, to be freed with workload_pages_free(); may be NULL
+ * @return error code
+ */
+int workload_generate(const workload_t* workload, workload_sink_t sink, void* arg,
+                      workload_pages_t* pages);
+
+//=========================================================================
+/**
+ * @brief Write a memory description (see mem_init_from_description()) mapping the
+ *        touched pages, with its page files: "<filename>-pgd.bin", "<filename>-t<i>.bin"
+ *        for the page tables, and one zero-filled "<filename>-data.bin" shared by all data pages.
+ * @param filename the name of the memory description to be written
+ * @param pages the touched pages
+ * @return error code
+ */
+int workload_write_memory(const char* filename, const workload_pages_t* pages);
+
+//=========================================================================
+/**
+ * @brief Free a set of touched pages.
+ * @param pages the set to be freed
+ * @return error code
+ */
+int workload_pages_free(workload_pages_t* pages);